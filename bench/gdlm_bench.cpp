@@ -0,0 +1,642 @@
+// Headless benchmarks for the parts of our hand pipeline that don't need Godot.
+// Build and run with `scons benchmark`, or run the resulting program directly:
+//   gdlm_bench [--ticks n] [--recording file.gdlmrec]
+// Every benchmark prints one JSON object per line so results can be compared by scripts.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <math.h>
+#include <new>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "gdlm_frame_buffer.h"
+#include "gdlm_frame_history.h"
+#include "gdlm_hand_filter.h"
+#include "gdlm_hand_merger.h"
+#include "gdlm_hand_proxies.h"
+#include "gdlm_hand_slots.h"
+#include "gdlm_hand_solver.h"
+#include "gdlm_hand_trackers.h"
+#include "gdlm_image_stream.h"
+#include "gdlm_recording.h"
+#include "gdlm_synthetic_source.h"
+
+// Largest difference we accept between gdlm_solve_hand and our legacy solver, our SIMD lanes round a little differently.
+#define GDLM_BENCH_SOLVER_TOLERANCE 1e-4f
+
+// Our slots benchmark gives all hands new leap ids this often, like hands leaving and coming back.
+#define GDLM_BENCH_CHURN_TICKS 16
+
+using namespace godot;
+
+// We count allocations made through operator new, our pipeline should not make any once it's running.
+static std::atomic<uint64_t> allocation_count(0);
+
+// Our replacements aren't inlined, GCC warns about a mismatch if it sees malloc or free on only one side.
+#ifdef _MSC_VER
+#define BENCH_NOINLINE __declspec(noinline)
+#else
+#define BENCH_NOINLINE __attribute__((noinline))
+#endif
+
+BENCH_NOINLINE void *operator new(size_t p_size) {
+	allocation_count.fetch_add(1, std::memory_order_relaxed);
+	void *ptr = malloc(p_size == 0 ? 1 : p_size);
+	if (ptr == NULL) {
+		throw std::bad_alloc();
+	}
+	return ptr;
+}
+
+BENCH_NOINLINE void *operator new[](size_t p_size) {
+	return operator new(p_size);
+}
+
+BENCH_NOINLINE void operator delete(void *p_ptr) noexcept {
+	free(p_ptr);
+}
+
+BENCH_NOINLINE void operator delete[](void *p_ptr) noexcept {
+	operator delete(p_ptr);
+}
+
+// with sized deallocation our compiler calls these instead, they have to match our replacements above
+BENCH_NOINLINE void operator delete(void *p_ptr, size_t) noexcept {
+	free(p_ptr);
+}
+
+BENCH_NOINLINE void operator delete[](void *p_ptr, size_t) noexcept {
+	operator delete(p_ptr);
+}
+
+static inline int64_t now_ns() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+enum bench_mode {
+	BENCH_SOLVE, // only solve the bone frames of each hand
+	BENCH_SOLVE_LEGACY, // same with our original per bone solver
+	BENCH_TICK, // hand our frame from our writer to our reader and solve all hands, like a physics tick
+	BENCH_TICK_ROTATIONS, // same but solving with our bone rotations
+	BENCH_TICK_INTERPOLATED, // same but interpolating our frame from our history, like a physics tick in ARVR mode
+	BENCH_TICK_FILTERED, // same as our tick but filtering each hand before we solve it
+	BENCH_TICK_MERGED, // same as our tick but merging our frame with a copy of itself, like two devices seeing the same hands
+	BENCH_TICK_PROXIES, // same as our tick but also placing our collision proxies
+	BENCH_TICK_TRACKERS, // hand our frame over like our tick but only update our ARVR trackers, compare with tick_filtered
+	BENCH_SLOTS, // only find, bind and release hand slots for our hands like update_hands does, with leap ids churning
+	BENCH_MAX
+};
+
+static const char *const bench_names[] = {
+	"solve_hand",
+	"solve_hand_legacy",
+	"tick",
+	"tick_rotations",
+	"tick_interpolated",
+	"tick_filtered",
+	"tick_merged",
+	"tick_proxies",
+	"tick_trackers",
+	"hand_slots"
+};
+
+// Where our frames come from, either our synthetic source or a recording.
+// Frames are produced outside of our timed section.
+struct bench_frames {
+	GDLMSyntheticSource *synthetic_source;
+	std::vector<gdlm_frame> *recorded; // NULL if we use our synthetic source
+	int64_t recorded_span; // time between our first and last recorded frame
+	gdlm_frame frame;
+
+	const LEAP_TRACKING_EVENT *get(int64_t p_index) {
+		if (recorded == NULL) {
+			return synthetic_source->generate(p_index);
+		}
+
+		// loop our recording but keep our timestamps going forward so our history keeps working
+		int64_t count = (int64_t)recorded->size();
+		gdlm_copy_frame(&frame, &(*recorded)[p_index % count].event);
+		frame.event.info.timestamp += (p_index / count) * (recorded_span + 1);
+		return &frame.event;
+	}
+};
+
+// Same as update_hand_position, the inverse of our palm transform.
+static void palm_inverse(const LEAP_HAND *p_hand, float p_world_scale, gdlm_bone_frame *r_inverse) {
+	const LEAP_QUATERNION &q = p_hand->palm.orientation;
+	float d = q.x * q.x + q.y * q.y + q.z * q.z + q.w * q.w;
+	float s = 2.0f / d;
+	float xs = q.x * s, ys = q.y * s, zs = q.z * s;
+	float wx = q.w * xs, wy = q.w * ys, wz = q.w * zs;
+	float xx = q.x * xs, xy = q.x * ys, xz = q.x * zs;
+	float yy = q.y * ys, yz = q.y * zs, zz = q.z * zs;
+	float basis[3][3] = {
+		{ 1.0f - (yy + zz), xy - wz, xz + wy },
+		{ xy + wz, 1.0f - (xx + zz), yz - wx },
+		{ xz - wy, yz + wx, 1.0f - (xx + yy) }
+	};
+	float origin[3] = {
+		p_hand->palm.position.x * p_world_scale,
+		p_hand->palm.position.y * p_world_scale,
+		p_hand->palm.position.z * p_world_scale
+	};
+
+	// our basis is orthonormal so our inverse is our transpose
+	for (int r = 0; r < 3; r++) {
+		for (int c = 0; c < 3; c++) {
+			r_inverse->basis[r][c] = basis[c][r];
+		}
+	}
+	for (int r = 0; r < 3; r++) {
+		r_inverse->origin[r] = -(r_inverse->basis[r][0] * origin[0] + r_inverse->basis[r][1] * origin[1] + r_inverse->basis[r][2] * origin[2]);
+	}
+}
+
+// Our original per bone solver, kept as a reference for gdlm_solve_hand. For each bone we bring our next joint
+// into our parents space, build a basis by crossing with up, and multiply our parents inverse with the inverse
+// of our new frame, one digit at a time.
+static void legacy_normalize(float *r_vector) {
+	float length = sqrtf(r_vector[0] * r_vector[0] + r_vector[1] * r_vector[1] + r_vector[2] * r_vector[2]);
+	for (int i = 0; i < 3; i++) {
+		r_vector[i] = length == 0.0f ? 0.0f : r_vector[i] / length;
+	}
+}
+
+static void legacy_cross(const float *p_a, const float *p_b, float *r_cross) {
+	r_cross[0] = p_a[1] * p_b[2] - p_a[2] * p_b[1];
+	r_cross[1] = p_a[2] * p_b[0] - p_a[0] * p_b[2];
+	r_cross[2] = p_a[0] * p_b[1] - p_a[1] * p_b[0];
+}
+
+static void legacy_xform(const gdlm_bone_frame &p_frame, const float *p_vector, float *r_vector) {
+	for (int r = 0; r < 3; r++) {
+		r_vector[r] = p_frame.basis[r][0] * p_vector[0] + p_frame.basis[r][1] * p_vector[1] + p_frame.basis[r][2] * p_vector[2] + p_frame.origin[r];
+	}
+}
+
+static void solve_hand_legacy(const LEAP_HAND *p_hand, float p_world_scale, const gdlm_bone_frame &p_hand_inverse, gdlm_hand_frames *r_frames) {
+	const float up[3] = { 0.0f, 1.0f, 0.0f };
+	for (int d = 0; d < 5; d++) {
+		const LEAP_DIGIT &digit = p_hand->digits[d];
+		gdlm_bone_frame parent_inverse = p_hand_inverse;
+		gdlm_bone_frame bone_pose;
+
+		// our first bone provides our starting position for our first node
+		const LEAP_VECTOR &start = digit.bones[0].prev_joint;
+		float start_pos[3] = { start.x * p_world_scale, start.y * p_world_scale, start.z * p_world_scale };
+		legacy_xform(parent_inverse, start_pos, bone_pose.origin);
+
+		// we skip the first bone for our thumb
+		int first_bone = d == 0 ? 1 : 0;
+		float length = 0.0f;
+		for (int b = first_bone; b < 4; b++) {
+			const LEAP_VECTOR &joint = digit.bones[b].next_joint;
+			float joint_pos[3] = { joint.x * p_world_scale, joint.y * p_world_scale, joint.z * p_world_scale };
+
+			// transform it based on our last locale and remove our previous position to get our delta
+			float bone_pos[3];
+			legacy_xform(parent_inverse, joint_pos, bone_pos);
+			for (int i = 0; i < 3; i++) {
+				bone_pos[i] -= bone_pose.origin[i];
+			}
+			length = sqrtf(bone_pos[0] * bone_pos[0] + bone_pos[1] * bone_pos[1] + bone_pos[2] * bone_pos[2]);
+
+			float axis_x[3], axis_y[3], axis_z[3] = { bone_pos[0], bone_pos[1], bone_pos[2] };
+			legacy_normalize(axis_z);
+			legacy_cross(up, axis_z, axis_x);
+			legacy_normalize(axis_x);
+			legacy_cross(axis_z, axis_x, axis_y);
+			legacy_normalize(axis_y);
+			for (int r = 0; r < 3; r++) {
+				bone_pose.basis[r][0] = axis_x[r];
+				bone_pose.basis[r][1] = axis_y[r];
+				bone_pose.basis[r][2] = axis_z[r];
+			}
+			r_frames->frames[d][b - first_bone] = bone_pose;
+
+			// parent_inverse = bone_pose.inverse() * parent_inverse, our basis is orthonormal so its inverse is its transpose
+			gdlm_bone_frame next_inverse;
+			float origin[3];
+			for (int r = 0; r < 3; r++) {
+				for (int c = 0; c < 3; c++) {
+					next_inverse.basis[r][c] = bone_pose.basis[0][r] * parent_inverse.basis[0][c] + bone_pose.basis[1][r] * parent_inverse.basis[1][c] + bone_pose.basis[2][r] * parent_inverse.basis[2][c];
+				}
+				origin[r] = parent_inverse.origin[r] - bone_pose.origin[r];
+			}
+			for (int r = 0; r < 3; r++) {
+				next_inverse.origin[r] = bone_pose.basis[0][r] * origin[0] + bone_pose.basis[1][r] * origin[1] + bone_pose.basis[2][r] * origin[2];
+			}
+			parent_inverse = next_inverse;
+
+			// our next nodes origin
+			bone_pose.origin[0] = 0.0f;
+			bone_pose.origin[1] = 0.0f;
+			bone_pose.origin[2] = length;
+		}
+
+		// and our finger tip is placed at the end of our last bone
+		gdlm_bone_frame *tip = &r_frames->frames[d][4 - first_bone];
+		for (int r = 0; r < 3; r++) {
+			for (int c = 0; c < 3; c++) {
+				tip->basis[r][c] = r == c ? 1.0f : 0.0f;
+			}
+		}
+		tip->origin[0] = 0.0f;
+		tip->origin[1] = 0.0f;
+		tip->origin[2] = length;
+	}
+}
+
+// Compares gdlm_solve_hand with our legacy solver on p_ticks frames, returns the largest absolute difference.
+static float check_solver(int p_hands, int p_ticks, bench_frames *p_frames) {
+	const float world_scale = 0.001f;
+	gdlm_hand_frames hand_frames;
+	gdlm_hand_frames legacy_frames;
+	gdlm_bone_frame hand_inverse;
+
+	if (p_frames->recorded == NULL) {
+		p_frames->synthetic_source->set_hand_count(p_hands);
+	}
+
+	float max_diff = 0.0f;
+	for (int t = 0; t < p_ticks; t++) {
+		const LEAP_TRACKING_EVENT *frame = p_frames->get(t);
+		for (uint32_t h = 0; h < frame->nHands; h++) {
+			const LEAP_HAND *hand = &frame->pHands[h];
+			palm_inverse(hand, world_scale, &hand_inverse);
+			gdlm_solve_hand(hand, world_scale, hand_inverse, &hand_frames);
+			solve_hand_legacy(hand, world_scale, hand_inverse, &legacy_frames);
+
+			for (int d = 0; d < 5; d++) {
+				// our thumb only uses its first four frames
+				for (int b = 0; b < (d == 0 ? 4 : 5); b++) {
+					const gdlm_bone_frame &a = hand_frames.frames[d][b];
+					const gdlm_bone_frame &l = legacy_frames.frames[d][b];
+					for (int r = 0; r < 3; r++) {
+						for (int c = 0; c < 3; c++) {
+							max_diff = std::max(max_diff, fabsf(a.basis[r][c] - l.basis[r][c]));
+						}
+						max_diff = std::max(max_diff, fabsf(a.origin[r] - l.origin[r]));
+					}
+				}
+			}
+		}
+	}
+
+	return max_diff;
+}
+
+static float sink; // keeps our compiler from optimising our work away
+
+static void run_bench(bench_mode p_mode, int p_hands, int p_ticks, bench_frames *p_frames, const char *p_source) {
+	const float world_scale = 0.001f;
+	const int warmup = p_ticks / 10 + 1;
+
+	// these are big, keep them off our stack
+	GDLMFrameBuffer *frame_buffer = new GDLMFrameBuffer();
+	GDLMFrameHistory *frame_history = new GDLMFrameHistory();
+	gdlm_frame *interpolated = new gdlm_frame;
+	gdlm_hand_frames hand_frames;
+	gdlm_hand_proxies hand_proxies;
+	gdlm_bone_frame hand_inverse;
+	GDLMHandFilter *filters = new GDLMHandFilter[GDLM_MAX_HANDS];
+	LEAP_HAND filtered_hand;
+	gdlm_filter_params filter_params;
+	filter_params.min_cutoff = 1.0f;
+	filter_params.beta = 0.1f;
+	filter_params.d_cutoff = 1.0f;
+	gdlm_filter_params tracker_filter_params[2] = { filter_params, filter_params };
+	gdlm_gesture_params gesture_params;
+	gesture_params.pinch_on = 0.9f;
+	gesture_params.pinch_off = 0.8f;
+	gesture_params.pinch_max_distance = 0.0f;
+	gesture_params.grab_on = 0.9f;
+	gesture_params.grab_off = 0.8f;
+	GDLMHandTrackers *trackers = new GDLMHandTrackers();
+	GDLMHandSlots *slots = new GDLMHandSlots();
+	uint32_t tracker_changes[2];
+	GDLMHandMerger *merger = new GDLMHandMerger();
+	gdlm_frame *merged = new gdlm_frame;
+	gdlm_device_transform transforms[GDLM_MAX_DEVICES];
+	for (int d = 0; d < GDLM_MAX_DEVICES; d++) {
+		transforms[d].rotation.x = 0.0f;
+		transforms[d].rotation.y = 0.0f;
+		transforms[d].rotation.z = 0.0f;
+		transforms[d].rotation.w = 1.0f;
+		transforms[d].origin.x = 0.0f;
+		transforms[d].origin.y = 0.0f;
+		transforms[d].origin.z = 0.0f;
+		transforms[d].is_identity = true;
+	}
+	// our second device sits a little to the side so we really transform its hands
+	transforms[1].origin.x = 2.0f;
+	transforms[1].is_identity = false;
+
+	std::vector<int64_t> samples;
+	samples.resize(p_ticks);
+
+	if (p_frames->recorded == NULL) {
+		p_frames->synthetic_source->set_hand_count(p_hands);
+	}
+
+	int64_t hand_count = 0;
+	uint64_t allocations = 0;
+	for (int t = -warmup; t < p_ticks; t++) {
+		const LEAP_TRACKING_EVENT *event = p_frames->get(t + warmup);
+		uint64_t allocations_before = allocation_count.load(std::memory_order_relaxed);
+		int64_t start = now_ns();
+
+		const LEAP_TRACKING_EVENT *frame = event;
+		if (p_mode != BENCH_SOLVE && p_mode != BENCH_SOLVE_LEGACY && p_mode != BENCH_SLOTS) {
+			// what our leap motion thread does
+			frame_buffer->write(event);
+			frame_history->add(event);
+
+			// and what our physics thread does
+			if (p_mode == BENCH_TICK_INTERPOLATED) {
+				// half a frame in the past, as our HMD prediction tends to be
+				int64_t target = event->info.timestamp - (int64_t)(500000.0f / (event->framerate > 0.0f ? event->framerate : 110.0f));
+				frame = frame_history->interpolate(target, interpolated) ? &interpolated->event : &frame_buffer->read()->event;
+			} else {
+				frame = &frame_buffer->read()->event;
+			}
+
+			if (p_mode == BENCH_TICK_MERGED) {
+				const LEAP_TRACKING_EVENT *device_frames[GDLM_MAX_DEVICES] = { frame, frame };
+				if (merger->merge(device_frames, transforms, merged)) {
+					frame = &merged->event;
+				}
+			}
+		}
+
+		if (p_mode == BENCH_TICK_TRACKERS) {
+			// our trackers follow the first left and right hand, without solving any bones
+			trackers->update(frame, tracker_filter_params, gesture_params, 60, true, tracker_changes);
+			sink += trackers->get_tracker(1).pose.origin[2];
+		}
+
+		if (p_mode == BENCH_SLOTS) {
+			// new leap ids every so often so hands get lost, pooled and taken from our pool again
+			uint32_t id_offset = (uint32_t)((t + warmup) / GDLM_BENCH_CHURN_TICKS) * GDLM_MAX_HANDS;
+			slots->begin_frame();
+			for (uint32_t h = 0; h < frame->nHands; h++) {
+				int type = frame->pHands[h].type == eLeapHandType_Left ? 0 : 1;
+				uint32_t leap_id = frame->pHands[h].id + id_offset;
+				int slot = slots->find(type, leap_id);
+				if (slot == -1) {
+					slot = slots->find_lost(type);
+				}
+				if (slot == -1) {
+					slot = slots->take_from_pool(type);
+				}
+				if (slot == -1) {
+					slot = slots->acquire(type);
+				}
+				if (slot != -1) {
+					slots->bind(type, slot, leap_id);
+					slots->mark_active(type, slot);
+					sink += (float)slot;
+				}
+			}
+
+			// hands we didn't see go straight back into our pool
+			for (int type = 0; type < 2; type++) {
+				for (uint32_t inactive = slots->get_used_mask(type) & ~slots->get_active_mask(type); inactive != 0; inactive &= inactive - 1) {
+					int slot = GDLMHandSlots::lowest_slot(inactive);
+					slots->unbind(type, slot);
+					slots->add_to_pool(type, slot);
+				}
+			}
+		}
+
+		for (uint32_t h = 0; h < frame->nHands && p_mode != BENCH_TICK_TRACKERS && p_mode != BENCH_SLOTS; h++) {
+			const LEAP_HAND *hand = &frame->pHands[h];
+			if (p_mode == BENCH_TICK_FILTERED) {
+				filters[h].filter(hand, frame->info.timestamp, filter_params, &filtered_hand);
+				hand = &filtered_hand;
+			}
+			if (p_mode == BENCH_TICK_ROTATIONS) {
+				gdlm_solve_hand_rotations(hand, world_scale, &hand_frames);
+			} else if (p_mode == BENCH_SOLVE_LEGACY) {
+				palm_inverse(hand, world_scale, &hand_inverse);
+				solve_hand_legacy(hand, world_scale, hand_inverse, &hand_frames);
+			} else {
+				palm_inverse(hand, world_scale, &hand_inverse);
+				gdlm_solve_hand(hand, world_scale, hand_inverse, &hand_frames);
+			}
+			if (p_mode == BENCH_TICK_PROXIES) {
+				gdlm_solve_proxies(hand, world_scale, hand_inverse, &hand_proxies);
+				sink += hand_proxies.proxies[h % GDLM_HAND_PROXIES].frame.origin[2];
+			}
+			sink += hand_frames.frames[h % 5][1].origin[2];
+		}
+
+		int64_t end = now_ns();
+		if (t >= 0) {
+			samples[t] = end - start;
+			hand_count += frame->nHands;
+			allocations += allocation_count.load(std::memory_order_relaxed) - allocations_before;
+		}
+	}
+
+	delete slots;
+	delete trackers;
+	delete merged;
+	delete merger;
+	delete[] filters;
+	delete interpolated;
+	delete frame_history;
+	delete frame_buffer;
+
+	int64_t total = 0;
+	for (int t = 0; t < p_ticks; t++) {
+		total += samples[t];
+	}
+	std::sort(samples.begin(), samples.end());
+
+	size_t n = samples.size();
+	printf("{\"benchmark\": \"%s\", \"source\": \"%s\", \"hands\": %i, \"ticks\": %i, "
+		   "\"ns_per_tick\": %.1f, \"ns_per_hand\": %.1f, \"allocations_per_tick\": %.3f, "
+		   "\"p50_ns\": %lld, \"p99_ns\": %lld, \"p999_ns\": %lld, \"max_ns\": %lld}\n",
+			bench_names[p_mode],
+			p_source,
+			p_hands,
+			p_ticks,
+			(double)total / (double)p_ticks,
+			hand_count > 0 ? (double)total / (double)hand_count : 0.0,
+			(double)allocations / (double)p_ticks,
+			(long long)samples[std::min(n - 1, n * 50 / 100)],
+			(long long)samples[std::min(n - 1, n * 99 / 100)],
+			(long long)samples[std::min(n - 1, n * 999 / 1000)],
+			(long long)samples[n - 1]);
+}
+
+// Prints our solver check as a line of JSON, returns false if our solvers are too far apart.
+static bool report_solver_check(float p_max_diff, const char *p_source) {
+	printf("{\"check\": \"solve_hand_legacy\", \"source\": \"%s\", \"max_abs_diff\": %g, \"tolerance\": %g}\n",
+			p_source,
+			p_max_diff,
+			GDLM_BENCH_SOLVER_TOLERANCE);
+	if (!(p_max_diff <= GDLM_BENCH_SOLVER_TOLERANCE)) {
+		fprintf(stderr, "gdlm_solve_hand differs from our legacy solver by %g\n", p_max_diff);
+		return false;
+	}
+	return true;
+}
+
+// Hands our camera images from our leap motion thread to our main thread, like our image stream does when images are enabled.
+static void run_image_bench(int p_downsample, int p_ticks, GDLMSyntheticSource *p_synthetic_source) {
+	const int warmup = p_ticks / 10 + 1;
+
+	GDLMImageStream *image_stream = new GDLMImageStream();
+	image_stream->set_enabled(true);
+	gdlm_image_settings settings = image_stream->get_settings();
+	settings.downsample = p_downsample;
+	image_stream->set_settings(settings);
+	p_synthetic_source->set_images_enabled(true);
+	p_synthetic_source->set_hand_count(2);
+
+	std::vector<int64_t> samples;
+	samples.resize(p_ticks);
+
+	uint64_t allocations = 0;
+	uint32_t width = 0;
+	uint32_t height = 0;
+	for (int t = -warmup; t < p_ticks; t++) {
+		// drawing our images isn't part of our timing
+		const LEAP_IMAGE_EVENT *event = p_synthetic_source->generate_images(p_synthetic_source->generate(t + warmup));
+		uint64_t allocations_before = allocation_count.load(std::memory_order_relaxed);
+		int64_t start = now_ns();
+
+		image_stream->write(event);
+		const gdlm_image_pair *pair = image_stream->read();
+		if (pair != NULL) {
+			width = pair->width;
+			height = pair->height;
+			sink += pair->pixels[0][(pair->height / 2) * pair->width + pair->width / 2];
+		}
+
+		int64_t end = now_ns();
+		if (t >= 0) {
+			samples[t] = end - start;
+			allocations += allocation_count.load(std::memory_order_relaxed) - allocations_before;
+		}
+	}
+
+	delete image_stream;
+
+	int64_t total = 0;
+	for (int t = 0; t < p_ticks; t++) {
+		total += samples[t];
+	}
+	std::sort(samples.begin(), samples.end());
+
+	size_t n = samples.size();
+	printf("{\"benchmark\": \"image_stream\", \"source\": \"synthetic\", \"downsample\": %i, \"width\": %u, \"height\": %u, \"ticks\": %i, "
+		   "\"ns_per_tick\": %.1f, \"allocations_per_tick\": %.3f, "
+		   "\"p50_ns\": %lld, \"p99_ns\": %lld, \"p999_ns\": %lld, \"max_ns\": %lld}\n",
+			p_downsample,
+			width,
+			height,
+			p_ticks,
+			(double)total / (double)p_ticks,
+			(double)allocations / (double)p_ticks,
+			(long long)samples[std::min(n - 1, n * 50 / 100)],
+			(long long)samples[std::min(n - 1, n * 99 / 100)],
+			(long long)samples[std::min(n - 1, n * 999 / 1000)],
+			(long long)samples[n - 1]);
+}
+
+int main(int argc, char **argv) {
+	int ticks = 100000;
+	const char *recording_path = NULL;
+
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--ticks") == 0 && i + 1 < argc) {
+			ticks = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "--recording") == 0 && i + 1 < argc) {
+			recording_path = argv[++i];
+		} else {
+			fprintf(stderr, "usage: %s [--ticks n] [--recording file.gdlmrec]\n", argv[0]);
+			return 1;
+		}
+	}
+	if (ticks < 1) {
+		ticks = 1;
+	}
+
+	bench_frames frames;
+	frames.synthetic_source = new GDLMSyntheticSource();
+	frames.recorded = NULL;
+	frames.recorded_span = 0;
+
+	// our solver has to give the same frames as our legacy solver or our timings mean nothing
+	if (!report_solver_check(check_solver(GDLM_MAX_HANDS, ticks / 10 + 1, &frames), "synthetic")) {
+		return 1;
+	}
+
+	// our synthetic hands, 1 and 2 hands as you'd normally see and as many as fit in our frames
+	const int hand_counts[] = { 1, 2, GDLM_MAX_HANDS };
+	for (int m = BENCH_SOLVE; m < BENCH_MAX; m++) {
+		for (int c = 0; c < 3; c++) {
+			run_bench((bench_mode)m, hand_counts[c], ticks, &frames, "synthetic");
+		}
+	}
+
+	// our camera images at full resolution and downsampled, our image bench draws fewer frames as each is much bigger
+	const int downsamples[] = { 1, 2, 3, 4 };
+	for (int d = 0; d < (int)(sizeof(downsamples) / sizeof(downsamples[0])); d++) {
+		run_image_bench(downsamples[d], ticks / 10 + 1, frames.synthetic_source);
+	}
+
+	if (recording_path != NULL) {
+		GDLMRecording recording;
+		if (!recording.open(recording_path)) {
+			fprintf(stderr, "couldn't open recording %s\n", recording_path);
+			return 1;
+		}
+
+		// copy our recording so reading it isn't part of our timing
+		std::vector<gdlm_frame> recorded;
+		LEAP_TRACKING_EVENT event;
+		int64_t received;
+		size_t offset = recording.first();
+		int max_hands = 0;
+		while (recording.read(&offset, &event, &received)) {
+			recorded.resize(recorded.size() + 1);
+			gdlm_copy_frame(&recorded.back(), &event);
+			max_hands = std::max(max_hands, (int)event.nHands);
+		}
+		recording.close();
+
+		if (recorded.empty()) {
+			fprintf(stderr, "recording %s is empty\n", recording_path);
+			return 1;
+		}
+
+		// our copies point into their own hands, fix them up now our vector no longer moves
+		for (size_t i = 0; i < recorded.size(); i++) {
+			recorded[i].event.pHands = recorded[i].hands;
+		}
+
+		frames.recorded = &recorded;
+		frames.recorded_span = recorded.back().event.info.timestamp - recorded.front().event.info.timestamp;
+		if (!report_solver_check(check_solver(max_hands, (int)recorded.size(), &frames), "recording")) {
+			return 1;
+		}
+		for (int m = BENCH_SOLVE; m < BENCH_MAX; m++) {
+			run_bench((bench_mode)m, max_hands, ticks, &frames, "recording");
+		}
+	}
+
+	delete frames.synthetic_source;
+
+	// print our sink so it can't be optimised away, on stderr so our output stays clean
+	fprintf(stderr, "%f\n", sink);
+
+	return 0;
+}
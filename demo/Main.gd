@@ -15,10 +15,6 @@ func _on_Quit_pressed():
 
 func _on_Leap_Motion_new_hand(hand):
 	print("New hand " + str(hand))
-	
-	# register some events on the new hand
-	hand.connect("pinched", self, "pinched")
-	hand.connect("grabbed", self, "grabbed")
 
 func _on_Leap_Motion_about_to_remove_hand(hand):
 	print("Removing hand " + str(hand))
@@ -0,0 +1,82 @@
+extends Node
+
+####################################################################################
+# Times the physics tick of our leap motion node with our node based hand scenes
+# and with our skeleton based hand scenes, switching between them every run.
+# Add this as a child of your leap motion node and watch the output. We switch
+# our leap motion node to its synthetic source so every run sees the same hands.
+#
+# We read OS.get_ticks_usec() just before and just after every other node does
+# its physics processing, so anything else in your scene with a process_priority
+# between ours is timed as well. Keep the scene otherwise empty for clean numbers.
+
+export (int) var ticks_per_run = 600
+export (int) var settle_ticks = 60
+export (int) var synthetic_hands = 2
+
+const scene_sets = [
+	[ "nodes", "res://addons/gdleapmotion/scenes/left_hand.tscn", "res://addons/gdleapmotion/scenes/right_hand.tscn" ],
+	[ "skeleton", "res://addons/gdleapmotion/scenes/left_hand_skeleton.tscn", "res://addons/gdleapmotion/scenes/right_hand_skeleton.tscn" ]
+]
+
+# Runs after every other node so it can stop our clock.
+class TickEnd:
+	extends Node
+
+	var timing = null
+
+	func _physics_process(delta):
+		timing.end_tick()
+
+var sensor = null
+var scene_set = 0
+var tick = 0
+var start_usec = 0
+var total_usec = 0
+var max_usec = 0
+
+func _ready():
+	sensor = get_parent()
+
+	# hands only get our new scene once they are gone, so we let them go straight away
+	sensor.frame_source = 1
+	sensor.keep_hands_for_frames = 0
+	sensor.keep_last_hand = false
+
+	# we start before everything else, our TickEnd node stops after everything else
+	process_priority = -1000
+	var tick_end = TickEnd.new()
+	tick_end.timing = self
+	tick_end.process_priority = 1000
+	add_child(tick_end)
+
+	start_run()
+
+func start_run():
+	# Remove our hands for a bit so they are replaced by our new scenes,
+	# then give them time to be instanced before we start counting.
+	sensor.synthetic_hands = 0
+	sensor.left_hand_scene = scene_sets[scene_set][1]
+	sensor.right_hand_scene = scene_sets[scene_set][2]
+	tick = -2 * settle_ticks
+	total_usec = 0
+	max_usec = 0
+
+func _physics_process(delta):
+	start_usec = OS.get_ticks_usec()
+
+func end_tick():
+	var usec = OS.get_ticks_usec() - start_usec
+
+	tick += 1
+	if tick == -settle_ticks:
+		sensor.synthetic_hands = synthetic_hands
+	if tick <= 0:
+		return
+
+	total_usec += usec
+	max_usec = max(max_usec, usec)
+	if tick == ticks_per_run:
+		print("LeapMotion - %s hand scenes: %.1f usec per physics tick on average, %d usec max" % [ scene_sets[scene_set][0], float(total_usec) / ticks_per_run, max_usec ])
+		scene_set = (scene_set + 1) % scene_sets.size()
+		start_run()
@@ -0,0 +1,231 @@
+#include "gdlm_clock_sync.h"
+
+#include <algorithm>
+#include <chrono>
+#include <math.h>
+
+using namespace godot;
+
+GDLMClockSync::GDLMClockSync() {
+	reset();
+}
+
+int64_t GDLMClockSync::get_local_usec() {
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void GDLMClockSync::reset() {
+	godot_count = 0;
+	segment_count = 0;
+	source_count = 0;
+	godot_resolution = 1;
+
+	std::lock_guard<std::mutex> lock(estimate_mutex);
+	has_estimate = false;
+	godot_reference = 0;
+	godot_offset = 0.0;
+	godot_drift = 0.0;
+	reference_local = 0;
+	source_offset = 0.0;
+	source_drift = 0.0;
+	stats.samples = 0;
+	stats.offset = 0;
+	stats.drift_ppm = 0.0;
+	stats.godot_drift_ppm = 0.0;
+	stats.jitter = 0.0f;
+	stats.error = 0.0f;
+}
+
+void GDLMClockSync::add_godot_sample(int64_t p_godot_usec, int64_t p_resolution_usec, int64_t p_local_usec) {
+	godot_sample &sample = godot_samples[godot_count % GDLM_CLOCK_SAMPLES];
+	sample.local = p_local_usec;
+	sample.offset = p_local_usec - p_godot_usec;
+	godot_count++;
+
+	// keep the sample that was least behind in each segment for working out our drift
+	if (godot_count % GDLM_CLOCK_SEGMENT_SAMPLES == 1 || sample.offset < segment_minimum.offset) {
+		segment_minimum = sample;
+	}
+	if (godot_count % GDLM_CLOCK_SEGMENT_SAMPLES == 0) {
+		segment_minimums[segment_count % GDLM_CLOCK_SEGMENTS] = segment_minimum;
+		segment_count++;
+	}
+	godot_resolution = p_resolution_usec < 1 ? 1 : p_resolution_usec;
+}
+
+void GDLMClockSync::add_source_sample(int64_t p_local_before, int64_t p_source_usec, int64_t p_local_after) {
+	if (p_local_after - p_local_before > GDLM_CLOCK_MAX_READ_USEC) {
+		// we got interrupted while reading, we don't know when our source clock was read
+		return;
+	}
+
+	source_sample &sample = source_samples[source_count % GDLM_CLOCK_SAMPLES];
+	sample.local = p_local_before + (p_local_after - p_local_before) / 2;
+	sample.source = p_source_usec;
+	source_count++;
+
+	update_estimate();
+}
+
+void GDLMClockSync::update_estimate() {
+	int godot_size = (int)std::min(godot_count, (uint64_t)GDLM_CLOCK_SAMPLES);
+	int source_size = (int)std::min(source_count, (uint64_t)GDLM_CLOCK_SAMPLES);
+	if (godot_size == 0 || source_size < GDLM_CLOCK_MIN_SAMPLES) {
+		return;
+	}
+
+	// Each Godot sample is behind by somewhere between 0 and our resolution plus our read time, so we fit
+	// offset = godot_offset + godot_drift * (local - reference) through the samples that were least behind
+	// in each of our segments for our drift, then move our line down to the sample least behind overall.
+	int64_t new_godot_reference = godot_samples[(godot_count - 1) % GDLM_CLOCK_SAMPLES].local;
+	double new_godot_drift = 0.0;
+	int segments = (int)std::min(segment_count, (uint64_t)GDLM_CLOCK_SEGMENTS);
+	if (segments > 1) {
+		double x[GDLM_CLOCK_SEGMENTS];
+		double y[GDLM_CLOCK_SEGMENTS];
+		double mean_x = 0.0, mean_y = 0.0;
+		for (int i = 0; i < segments; i++) {
+			x[i] = (double)(segment_minimums[i].local - new_godot_reference);
+			y[i] = (double)(segment_minimums[i].offset - segment_minimums[0].offset);
+			mean_x += x[i];
+			mean_y += y[i];
+		}
+		mean_x /= segments;
+		mean_y /= segments;
+
+		double sxx = 0.0, sxy = 0.0;
+		for (int i = 0; i < segments; i++) {
+			sxx += (x[i] - mean_x) * (x[i] - mean_x);
+			sxy += (x[i] - mean_x) * (y[i] - mean_y);
+		}
+		new_godot_drift = sxx > 1.0 ? sxy / sxx : 0.0;
+	}
+
+	double new_godot_offset = 0.0;
+	for (int i = 0; i < godot_size; i++) {
+		double offset = (double)godot_samples[i].offset - new_godot_drift * (double)(godot_samples[i].local - new_godot_reference);
+		new_godot_offset = i == 0 ? offset : std::min(new_godot_offset, offset);
+	}
+
+	// fit source - local = offset + drift * (local - reference) through our samples, relative to our newest sample
+	int64_t reference = source_samples[(source_count - 1) % GDLM_CLOCK_SAMPLES].local;
+	double x[GDLM_CLOCK_SAMPLES];
+	double y[GDLM_CLOCK_SAMPLES];
+	bool inlier[GDLM_CLOCK_SAMPLES];
+	for (int i = 0; i < source_size; i++) {
+		x[i] = (double)(source_samples[i].local - reference);
+		y[i] = (double)(source_samples[i].source - source_samples[i].local);
+		inlier[i] = true;
+	}
+
+	double offset = 0.0;
+	double drift = 0.0;
+	double residuals[GDLM_CLOCK_SAMPLES];
+	int inliers = source_size;
+
+	// we fit twice, our second fit ignores the samples that were far off our first
+	for (int pass = 0; pass < 2; pass++) {
+		double mean_x = 0.0, mean_y = 0.0;
+		for (int i = 0; i < source_size; i++) {
+			if (inlier[i]) {
+				mean_x += x[i];
+				mean_y += y[i];
+			}
+		}
+		mean_x /= inliers;
+		mean_y /= inliers;
+
+		double sxx = 0.0, sxy = 0.0;
+		for (int i = 0; i < source_size; i++) {
+			if (inlier[i]) {
+				sxx += (x[i] - mean_x) * (x[i] - mean_x);
+				sxy += (x[i] - mean_x) * (y[i] - mean_y);
+			}
+		}
+
+		// if all our samples were taken at about the same time we can't tell our drift
+		drift = sxx > 1.0 ? sxy / sxx : 0.0;
+		offset = mean_y - drift * mean_x;
+
+		if (pass == 1) {
+			break;
+		}
+
+		// reject anything further off than 3 sigma, estimated from our median absolute residual,
+		// but don't go below a few microseconds or we'd reject half our samples on a quiet clock
+		for (int i = 0; i < source_size; i++) {
+			residuals[i] = fabs(y[i] - (offset + drift * x[i]));
+		}
+		double sorted[GDLM_CLOCK_SAMPLES];
+		std::copy(residuals, residuals + source_size, sorted);
+		std::nth_element(sorted, sorted + source_size / 2, sorted + source_size);
+		double threshold = std::max(3.0 * 1.4826 * sorted[source_size / 2], 5.0);
+
+		int count = 0;
+		for (int i = 0; i < source_size; i++) {
+			inlier[i] = residuals[i] <= threshold;
+			count += inlier[i] ? 1 : 0;
+		}
+		if (count < GDLM_CLOCK_MIN_SAMPLES) {
+			// our samples are all over the place, better use them all than trust a few
+			for (int i = 0; i < source_size; i++) {
+				inlier[i] = true;
+			}
+			count = source_size;
+		}
+		inliers = count;
+	}
+
+	double sum_squares = 0.0;
+	for (int i = 0; i < source_size; i++) {
+		if (inlier[i]) {
+			double residual = y[i] - (offset + drift * x[i]);
+			sum_squares += residual * residual;
+		}
+	}
+	double jitter = sqrt(sum_squares / inliers);
+
+	// Our fit is off by about our jitter over the square root of our sample count, our Godot offset
+	// by about our resolution over our sample count, as that is how close our best sample is expected to be.
+	double error = jitter / sqrt((double)inliers) + (double)godot_resolution / (double)(godot_size + 1);
+
+	std::lock_guard<std::mutex> lock(estimate_mutex);
+	has_estimate = true;
+	godot_reference = new_godot_reference;
+	godot_offset = new_godot_offset;
+	godot_drift = new_godot_drift;
+	reference_local = reference;
+	source_offset = offset;
+	source_drift = drift;
+	stats.samples = inliers;
+	stats.offset = (int64_t)llround(new_godot_offset + offset);
+	stats.drift_ppm = drift * 1000000.0;
+	stats.godot_drift_ppm = new_godot_drift * 1000000.0;
+	stats.jitter = (float)jitter;
+	stats.error = (float)error;
+}
+
+bool GDLMClockSync::godot_to_source(int64_t p_godot_usec, int64_t *r_source_usec) const {
+	std::lock_guard<std::mutex> lock(estimate_mutex);
+	if (!has_estimate) {
+		return false;
+	}
+
+	// our Godot offset depends on our local time, which we first estimate without drift
+	double local_estimate = (double)p_godot_usec + godot_offset;
+	int64_t local = p_godot_usec + (int64_t)llround(godot_offset + godot_drift * (local_estimate - (double)godot_reference));
+	double source_minus_local = source_offset + source_drift * (double)(local - reference_local);
+	*r_source_usec = local + (int64_t)llround(source_minus_local);
+
+	return true;
+}
+
+bool GDLMClockSync::get_stats(gdlm_clock_stats *r_stats) const {
+	std::lock_guard<std::mutex> lock(estimate_mutex);
+	if (!has_estimate) {
+		return false;
+	}
+
+	*r_stats = stats;
+	return true;
+}
@@ -0,0 +1,101 @@
+#ifndef GDLM_CLOCK_SYNC_H
+#define GDLM_CLOCK_SYNC_H
+
+#include <mutex>
+#include <stdint.h>
+
+// Number of clock samples we estimate our offsets from, at 110Hz this is a little over a second.
+#define GDLM_CLOCK_SAMPLES 128
+
+// Samples where reading our source clock took longer than this, in microseconds, were probably
+// interrupted by our OS and tell us little about when our source clock was read.
+#define GDLM_CLOCK_MAX_READ_USEC 200
+
+// We work out how Godots clock drifts from the Godot sample that was least behind in each segment of this many
+// samples, over this many segments. That is a few seconds so even a millisecond clock gives us a usable drift.
+#define GDLM_CLOCK_SEGMENT_SAMPLES 32
+#define GDLM_CLOCK_SEGMENTS 16
+
+// Minimum number of samples we want before we trust our estimate.
+#define GDLM_CLOCK_MIN_SAMPLES 8
+
+namespace godot {
+
+struct gdlm_clock_stats {
+	int samples; // source samples our estimate is based on, after rejecting outliers
+	int64_t offset; // source clock minus Godots clock in microseconds
+	double drift_ppm; // how much faster our source clock runs than our local clock in parts per million
+	double godot_drift_ppm; // how much faster our local clock runs than Godots clock in parts per million
+	float jitter; // RMS of our source samples around our estimate in microseconds
+	float error; // estimated error of our conversions in microseconds
+};
+
+// Works out the relation between Godots clock and the clock of a frame source, in microseconds.
+// We relate both clocks to our own steady clock:
+// - Godots clock is read just before our clock so every sample of it is behind by however long that took,
+//   plus up to its resolution if it is truncated. Godot may read a different monotonic clock than ours
+//   so we fit a line along the samples that were least behind over a few seconds for our drift,
+//   the sample furthest below that line in our recent samples gives us our offset.
+// - Our source clock may drift so we fit a line through our samples, rejecting outliers, which gives us
+//   offset, drift and jitter.
+// Samples are added from our leap motion thread, conversions are done from Godots thread.
+class GDLMClockSync {
+private:
+	struct godot_sample {
+		int64_t local;
+		int64_t offset; // our clock minus Godots clock
+	};
+
+	struct source_sample {
+		int64_t local; // midpoint of our local reads around reading our source clock
+		int64_t source;
+	};
+
+	// only used by our leap motion thread
+	// our counts only ever go up, they're unsigned and wide enough that they can't overflow into negative indices
+	godot_sample godot_samples[GDLM_CLOCK_SAMPLES];
+	uint64_t godot_count;
+	godot_sample segment_minimum; // least behind sample in our current segment
+	godot_sample segment_minimums[GDLM_CLOCK_SEGMENTS];
+	uint64_t segment_count;
+	source_sample source_samples[GDLM_CLOCK_SAMPLES];
+	uint64_t source_count;
+	int64_t godot_resolution;
+
+	// our estimate, guarded by our mutex
+	mutable std::mutex estimate_mutex;
+	bool has_estimate;
+	int64_t godot_reference; // local time our Godot offset and drift relate to
+	double godot_offset; // our local clock minus Godots clock at godot_reference
+	double godot_drift; // local clock change per Godot clock change, minus one
+	int64_t reference_local; // local time our source offset and drift relate to
+	double source_offset; // source clock minus local clock at reference_local
+	double source_drift; // source clock change per local clock change, minus one
+	gdlm_clock_stats stats;
+
+	void update_estimate();
+
+public:
+	GDLMClockSync();
+
+	// our local steady clock in microseconds
+	static int64_t get_local_usec();
+
+	void reset();
+
+	// p_godot_usec was read from Godots clock, which has a resolution of p_resolution_usec, just before p_local_usec
+	void add_godot_sample(int64_t p_godot_usec, int64_t p_resolution_usec, int64_t p_local_usec);
+
+	// p_source_usec was read from our source clock between p_local_before and p_local_after
+	void add_source_sample(int64_t p_local_before, int64_t p_source_usec, int64_t p_local_after);
+
+	// converts a time on Godots clock to our source clock, returns false if we don't have enough samples yet
+	bool godot_to_source(int64_t p_godot_usec, int64_t *r_source_usec) const;
+
+	// returns false if we don't have enough samples yet
+	bool get_stats(gdlm_clock_stats *r_stats) const;
+};
+
+} // namespace godot
+
+#endif /* !GDLM_CLOCK_SYNC_H */
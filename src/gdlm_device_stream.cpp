@@ -0,0 +1,59 @@
+#include "gdlm_device_stream.h"
+
+#include <string.h>
+
+using namespace godot;
+
+GDLMDeviceStream::GDLMDeviceStream() {
+	attached.store(false);
+	generation.store(0);
+	device_id = 0;
+	serial[0] = '\0';
+	last_received_id = 0;
+}
+
+void GDLMDeviceStream::attach(uint32_t p_device_id, const char *p_serial) {
+	info_mutex.lock();
+	device_id = p_device_id;
+	strncpy(serial, p_serial == NULL ? "" : p_serial, GDLM_MAX_SERIAL - 1);
+	serial[GDLM_MAX_SERIAL - 1] = '\0';
+	info_mutex.unlock();
+
+	// frame ids start over for another device
+	write_mutex.lock();
+	last_received_id = 0;
+	write_mutex.unlock();
+
+	generation.fetch_add(1, std::memory_order_release);
+	attached.store(true, std::memory_order_release);
+}
+
+void GDLMDeviceStream::detach() {
+	attached.store(false, std::memory_order_release);
+}
+
+uint32_t GDLMDeviceStream::get_serial(char *r_serial) const {
+	std::lock_guard<std::mutex> guard(info_mutex);
+	memcpy(r_serial, serial, GDLM_MAX_SERIAL);
+	return generation.load(std::memory_order_acquire);
+}
+
+bool GDLMDeviceStream::has_serial(const char *p_serial) const {
+	std::lock_guard<std::mutex> guard(info_mutex);
+	return strncmp(serial, p_serial, GDLM_MAX_SERIAL - 1) == 0;
+}
+
+int64_t GDLMDeviceStream::write(const LEAP_TRACKING_EVENT *p_event) {
+	std::lock_guard<std::mutex> guard(write_mutex);
+
+	// Our frame source only guarantees this pointer until its next poll so we make a deep copy.
+	// Our frame buffer is preallocated so this doesn't allocate and it doesn't block Godots thread.
+	frame_buffer.write(p_event);
+
+	// and remember it in our history so we can interpolate and predict frames
+	frame_history.add(p_event);
+
+	int64_t previous_id = last_received_id;
+	last_received_id = p_event->info.frame_id;
+	return previous_id;
+}
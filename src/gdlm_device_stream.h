@@ -0,0 +1,58 @@
+#ifndef GDLM_DEVICE_STREAM_H
+#define GDLM_DEVICE_STREAM_H
+
+#include <atomic>
+#include <mutex>
+#include <stdint.h>
+
+#include "gdlm_frame_buffer.h"
+#include "gdlm_frame_history.h"
+#include "gdlm_frame_source.h"
+
+namespace godot {
+
+// The frames of one device on their way from our leap motion thread to Godot.
+// Each device has its own frame buffer and history so devices never wait on each other,
+// our streams are only combined once Godot picks up their frames.
+// Devices are attached and removed by our leap motion thread, which is also the only thread that writes frames
+// except while we play back a recording.
+class GDLMDeviceStream {
+private:
+	std::atomic<bool> attached;
+	std::atomic<uint32_t> generation; // goes up whenever a device is attached, so readers know to refresh what they know about it
+	uint32_t device_id; // id our frame source gives this device, only written by our leap motion thread
+	char serial[GDLM_MAX_SERIAL]; // guarded by info_mutex
+	mutable std::mutex info_mutex; // only taken when a device is attached or a reader refreshes
+	std::mutex write_mutex; // our buffer and history only allow one writer, this only gets contested when we start or stop playback
+	int64_t last_received_id; // frame id of the last frame written, guarded by write_mutex
+
+	GDLMFrameBuffer frame_buffer;
+	GDLMFrameHistory frame_history;
+
+public:
+	GDLMDeviceStream();
+
+	// called from our leap motion thread
+	void attach(uint32_t p_device_id, const char *p_serial);
+	void detach();
+	uint32_t get_device_id() const { return device_id; }
+
+	bool is_attached() const { return attached.load(std::memory_order_acquire); }
+	uint32_t get_generation() const { return generation.load(std::memory_order_acquire); }
+
+	// copies our serial into r_serial, which has room for GDLM_MAX_SERIAL characters, returns our generation at the time
+	uint32_t get_serial(char *r_serial) const;
+	// returns true if our serial is p_serial
+	bool has_serial(const char *p_serial) const;
+
+	// deep copies our event into our frame buffer and history, returns the frame id of the frame we wrote before, or 0
+	int64_t write(const LEAP_TRACKING_EVENT *p_event);
+
+	// called from Godots thread, see GDLMFrameBuffer::read
+	const gdlm_frame *read() { return frame_buffer.read(); }
+	const GDLMFrameHistory &get_history() const { return frame_history; }
+};
+
+} // namespace godot
+
+#endif /* !GDLM_DEVICE_STREAM_H */
@@ -0,0 +1,54 @@
+#include "gdlm_frame_buffer.h"
+
+#include <string.h>
+
+using namespace godot;
+
+void godot::gdlm_copy_frame(gdlm_frame *r_frame, const LEAP_TRACKING_EVENT *p_event) {
+	uint32_t hand_count = p_event->nHands;
+	if (hand_count > GDLM_MAX_HANDS) {
+		hand_count = GDLM_MAX_HANDS;
+	}
+
+	// copy our header, then point to our own copy of the hands
+	r_frame->event = *p_event;
+	r_frame->event.info.reserved = NULL;
+	r_frame->event.nHands = hand_count;
+	r_frame->event.pHands = r_frame->hands;
+
+	if (hand_count > 0) {
+		memcpy(r_frame->hands, p_event->pHands, sizeof(LEAP_HAND) * hand_count);
+	}
+}
+
+GDLMFrameBuffer::GDLMFrameBuffer() {
+	memset(frames, 0, sizeof(frames));
+	for (int i = 0; i < 3; i++) {
+		frames[i].event.pHands = frames[i].hands;
+	}
+
+	front = 0;
+	middle.store(1);
+	back = 2;
+	has_frame = false;
+}
+
+void GDLMFrameBuffer::write(const LEAP_TRACKING_EVENT *p_event) {
+	gdlm_copy_frame(&frames[back], p_event);
+
+	// publish our back buffer and take whatever was in the middle as our new back buffer,
+	// if the reader never picked that up it was simply a frame we skipped.
+	uint32_t old_middle = middle.exchange(back | NEW_FRAME, std::memory_order_acq_rel);
+	back = old_middle & INDEX_MASK;
+}
+
+const gdlm_frame *GDLMFrameBuffer::read() {
+	if ((middle.load(std::memory_order_relaxed) & NEW_FRAME) != 0) {
+		// swap our front buffer with the newly published middle buffer
+		uint32_t old_middle = middle.exchange(front, std::memory_order_acq_rel);
+		front = old_middle & INDEX_MASK;
+		has_frame = true;
+	}
+
+	return has_frame ? &frames[front] : NULL;
+}
@@ -0,0 +1,55 @@
+#ifndef GDLM_FRAME_BUFFER_H
+#define GDLM_FRAME_BUFFER_H
+
+#include <atomic>
+#include <stdint.h>
+
+// our leap motion data structures
+#include "gdlm_leap_types.h"
+
+// We preallocate room for this many hands per frame, LeapC will in practice only report one of each.
+#define GDLM_MAX_HANDS 8
+
+namespace godot {
+
+// A deep copy of a LEAP_TRACKING_EVENT, event.pHands points into our own hands array.
+// Never copy this struct with a plain assignment, use gdlm_copy_frame so pHands is fixed up.
+struct gdlm_frame {
+	LEAP_TRACKING_EVENT event;
+	LEAP_HAND hands[GDLM_MAX_HANDS];
+};
+
+// copy a tracking event including all its hands into our frame, hands beyond GDLM_MAX_HANDS are dropped
+void gdlm_copy_frame(gdlm_frame *r_frame, const LEAP_TRACKING_EVENT *p_event);
+
+// Triple buffer for handing frames from our leap motion thread to Godots physics thread.
+// The writer always has a back buffer to fill, the reader always has a front buffer to read,
+// the buffer in the middle is swapped with a single atomic exchange by either side.
+// There is exactly one writer thread and one reader thread.
+class GDLMFrameBuffer {
+private:
+	enum {
+		INDEX_MASK = 0x03,
+		NEW_FRAME = 0x04
+	};
+
+	gdlm_frame frames[3];
+	std::atomic<uint32_t> middle; // index of our middle buffer, NEW_FRAME is set if the writer published into it
+	uint32_t back; // only accessed by our writer
+	uint32_t front; // only accessed by our reader
+	bool has_frame; // only accessed by our reader, false until we've received our first frame
+
+public:
+	GDLMFrameBuffer();
+
+	// called from the writer, deep copies our event into the back buffer and publishes it
+	void write(const LEAP_TRACKING_EVENT *p_event);
+
+	// called from the reader, returns our latest complete frame or NULL if we haven't received one yet.
+	// The frame stays valid and unchanged until the next call to read.
+	const gdlm_frame *read();
+};
+
+} // namespace godot
+
+#endif /* !GDLM_FRAME_BUFFER_H */
@@ -0,0 +1,233 @@
+#include "gdlm_frame_history.h"
+
+#include <math.h>
+#include <string.h>
+
+using namespace godot;
+
+static inline float lerp_float(float p_a, float p_b, float p_t) {
+	return p_a + (p_b - p_a) * p_t;
+}
+
+static inline void lerp_vector(LEAP_VECTOR *r_vector, const LEAP_VECTOR &p_a, const LEAP_VECTOR &p_b, float p_t) {
+	r_vector->x = lerp_float(p_a.x, p_b.x, p_t);
+	r_vector->y = lerp_float(p_a.y, p_b.y, p_t);
+	r_vector->z = lerp_float(p_a.z, p_b.z, p_t);
+}
+
+static void slerp_quaternion(LEAP_QUATERNION *r_quat, const LEAP_QUATERNION &p_a, const LEAP_QUATERNION &p_b, float p_t) {
+	float cosom = p_a.x * p_b.x + p_a.y * p_b.y + p_a.z * p_b.z + p_a.w * p_b.w;
+
+	// make sure we take the shortest path
+	float sign = 1.0f;
+	if (cosom < 0.0f) {
+		cosom = -cosom;
+		sign = -1.0f;
+	}
+
+	float scale0, scale1;
+	if ((1.0f - cosom) > 0.0001f) {
+		// standard slerp
+		float omega = acosf(cosom);
+		float sinom = sinf(omega);
+		scale0 = sinf((1.0f - p_t) * omega) / sinom;
+		scale1 = sinf(p_t * omega) / sinom;
+	} else {
+		// our quaternions are very close, a linear interpolation will do
+		scale0 = 1.0f - p_t;
+		scale1 = p_t;
+	}
+	scale1 *= sign;
+
+	r_quat->x = scale0 * p_a.x + scale1 * p_b.x;
+	r_quat->y = scale0 * p_a.y + scale1 * p_b.y;
+	r_quat->z = scale0 * p_a.z + scale1 * p_b.z;
+	r_quat->w = scale0 * p_a.w + scale1 * p_b.w;
+}
+
+static void lerp_bone(LEAP_BONE *r_bone, const LEAP_BONE &p_a, const LEAP_BONE &p_b, float p_t) {
+	lerp_vector(&r_bone->prev_joint, p_a.prev_joint, p_b.prev_joint, p_t);
+	lerp_vector(&r_bone->next_joint, p_a.next_joint, p_b.next_joint, p_t);
+	r_bone->width = lerp_float(p_a.width, p_b.width, p_t);
+	slerp_quaternion(&r_bone->rotation, p_a.rotation, p_b.rotation, p_t);
+}
+
+static inline float clamp_float(float p_value, float p_min, float p_max) {
+	return p_value < p_min ? p_min : (p_value > p_max ? p_max : p_value);
+}
+
+static void lerp_hand(LEAP_HAND *r_hand, const LEAP_HAND &p_a, const LEAP_HAND &p_b, float p_t) {
+	// start with our newest hand so we get id, type, flags, etc.
+	*r_hand = p_b;
+
+	r_hand->confidence = lerp_float(p_a.confidence, p_b.confidence, p_t);
+	r_hand->pinch_distance = lerp_float(p_a.pinch_distance, p_b.pinch_distance, p_t);
+	r_hand->grab_angle = lerp_float(p_a.grab_angle, p_b.grab_angle, p_t);
+	r_hand->pinch_strength = lerp_float(p_a.pinch_strength, p_b.pinch_strength, p_t);
+	r_hand->grab_strength = lerp_float(p_a.grab_strength, p_b.grab_strength, p_t);
+
+	lerp_vector(&r_hand->palm.position, p_a.palm.position, p_b.palm.position, p_t);
+	lerp_vector(&r_hand->palm.stabilized_position, p_a.palm.stabilized_position, p_b.palm.stabilized_position, p_t);
+	lerp_vector(&r_hand->palm.velocity, p_a.palm.velocity, p_b.palm.velocity, p_t);
+	lerp_vector(&r_hand->palm.normal, p_a.palm.normal, p_b.palm.normal, p_t);
+	r_hand->palm.width = lerp_float(p_a.palm.width, p_b.palm.width, p_t);
+	lerp_vector(&r_hand->palm.direction, p_a.palm.direction, p_b.palm.direction, p_t);
+	slerp_quaternion(&r_hand->palm.orientation, p_a.palm.orientation, p_b.palm.orientation, p_t);
+
+	for (int d = 0; d < 5; d++) {
+		for (int b = 0; b < 4; b++) {
+			lerp_bone(&r_hand->digits[d].bones[b], p_a.digits[d].bones[b], p_b.digits[d].bones[b], p_t);
+		}
+	}
+
+	lerp_bone(&r_hand->arm, p_a.arm, p_b.arm, p_t);
+
+	if (p_t > 1.0f) {
+		// we're extrapolating, keep our scalars within their range
+		r_hand->confidence = clamp_float(r_hand->confidence, 0.0f, 1.0f);
+		r_hand->pinch_distance = r_hand->pinch_distance < 0.0f ? 0.0f : r_hand->pinch_distance;
+		r_hand->pinch_strength = clamp_float(r_hand->pinch_strength, 0.0f, 1.0f);
+		r_hand->grab_strength = clamp_float(r_hand->grab_strength, 0.0f, 1.0f);
+	}
+}
+
+// interpolates or extrapolates all hands in p_b at p_t between p_a and p_b
+static void lerp_frame(gdlm_frame *r_frame, const LEAP_TRACKING_EVENT &p_a, const LEAP_TRACKING_EVENT &p_b, int64_t p_timestamp, float p_t) {
+	// our header comes from our newer frame but with our new timestamp
+	r_frame->event = p_b;
+	r_frame->event.info.reserved = NULL;
+	r_frame->event.info.timestamp = p_timestamp;
+	r_frame->event.framerate = lerp_float(p_a.framerate, p_b.framerate, p_t > 1.0f ? 1.0f : p_t);
+	r_frame->event.pHands = r_frame->hands;
+
+	// we only output hands that are still tracked in our newer frame, hands that just
+	// started tracking in our newer frame can't be interpolated so we use them as is.
+	for (uint32_t h = 0; h < p_b.nHands; h++) {
+		const LEAP_HAND *older_hand = NULL;
+		for (uint32_t o = 0; o < p_a.nHands && older_hand == NULL; o++) {
+			if (p_a.pHands[o].id == p_b.pHands[h].id) {
+				older_hand = &p_a.pHands[o];
+			}
+		}
+
+		if (older_hand != NULL) {
+			lerp_hand(&r_frame->hands[h], *older_hand, p_b.pHands[h], p_t);
+		} else {
+			r_frame->hands[h] = p_b.pHands[h];
+		}
+	}
+}
+
+GDLMFrameHistory::GDLMFrameHistory() {
+	memset(frames, 0, sizeof(frames));
+	for (int i = 0; i < GDLM_HISTORY_SIZE; i++) {
+		frames[i].event.pHands = frames[i].hands;
+	}
+
+	write_count.store(0);
+}
+
+void GDLMFrameHistory::add(const LEAP_TRACKING_EVENT *p_event) {
+	uint64_t count = write_count.load(std::memory_order_relaxed);
+
+	gdlm_copy_frame(&frames[count % GDLM_HISTORY_SIZE], p_event);
+
+	// and publish, release makes sure our copy is visible before our count is
+	write_count.store(count + 1, std::memory_order_release);
+}
+
+bool GDLMFrameHistory::is_still_valid(uint64_t p_oldest_used) const {
+	// make sure all our reads of frame data have completed before we check our count
+	std::atomic_thread_fence(std::memory_order_acquire);
+	uint64_t count = write_count.load(std::memory_order_relaxed);
+
+	// our writer may be working on frame count, so it will have touched frames[count % GDLM_HISTORY_SIZE],
+	// that is only a problem if it is the slot of one of the frames we used.
+	return (count - p_oldest_used) < GDLM_HISTORY_SIZE;
+}
+
+bool GDLMFrameHistory::interpolate(int64_t p_timestamp, gdlm_frame *r_frame) const {
+	uint64_t count = write_count.load(std::memory_order_acquire);
+	if (count == 0) {
+		// no history yet
+		return false;
+	}
+
+	// our writer may already be overwriting the slot after our newest frame, so we skip that one
+	uint64_t oldest = count >= GDLM_HISTORY_SIZE ? count - GDLM_HISTORY_SIZE + 1 : 0;
+	uint64_t newer = count - 1;
+	const gdlm_frame *newer_frame = &frames[newer % GDLM_HISTORY_SIZE];
+
+	if (p_timestamp >= newer_frame->event.info.timestamp) {
+		// we don't extrapolate, just return our newest frame
+		gdlm_copy_frame(r_frame, &newer_frame->event);
+		return is_still_valid(newer);
+	}
+
+	// find the two frames that bracket our timestamp
+	const gdlm_frame *older_frame = NULL;
+	while (newer > oldest) {
+		older_frame = &frames[(newer - 1) % GDLM_HISTORY_SIZE];
+		if (older_frame->event.info.timestamp <= p_timestamp) {
+			break;
+		}
+
+		newer--;
+		newer_frame = older_frame;
+		older_frame = NULL;
+	}
+
+	if (older_frame == NULL) {
+		// our timestamp is older than our history
+		return false;
+	}
+
+	const LEAP_TRACKING_EVENT &a = older_frame->event;
+	const LEAP_TRACKING_EVENT &b = newer_frame->event;
+	int64_t delta = b.info.timestamp - a.info.timestamp;
+	float t = delta > 0 ? (float)(p_timestamp - a.info.timestamp) / (float)delta : 1.0f;
+
+	lerp_frame(r_frame, a, b, p_timestamp, t);
+
+	return is_still_valid(newer - 1);
+}
+
+bool GDLMFrameHistory::extrapolate(int64_t p_timestamp, int64_t p_max_horizon, gdlm_frame *r_frame) const {
+	uint64_t count = write_count.load(std::memory_order_acquire);
+	if (count < 2) {
+		// we need two frames to know how fast we're moving
+		return interpolate(p_timestamp, r_frame);
+	}
+
+	const gdlm_frame *newer_frame = &frames[(count - 1) % GDLM_HISTORY_SIZE];
+	const gdlm_frame *older_frame = &frames[(count - 2) % GDLM_HISTORY_SIZE];
+	const LEAP_TRACKING_EVENT &a = older_frame->event;
+	const LEAP_TRACKING_EVENT &b = newer_frame->event;
+	if (p_timestamp <= b.info.timestamp) {
+		// no need to extrapolate
+		return interpolate(p_timestamp, r_frame);
+	}
+
+	// we don't extrapolate further than our horizon, if tracking stalls our hands just stop
+	int64_t horizon = p_timestamp - b.info.timestamp;
+	if (horizon > p_max_horizon) {
+		horizon = p_max_horizon;
+	}
+
+	int64_t delta = b.info.timestamp - a.info.timestamp;
+	float t = delta > 0 ? 1.0f + (float)horizon / (float)delta : 1.0f;
+
+	lerp_frame(r_frame, a, b, b.info.timestamp + horizon, t);
+
+	return is_still_valid(count - 2);
+}
+
+int64_t GDLMFrameHistory::get_newest_timestamp() const {
+	uint64_t count = write_count.load(std::memory_order_acquire);
+	if (count == 0) {
+		return 0;
+	}
+
+	int64_t timestamp = frames[(count - 1) % GDLM_HISTORY_SIZE].event.info.timestamp;
+	return is_still_valid(count - 1) ? timestamp : 0;
+}
@@ -0,0 +1,46 @@
+#ifndef GDLM_FRAME_HISTORY_H
+#define GDLM_FRAME_HISTORY_H
+
+#include "gdlm_frame_buffer.h"
+
+// Number of frames we remember, at 110Hz tracking this gives us well over 100ms of history.
+#define GDLM_HISTORY_SIZE 16
+
+namespace godot {
+
+// Ring buffer with deep copies of our most recent tracking frames so we can interpolate
+// frames at any timestamp within our history without a round trip to the leap motion service.
+// There is exactly one writer thread, our leap motion thread, and one reader thread.
+// The writer never waits on the reader, the reader detects when the writer overwrote a frame
+// it was using and simply fails so we can fall back onto LeapInterpolateFrame.
+class GDLMFrameHistory {
+private:
+	gdlm_frame frames[GDLM_HISTORY_SIZE];
+	std::atomic<uint64_t> write_count; // number of frames written, frame n lives in frames[n % GDLM_HISTORY_SIZE]
+
+	// returns true if none of the frames from p_oldest_used onwards have been overwritten since we read them
+	bool is_still_valid(uint64_t p_oldest_used) const;
+
+public:
+	GDLMFrameHistory();
+
+	// called from the writer, deep copies our event into our history
+	void add(const LEAP_TRACKING_EVENT *p_event);
+
+	// called from the reader, interpolates our frame at p_timestamp (in leap motion time).
+	// Palm and bone orientations are slerped, positions and other values are lerped.
+	// If p_timestamp is newer than our newest frame we return our newest frame.
+	// Returns false if p_timestamp is older than our history or we don't have any history yet.
+	bool interpolate(int64_t p_timestamp, gdlm_frame *r_frame) const;
+
+	// Called from the reader, like interpolate but if p_timestamp is newer than our newest frame we extrapolate
+	// the velocity between our two newest frames, at most p_max_horizon microseconds beyond our newest frame.
+	bool extrapolate(int64_t p_timestamp, int64_t p_max_horizon, gdlm_frame *r_frame) const;
+
+	// called from the reader, timestamp of our newest frame or 0 if we don't have any history yet
+	int64_t get_newest_timestamp() const;
+};
+
+} // namespace godot
+
+#endif /* !GDLM_FRAME_HISTORY_H */
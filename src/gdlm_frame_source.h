@@ -0,0 +1,82 @@
+#ifndef GDLM_FRAME_SOURCE_H
+#define GDLM_FRAME_SOURCE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// our leap motion data structures
+#include "gdlm_leap_types.h"
+
+#include "gdlm_clock_sync.h"
+
+// Maximum number of devices we take frames from at once.
+#define GDLM_MAX_DEVICES 4
+
+// Room for a device serial number including its terminator, longer serials are cut short.
+#define GDLM_MAX_SERIAL 64
+
+namespace godot {
+
+// Receives what our frame source produces, called from the thread that polls our source.
+class GDLMFrameSourceListener {
+public:
+	virtual ~GDLMFrameSourceListener() {}
+
+	virtual void on_connection_changed(bool p_is_connected) = 0;
+
+	// A device was attached or removed. p_device is the id its tracking events come with,
+	// p_serial identifies it across connections and is only valid during this call.
+	virtual void on_device_changed(uint32_t p_device, const char *p_serial, bool p_is_attached) = 0;
+
+	// p_event came from device p_device and is only valid during this call
+	virtual void on_tracking_event(uint32_t p_device, const LEAP_TRACKING_EVENT *p_event) = 0;
+
+	// p_event holds the camera images of device p_device and is only valid during this call
+	virtual void on_image_event(uint32_t p_device, const LEAP_IMAGE_EVENT *p_event) = 0;
+};
+
+// Where our tracking frames come from, leap motion devices or our synthetic generator.
+// All devices of a source share its clock.
+// poll and update_clock are called from our leap motion thread, everything else from Godots thread.
+// open and close are only called while our leap motion thread isn't running.
+class GDLMFrameSource {
+public:
+	virtual ~GDLMFrameSource() {}
+
+	virtual bool open() = 0;
+	virtual void close() = 0;
+
+	// Waits up to p_timeout milliseconds for something to happen and tells our listener about it,
+	// then handles everything else that is already pending before returning.
+	virtual void poll(GDLMFrameSourceListener *p_listener, unsigned int p_timeout) = 0;
+
+	// Wakes up a poll in progress so our leap motion thread can exit right away, called from Godots thread.
+	// Our source may stop producing frames after this, close is always called next.
+	virtual void interrupt() = 0;
+
+	// current time on the clock our frames are timestamped with, in microseconds
+	virtual int64_t get_now() = 0;
+
+	// Keeps track of the relation between Godots clock and our clock so we can convert timestamps.
+	// update_clock is called after every poll with Godots clock, read just before, which has
+	// a resolution of p_resolution_usec. rebase_clock returns false if we can't convert (yet).
+	virtual void update_clock(int64_t p_godot_usec, int64_t p_resolution_usec) = 0;
+	virtual bool rebase_clock(int64_t p_godot_usec, int64_t *r_usec) = 0;
+
+	// how well our clocks are in sync, returns false if we don't know yet
+	virtual bool get_clock_stats(gdlm_clock_stats *r_stats) const { return false; }
+
+	// tells our source to optimise tracking for a sensor mounted on a HMD
+	virtual void set_hmd_optimized(bool p_set) {}
+
+	// tells our source to send us camera images, these cost bandwidth so they're off until asked for
+	virtual void set_images_enabled(bool p_set) {}
+
+	// Asks our source for a frame of device p_device at p_timestamp, used when our own frame history doesn't go back far enough.
+	// The frame remains valid until the next call, returns NULL if our source can't do this.
+	virtual const LEAP_TRACKING_EVENT *interpolate_frame(uint32_t p_device, int64_t p_timestamp) { return NULL; }
+};
+
+} // namespace godot
+
+#endif /* !GDLM_FRAME_SOURCE_H */
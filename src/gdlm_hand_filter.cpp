@@ -0,0 +1,187 @@
+#include "gdlm_hand_filter.h"
+
+#include <math.h>
+#include <string.h>
+
+#include "gdlm_simd.h"
+
+#define GDLM_TWO_PI 6.28318530718f
+
+using namespace godot;
+
+// our palm comes after the 5 joints of each of our digits
+#define PALM_POINT 25
+
+// gathers our joints and palm position into structure of arrays, our padding stays zero
+static void gather_points(const LEAP_HAND *p_hand, float r_points[3][GDLM_FILTER_LANES]) {
+	for (int d = 0; d < 5; d++) {
+		const LEAP_DIGIT &digit = p_hand->digits[d];
+		for (int j = 0; j < 5; j++) {
+			// our first joint is where our metacarpal starts, the others are where each bone ends
+			const LEAP_VECTOR &joint = j == 0 ? digit.bones[0].prev_joint : digit.bones[j - 1].next_joint;
+			r_points[0][d * 5 + j] = joint.x;
+			r_points[1][d * 5 + j] = joint.y;
+			r_points[2][d * 5 + j] = joint.z;
+		}
+	}
+
+	r_points[0][PALM_POINT] = p_hand->palm.position.x;
+	r_points[1][PALM_POINT] = p_hand->palm.position.y;
+	r_points[2][PALM_POINT] = p_hand->palm.position.z;
+
+	for (int c = 0; c < 3; c++) {
+		for (int i = GDLM_FILTER_POINTS; i < GDLM_FILTER_LANES; i++) {
+			r_points[c][i] = 0.0f;
+		}
+	}
+}
+
+// our smoothing factor for a cutoff frequency, p_dt in seconds
+static inline float smoothing_factor(float p_cutoff, float p_dt) {
+	float r = GDLM_TWO_PI * p_cutoff * p_dt;
+	return r / (r + 1.0f);
+}
+
+GDLMHandFilter::GDLMHandFilter() {
+	reset();
+}
+
+void GDLMHandFilter::reset() {
+	has_state = false;
+	timestamp = 0;
+}
+
+void GDLMHandFilter::restart(const LEAP_HAND *p_hand, int64_t p_timestamp) {
+	gather_points(p_hand, position);
+	memset(velocity, 0, sizeof(velocity));
+	orientation = p_hand->palm.orientation;
+	angular_speed = 0.0f;
+	timestamp = p_timestamp;
+	has_state = true;
+}
+
+void GDLMHandFilter::output(const LEAP_HAND *p_hand, LEAP_HAND *r_hand) const {
+	if (r_hand != p_hand) {
+		*r_hand = *p_hand;
+	}
+
+	for (int d = 0; d < 5; d++) {
+		LEAP_DIGIT &digit = r_hand->digits[d];
+		for (int j = 0; j < 5; j++) {
+			LEAP_VECTOR joint;
+			joint.x = position[0][d * 5 + j];
+			joint.y = position[1][d * 5 + j];
+			joint.z = position[2][d * 5 + j];
+
+			// each joint ends one bone and starts the next
+			if (j > 0) {
+				digit.bones[j - 1].next_joint = joint;
+			}
+			if (j < 4) {
+				digit.bones[j].prev_joint = joint;
+			}
+		}
+	}
+
+	r_hand->palm.position.x = position[0][PALM_POINT];
+	r_hand->palm.position.y = position[1][PALM_POINT];
+	r_hand->palm.position.z = position[2][PALM_POINT];
+	r_hand->palm.orientation = orientation;
+}
+
+void GDLMHandFilter::filter(const LEAP_HAND *p_hand, int64_t p_timestamp, const gdlm_filter_params &p_params, LEAP_HAND *r_hand) {
+	int64_t delta = p_timestamp - timestamp;
+	if (!has_state || delta > GDLM_FILTER_RESET_USEC) {
+		// nothing to smooth towards yet
+		restart(p_hand, p_timestamp);
+		output(p_hand, r_hand);
+		return;
+	} else if (delta <= 0) {
+		// we've already filtered this moment, or a later one
+		output(p_hand, r_hand);
+		return;
+	}
+
+	float dt = (float)delta * 0.000001f;
+	float inv_dt = 1.0f / dt;
+	float d_alpha = smoothing_factor(p_params.d_cutoff, dt);
+
+	alignas(32) float points[3][GDLM_FILTER_LANES];
+	gather_points(p_hand, points);
+
+	// Our cutoff is min_cutoff + beta * speed, our smoothing factor is r / (r + 1) with r = 2 pi cutoff dt.
+	// We fold our constants so each lane only needs a few multiplies and one divide.
+	lanes v_inv_dt = lanes_set(inv_dt);
+	lanes v_d_alpha = lanes_set(d_alpha);
+	lanes v_r_base = lanes_set(GDLM_TWO_PI * p_params.min_cutoff * dt);
+	lanes v_r_speed = lanes_set(GDLM_TWO_PI * p_params.beta * dt);
+	lanes v_one = lanes_set(1.0f);
+
+	for (int i = 0; i < GDLM_FILTER_LANES; i += GDLM_SIMD_WIDTH) {
+		lanes px = lanes_loadu(&position[0][i]);
+		lanes py = lanes_loadu(&position[1][i]);
+		lanes pz = lanes_loadu(&position[2][i]);
+		lanes x = lanes_load(&points[0][i]);
+		lanes y = lanes_load(&points[1][i]);
+		lanes z = lanes_load(&points[2][i]);
+
+		// filter our velocity, measured against our filtered position
+		lanes dx = lanes_mul(lanes_sub(x, px), v_inv_dt);
+		lanes dy = lanes_mul(lanes_sub(y, py), v_inv_dt);
+		lanes dz = lanes_mul(lanes_sub(z, pz), v_inv_dt);
+		lanes vx = lanes_loadu(&velocity[0][i]);
+		lanes vy = lanes_loadu(&velocity[1][i]);
+		lanes vz = lanes_loadu(&velocity[2][i]);
+		vx = lanes_add(vx, lanes_mul(v_d_alpha, lanes_sub(dx, vx)));
+		vy = lanes_add(vy, lanes_mul(v_d_alpha, lanes_sub(dy, vy)));
+		vz = lanes_add(vz, lanes_mul(v_d_alpha, lanes_sub(dz, vz)));
+		lanes_storeu(&velocity[0][i], vx);
+		lanes_storeu(&velocity[1][i], vy);
+		lanes_storeu(&velocity[2][i], vz);
+
+		// the faster we move the higher our cutoff so we don't lag behind
+		lanes speed = lanes_sqrt(lanes_add(lanes_add(lanes_mul(vx, vx), lanes_mul(vy, vy)), lanes_mul(vz, vz)));
+		lanes r = lanes_add(v_r_base, lanes_mul(v_r_speed, speed));
+		lanes alpha = lanes_div(r, lanes_add(r, v_one));
+
+		lanes_storeu(&position[0][i], lanes_add(px, lanes_mul(alpha, lanes_sub(x, px))));
+		lanes_storeu(&position[1][i], lanes_add(py, lanes_mul(alpha, lanes_sub(y, py))));
+		lanes_storeu(&position[2][i], lanes_add(pz, lanes_mul(alpha, lanes_sub(z, pz))));
+	}
+
+	// Our palm rotation is filtered the same way on our quaternion, our speed is how fast we rotate
+	// scaled to how fast a point at our rotation radius would move.
+	LEAP_QUATERNION q = p_hand->palm.orientation;
+	if (q.x * orientation.x + q.y * orientation.y + q.z * orientation.z + q.w * orientation.w < 0.0f) {
+		// make sure we take the shortest path
+		q.x = -q.x;
+		q.y = -q.y;
+		q.z = -q.z;
+		q.w = -q.w;
+	}
+
+	// the distance between our quaternions is 2 sin(angle / 4), unlike acos this stays accurate for small angles
+	float qx = q.x - orientation.x, qy = q.y - orientation.y, qz = q.z - orientation.z, qw = q.w - orientation.w;
+	float chord = 0.5f * sqrtf(qx * qx + qy * qy + qz * qz + qw * qw);
+	float angle = 4.0f * asinf(chord > 1.0f ? 1.0f : chord);
+	angular_speed += d_alpha * (angle * GDLM_FILTER_ROTATION_RADIUS * inv_dt - angular_speed);
+
+	float alpha = smoothing_factor(p_params.min_cutoff + p_params.beta * angular_speed, dt);
+	orientation.x += alpha * (q.x - orientation.x);
+	orientation.y += alpha * (q.y - orientation.y);
+	orientation.z += alpha * (q.z - orientation.z);
+	orientation.w += alpha * (q.w - orientation.w);
+
+	float length = sqrtf(orientation.x * orientation.x + orientation.y * orientation.y + orientation.z * orientation.z + orientation.w * orientation.w);
+	if (length > 0.0f) {
+		orientation.x /= length;
+		orientation.y /= length;
+		orientation.z /= length;
+		orientation.w /= length;
+	} else {
+		orientation = p_hand->palm.orientation;
+	}
+
+	timestamp = p_timestamp;
+	output(p_hand, r_hand);
+}
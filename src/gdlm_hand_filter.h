@@ -0,0 +1,60 @@
+#ifndef GDLM_HAND_FILTER_H
+#define GDLM_HAND_FILTER_H
+
+#include <stdint.h>
+
+// our leap motion data structures
+#include "gdlm_leap_types.h"
+
+// We filter 5 joints for each of our 5 digits followed by our palm position,
+// padded to a multiple of 8 so we can process them in SIMD lanes.
+#define GDLM_FILTER_POINTS 26
+#define GDLM_FILTER_LANES 32
+
+// If our last sample is older than this, in microseconds, we restart our filter instead of smoothing
+// towards the new position. A hand that was lost for a while shouldn't slide into place.
+#define GDLM_FILTER_RESET_USEC 100000
+
+// Our palm rotation is filtered as if it moved a point this far from our palm, in mm,
+// so the same beta works for rotation and position.
+#define GDLM_FILTER_ROTATION_RADIUS 100.0f
+
+namespace godot {
+
+// One Euro filter settings, see http://cristal.univ-lille.fr/~casiez/1euro/
+struct gdlm_filter_params {
+	float min_cutoff; // cutoff frequency in Hz when we're not moving, lower is smoother but lags more, 0.0 disables filtering
+	float beta; // how much our cutoff frequency goes up per mm/s of speed, higher lags less when moving fast
+	float d_cutoff; // cutoff frequency in Hz for the speed we base our cutoff on
+};
+
+// Smooths the joints, palm position and palm rotation of one hand with a One Euro filter.
+// Each point gets its own cutoff based on how fast it moves, so a resting hand doesn't jitter
+// while a moving hand barely lags. All our points are filtered side by side in SIMD lanes.
+class GDLMHandFilter {
+private:
+	// structure of arrays, x, y and z for each of our points
+	float position[3][GDLM_FILTER_LANES]; // our filtered positions in mm
+	float velocity[3][GDLM_FILTER_LANES]; // our filtered velocities in mm/s
+	LEAP_QUATERNION orientation; // our filtered palm orientation
+	float angular_speed; // our filtered palm rotation speed, in mm/s at GDLM_FILTER_ROTATION_RADIUS
+	int64_t timestamp; // timestamp of the last sample we filtered
+	bool has_state;
+
+	void restart(const LEAP_HAND *p_hand, int64_t p_timestamp);
+	void output(const LEAP_HAND *p_hand, LEAP_HAND *r_hand) const;
+
+public:
+	GDLMHandFilter();
+
+	// forget our state, our next sample is passed through as is
+	void reset();
+
+	// Filters p_hand, which was sampled at p_timestamp, into r_hand. p_hand and r_hand may be the same.
+	// Samples older than our last one don't update our filter, we just output our current state.
+	void filter(const LEAP_HAND *p_hand, int64_t p_timestamp, const gdlm_filter_params &p_params, LEAP_HAND *r_hand);
+};
+
+} // namespace godot
+
+#endif /* !GDLM_HAND_FILTER_H */
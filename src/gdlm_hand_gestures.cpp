@@ -0,0 +1,45 @@
+#include "gdlm_hand_gestures.h"
+
+using namespace godot;
+
+GDLMHandGestures::GDLMHandGestures() {
+	reset();
+}
+
+void GDLMHandGestures::reset() {
+	is_pinched = false;
+	is_grabbed = false;
+}
+
+uint32_t GDLMHandGestures::update(const LEAP_HAND *p_hand, const gdlm_gesture_params &p_params) {
+	uint32_t changed = 0;
+
+	if (!is_pinched) {
+		bool is_close = p_params.pinch_max_distance <= 0.0f || p_hand->pinch_distance < p_params.pinch_max_distance;
+		if (p_hand->pinch_strength > p_params.pinch_on && is_close) {
+			is_pinched = true;
+			changed |= PINCH_CHANGED;
+		}
+	} else if (p_hand->pinch_strength < p_params.pinch_off) {
+		is_pinched = false;
+		changed |= PINCH_CHANGED;
+	}
+
+	if (!is_grabbed) {
+		if (p_hand->grab_strength > p_params.grab_on) {
+			is_grabbed = true;
+			changed |= GRAB_CHANGED;
+		}
+	} else if (p_hand->grab_strength < p_params.grab_off) {
+		is_grabbed = false;
+		changed |= GRAB_CHANGED;
+	}
+
+	return changed;
+}
+
+uint32_t GDLMHandGestures::release() {
+	uint32_t changed = (is_pinched ? PINCH_CHANGED : 0) | (is_grabbed ? GRAB_CHANGED : 0);
+	reset();
+	return changed;
+}
@@ -0,0 +1,50 @@
+#ifndef GDLM_HAND_GESTURES_H
+#define GDLM_HAND_GESTURES_H
+
+#include <stdint.h>
+
+// our leap motion data structures
+#include "gdlm_leap_types.h"
+
+namespace godot {
+
+// When our hands count as pinching or grabbing. A gesture starts once its strength goes above its on threshold
+// and only ends once it drops below its off threshold, so a hand hovering around a threshold doesn't flicker.
+struct gdlm_gesture_params {
+	float pinch_on;
+	float pinch_off;
+	float pinch_max_distance; // in mm, a pinch only starts if our thumb and index finger are closer than this, 0.0 to ignore
+	float grab_on;
+	float grab_off;
+};
+
+// Tracks whether one hand is pinching and grabbing.
+class GDLMHandGestures {
+private:
+	bool is_pinched;
+	bool is_grabbed;
+
+public:
+	enum {
+		PINCH_CHANGED = 0x01,
+		GRAB_CHANGED = 0x02
+	};
+
+	GDLMHandGestures();
+
+	// forget our state without reporting any changes, for a hand that starts over
+	void reset();
+
+	// updates our state from p_hand, returns which of our gestures changed
+	uint32_t update(const LEAP_HAND *p_hand, const gdlm_gesture_params &p_params);
+
+	// ends our gestures, for a hand that is going away, returns which of our gestures changed
+	uint32_t release();
+
+	bool get_is_pinched() const { return is_pinched; }
+	bool get_is_grabbed() const { return is_grabbed; }
+};
+
+} // namespace godot
+
+#endif /* !GDLM_HAND_GESTURES_H */
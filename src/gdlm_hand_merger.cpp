@@ -0,0 +1,408 @@
+#include "gdlm_hand_merger.h"
+
+#include <math.h>
+#include <string.h>
+
+using namespace godot;
+
+// Hands with no confidence at all still count for a little so we never divide by zero.
+#define MIN_WEIGHT 0.01f
+
+static inline LEAP_QUATERNION quat_mul(const LEAP_QUATERNION &p_a, const LEAP_QUATERNION &p_b) {
+	LEAP_QUATERNION r;
+	r.x = p_a.w * p_b.x + p_a.x * p_b.w + p_a.y * p_b.z - p_a.z * p_b.y;
+	r.y = p_a.w * p_b.y + p_a.y * p_b.w + p_a.z * p_b.x - p_a.x * p_b.z;
+	r.z = p_a.w * p_b.z + p_a.z * p_b.w + p_a.x * p_b.y - p_a.y * p_b.x;
+	r.w = p_a.w * p_b.w - p_a.x * p_b.x - p_a.y * p_b.y - p_a.z * p_b.z;
+	return r;
+}
+
+static inline LEAP_VECTOR quat_rotate(const LEAP_QUATERNION &p_q, const LEAP_VECTOR &p_v) {
+	// v' = v + 2w(q x v) + 2(q x (q x v))
+	float cx = p_q.y * p_v.z - p_q.z * p_v.y;
+	float cy = p_q.z * p_v.x - p_q.x * p_v.z;
+	float cz = p_q.x * p_v.y - p_q.y * p_v.x;
+	float ccx = p_q.y * cz - p_q.z * cy;
+	float ccy = p_q.z * cx - p_q.x * cz;
+	float ccz = p_q.x * cy - p_q.y * cx;
+
+	LEAP_VECTOR r;
+	r.x = p_v.x + 2.0f * (p_q.w * cx + ccx);
+	r.y = p_v.y + 2.0f * (p_q.w * cy + ccy);
+	r.z = p_v.z + 2.0f * (p_q.w * cz + ccz);
+	return r;
+}
+
+static inline LEAP_VECTOR transform_point(const gdlm_device_transform &p_transform, const LEAP_VECTOR &p_point) {
+	LEAP_VECTOR r = quat_rotate(p_transform.rotation, p_point);
+	r.x += p_transform.origin.x;
+	r.y += p_transform.origin.y;
+	r.z += p_transform.origin.z;
+	return r;
+}
+
+static void transform_bone(LEAP_BONE *r_bone, const gdlm_device_transform &p_transform) {
+	r_bone->prev_joint = transform_point(p_transform, r_bone->prev_joint);
+	r_bone->next_joint = transform_point(p_transform, r_bone->next_joint);
+	r_bone->rotation = quat_mul(p_transform.rotation, r_bone->rotation);
+}
+
+// moves our hand from our devices space into our common space
+static void transform_hand(LEAP_HAND *r_hand, const gdlm_device_transform &p_transform) {
+	LEAP_PALM &palm = r_hand->palm;
+	palm.position = transform_point(p_transform, palm.position);
+	palm.stabilized_position = transform_point(p_transform, palm.stabilized_position);
+	palm.velocity = quat_rotate(p_transform.rotation, palm.velocity);
+	palm.normal = quat_rotate(p_transform.rotation, palm.normal);
+	palm.direction = quat_rotate(p_transform.rotation, palm.direction);
+	palm.orientation = quat_mul(p_transform.rotation, palm.orientation);
+
+	for (int d = 0; d < 5; d++) {
+		for (int b = 0; b < 4; b++) {
+			transform_bone(&r_hand->digits[d].bones[b], p_transform);
+		}
+	}
+
+	transform_bone(&r_hand->arm, p_transform);
+}
+
+static inline float distance_squared(const LEAP_VECTOR &p_a, const LEAP_VECTOR &p_b) {
+	float x = p_a.x - p_b.x, y = p_a.y - p_b.y, z = p_a.z - p_b.z;
+	return x * x + y * y + z * z;
+}
+
+static inline void add_vector(LEAP_VECTOR *r_sum, const LEAP_VECTOR &p_v, float p_weight) {
+	r_sum->x += p_v.x * p_weight;
+	r_sum->y += p_v.y * p_weight;
+	r_sum->z += p_v.z * p_weight;
+}
+
+static inline void add_quat(LEAP_QUATERNION *r_sum, const LEAP_QUATERNION &p_q, const LEAP_QUATERNION &p_reference, float p_weight) {
+	// q and -q are the same rotation, make sure we're all on the same side
+	if (p_q.x * p_reference.x + p_q.y * p_reference.y + p_q.z * p_reference.z + p_q.w * p_reference.w < 0.0f) {
+		p_weight = -p_weight;
+	}
+
+	r_sum->x += p_q.x * p_weight;
+	r_sum->y += p_q.y * p_weight;
+	r_sum->z += p_q.z * p_weight;
+	r_sum->w += p_q.w * p_weight;
+}
+
+static inline void scale_vector(LEAP_VECTOR *r_v, float p_scale) {
+	r_v->x *= p_scale;
+	r_v->y *= p_scale;
+	r_v->z *= p_scale;
+}
+
+static inline void normalize_vector(LEAP_VECTOR *r_v) {
+	float length = sqrtf(r_v->x * r_v->x + r_v->y * r_v->y + r_v->z * r_v->z);
+	if (length > 0.0f) {
+		scale_vector(r_v, 1.0f / length);
+	}
+}
+
+// a normalised weighted sum of quaternions is a good average as long as they're close together, which ours are
+static inline void normalize_quat(LEAP_QUATERNION *r_q, const LEAP_QUATERNION &p_fallback) {
+	float length = sqrtf(r_q->x * r_q->x + r_q->y * r_q->y + r_q->z * r_q->z + r_q->w * r_q->w);
+	if (length > 0.0f) {
+		r_q->x /= length;
+		r_q->y /= length;
+		r_q->z /= length;
+		r_q->w /= length;
+	} else {
+		*r_q = p_fallback;
+	}
+}
+
+static void add_bone(LEAP_BONE *r_sum, const LEAP_BONE &p_bone, const LEAP_BONE &p_reference, float p_weight) {
+	add_vector(&r_sum->prev_joint, p_bone.prev_joint, p_weight);
+	add_vector(&r_sum->next_joint, p_bone.next_joint, p_weight);
+	r_sum->width += p_bone.width * p_weight;
+	add_quat(&r_sum->rotation, p_bone.rotation, p_reference.rotation, p_weight);
+}
+
+static void finish_bone(LEAP_BONE *r_bone, const LEAP_BONE &p_sum, const LEAP_BONE &p_reference, float p_scale) {
+	r_bone->prev_joint = p_sum.prev_joint;
+	scale_vector(&r_bone->prev_joint, p_scale);
+	r_bone->next_joint = p_sum.next_joint;
+	scale_vector(&r_bone->next_joint, p_scale);
+	r_bone->width = p_sum.width * p_scale;
+	r_bone->rotation = p_sum.rotation;
+	normalize_quat(&r_bone->rotation, p_reference.rotation);
+}
+
+GDLMHandMerger::GDLMHandMerger() {
+	merge_distance = 60.0f;
+	reset();
+}
+
+void GDLMHandMerger::set_merge_distance(float p_distance) {
+	merge_distance = p_distance < 0.0f ? 0.0f : p_distance;
+}
+
+void GDLMHandMerger::reset() {
+	for (int i = 0; i < GDLM_MERGE_ASSOCIATIONS; i++) {
+		associations[i].device = -1;
+	}
+
+	next_id = 1;
+	merge_count = 0;
+	frame_id = 0;
+}
+
+void GDLMHandMerger::forget_device(int p_device) {
+	for (int i = 0; i < GDLM_MERGE_ASSOCIATIONS; i++) {
+		if (associations[i].device == p_device) {
+			associations[i].device = -1;
+		}
+	}
+}
+
+uint32_t GDLMHandMerger::find_association(int p_device, uint32_t p_leap_id) const {
+	for (int i = 0; i < GDLM_MERGE_ASSOCIATIONS; i++) {
+		if (associations[i].device == p_device && associations[i].leap_id == p_leap_id) {
+			return associations[i].merged_id;
+		}
+	}
+
+	return 0;
+}
+
+void GDLMHandMerger::associate(int p_device, uint32_t p_leap_id, uint32_t p_merged_id) {
+	// update our existing entry, or replace our unused or least recently used one
+	int entry = 0;
+	for (int i = 0; i < GDLM_MERGE_ASSOCIATIONS; i++) {
+		const association &a = associations[i];
+		if (a.device == p_device && a.leap_id == p_leap_id) {
+			entry = i;
+			break;
+		} else if (associations[entry].device != -1 && (a.device == -1 || a.last_used < associations[entry].last_used)) {
+			entry = i;
+		}
+	}
+
+	associations[entry].device = p_device;
+	associations[entry].leap_id = p_leap_id;
+	associations[entry].merged_id = p_merged_id;
+	associations[entry].last_used = merge_count;
+}
+
+int GDLMHandMerger::find_group(const candidate &p_candidate, int p_group_count, uint32_t p_merged_id, float p_max_distance) const {
+	// find the closest group our candidate can join, or our group with p_merged_id if it isn't 0
+	int found = -1;
+	float found_distance = p_max_distance * p_max_distance;
+	for (int g = 0; g < p_group_count; g++) {
+		const group &grp = groups[g];
+		if (grp.type != p_candidate.type || (grp.device_mask & (1u << p_candidate.device)) != 0) {
+			// a device never sees the same hand twice
+			continue;
+		} else if (p_merged_id != 0 && grp.merged_id != p_merged_id) {
+			continue;
+		}
+
+		float distance = distance_squared(candidates[grp.best].hand.palm.position, p_candidate.hand.palm.position);
+		if (distance <= found_distance) {
+			found = g;
+			found_distance = distance;
+		}
+	}
+
+	return found;
+}
+
+bool GDLMHandMerger::merge(const LEAP_TRACKING_EVENT *const p_frames[GDLM_MAX_DEVICES], const gdlm_device_transform p_transforms[GDLM_MAX_DEVICES], gdlm_frame *r_frame) {
+	int64_t newest = 0;
+	bool has_frame = false;
+	for (int d = 0; d < GDLM_MAX_DEVICES; d++) {
+		if (p_frames[d] != NULL && (!has_frame || p_frames[d]->info.timestamp > newest)) {
+			newest = p_frames[d]->info.timestamp;
+			has_frame = true;
+		}
+	}
+	if (!has_frame) {
+		return false;
+	}
+
+	merge_count++;
+
+	// move all our hands into our common space
+	int candidate_count = 0;
+	float framerate = 0.0f;
+	for (int d = 0; d < GDLM_MAX_DEVICES; d++) {
+		const LEAP_TRACKING_EVENT *frame = p_frames[d];
+		if (frame == NULL || newest - frame->info.timestamp > GDLM_MERGE_MAX_AGE_USEC) {
+			continue;
+		}
+
+		framerate = frame->framerate > framerate ? frame->framerate : framerate;
+
+		uint32_t hand_count = frame->nHands < GDLM_MAX_HANDS ? frame->nHands : GDLM_MAX_HANDS;
+		for (uint32_t h = 0; h < hand_count; h++) {
+			candidate &c = candidates[candidate_count++];
+			c.device = d;
+			c.leap_id = frame->pHands[h].id;
+			c.type = frame->pHands[h].type == eLeapHandType_Left ? 0 : 1;
+			c.weight = frame->pHands[h].confidence > MIN_WEIGHT ? frame->pHands[h].confidence : MIN_WEIGHT;
+			c.group = -1;
+			c.hand = frame->pHands[h];
+			if (!p_transforms[d].is_identity) {
+				transform_hand(&c.hand, p_transforms[d]);
+			}
+		}
+	}
+
+	// Hands we've seen before rejoin the hand they were merged into last time, as long as they haven't drifted apart.
+	// This keeps our merged ids stable, distance alone could swap hands that cross each other.
+	int group_count = 0;
+	for (int i = 0; i < candidate_count; i++) {
+		candidate &c = candidates[i];
+		uint32_t merged_id = find_association(c.device, c.leap_id);
+		if (merged_id == 0) {
+			continue;
+		}
+
+		bool is_taken = false;
+		for (int g = 0; g < group_count && !is_taken; g++) {
+			is_taken = groups[g].merged_id == merged_id;
+		}
+
+		if (!is_taken) {
+			c.group = group_count++;
+			groups[c.group].merged_id = merged_id;
+			groups[c.group].type = c.type;
+			groups[c.group].best = i;
+			groups[c.group].device_mask = 1u << c.device;
+		} else {
+			c.group = find_group(c, group_count, merged_id, 2.0f * merge_distance);
+			if (c.group != -1) {
+				group &grp = groups[c.group];
+				grp.device_mask |= 1u << c.device;
+				if (c.weight > candidates[grp.best].weight) {
+					grp.best = i;
+				}
+			}
+		}
+	}
+
+	// New hands join the closest hand another device is already tracking, that is how hands are handed off between devices,
+	// or become a new hand.
+	for (int i = 0; i < candidate_count; i++) {
+		candidate &c = candidates[i];
+		if (c.group != -1) {
+			continue;
+		}
+
+		c.group = find_group(c, group_count, 0, merge_distance);
+		if (c.group != -1) {
+			group &grp = groups[c.group];
+			grp.device_mask |= 1u << c.device;
+			if (c.weight > candidates[grp.best].weight) {
+				grp.best = i;
+			}
+		} else {
+			c.group = group_count++;
+			groups[c.group].merged_id = next_id;
+			groups[c.group].type = c.type;
+			groups[c.group].best = i;
+			groups[c.group].device_mask = 1u << c.device;
+
+			// 0 means we have no merged id
+			next_id = next_id == UINT32_MAX ? 1 : next_id + 1;
+		}
+	}
+
+	for (int i = 0; i < candidate_count; i++) {
+		associate(candidates[i].device, candidates[i].leap_id, groups[candidates[i].group].merged_id);
+	}
+
+	// and fuse the hands in each group, weighted by how confident each device is
+	int hand_count = group_count < GDLM_MAX_HANDS ? group_count : GDLM_MAX_HANDS;
+	for (int g = 0; g < hand_count; g++) {
+		const group &grp = groups[g];
+		const LEAP_HAND &best = candidates[grp.best].hand;
+		LEAP_HAND *hand = &r_frame->hands[g];
+
+		// we start with our best hand so we get our flags, finger ids, etc.
+		*hand = best;
+		hand->id = grp.merged_id;
+
+		if (grp.device_mask == (1u << candidates[grp.best].device)) {
+			// only one device sees this hand, nothing to fuse
+			continue;
+		}
+
+		LEAP_HAND sum;
+		memset(&sum, 0, sizeof(sum));
+		float total_weight = 0.0f;
+		for (int i = 0; i < candidate_count; i++) {
+			const candidate &c = candidates[i];
+			if (c.group != g) {
+				continue;
+			}
+
+			float w = c.weight;
+			total_weight += w;
+			hand->confidence = c.hand.confidence > hand->confidence ? c.hand.confidence : hand->confidence;
+			hand->visible_time = c.hand.visible_time > hand->visible_time ? c.hand.visible_time : hand->visible_time;
+
+			sum.pinch_distance += c.hand.pinch_distance * w;
+			sum.grab_angle += c.hand.grab_angle * w;
+			sum.pinch_strength += c.hand.pinch_strength * w;
+			sum.grab_strength += c.hand.grab_strength * w;
+
+			add_vector(&sum.palm.position, c.hand.palm.position, w);
+			add_vector(&sum.palm.stabilized_position, c.hand.palm.stabilized_position, w);
+			add_vector(&sum.palm.velocity, c.hand.palm.velocity, w);
+			add_vector(&sum.palm.normal, c.hand.palm.normal, w);
+			add_vector(&sum.palm.direction, c.hand.palm.direction, w);
+			sum.palm.width += c.hand.palm.width * w;
+			add_quat(&sum.palm.orientation, c.hand.palm.orientation, best.palm.orientation, w);
+
+			for (int d = 0; d < 5; d++) {
+				for (int b = 0; b < 4; b++) {
+					add_bone(&sum.digits[d].bones[b], c.hand.digits[d].bones[b], best.digits[d].bones[b], w);
+				}
+			}
+			add_bone(&sum.arm, c.hand.arm, best.arm, w);
+		}
+
+		float scale = 1.0f / total_weight;
+		hand->pinch_distance = sum.pinch_distance * scale;
+		hand->grab_angle = sum.grab_angle * scale;
+		hand->pinch_strength = sum.pinch_strength * scale;
+		hand->grab_strength = sum.grab_strength * scale;
+
+		hand->palm.position = sum.palm.position;
+		scale_vector(&hand->palm.position, scale);
+		hand->palm.stabilized_position = sum.palm.stabilized_position;
+		scale_vector(&hand->palm.stabilized_position, scale);
+		hand->palm.velocity = sum.palm.velocity;
+		scale_vector(&hand->palm.velocity, scale);
+		hand->palm.normal = sum.palm.normal;
+		normalize_vector(&hand->palm.normal);
+		hand->palm.direction = sum.palm.direction;
+		normalize_vector(&hand->palm.direction);
+		hand->palm.width = sum.palm.width * scale;
+		hand->palm.orientation = sum.palm.orientation;
+		normalize_quat(&hand->palm.orientation, best.palm.orientation);
+
+		for (int d = 0; d < 5; d++) {
+			for (int b = 0; b < 4; b++) {
+				finish_bone(&hand->digits[d].bones[b], sum.digits[d].bones[b], best.digits[d].bones[b], scale);
+			}
+		}
+		finish_bone(&hand->arm, sum.arm, best.arm, scale);
+	}
+
+	frame_id++;
+	r_frame->event.info.reserved = NULL;
+	r_frame->event.info.frame_id = frame_id;
+	r_frame->event.info.timestamp = newest;
+	r_frame->event.tracking_frame_id = frame_id;
+	r_frame->event.framerate = framerate;
+	r_frame->event.nHands = (uint32_t)hand_count;
+	r_frame->event.pHands = r_frame->hands;
+
+	return true;
+}
@@ -0,0 +1,88 @@
+#ifndef GDLM_HAND_MERGER_H
+#define GDLM_HAND_MERGER_H
+
+#include <stdint.h>
+
+#include "gdlm_frame_buffer.h"
+#include "gdlm_frame_source.h"
+
+// Number of device hands we remember the merged hand for, old entries are replaced once we run out.
+#define GDLM_MERGE_ASSOCIATIONS 64
+
+// Frames more than this much older than the newest frame we merge, in microseconds, are left out.
+// A device that stopped sending frames shouldn't hold on to its hands.
+#define GDLM_MERGE_MAX_AGE_USEC 100000
+
+namespace godot {
+
+// Where a device is in relation to our common space, positions in mm.
+struct gdlm_device_transform {
+	LEAP_QUATERNION rotation;
+	LEAP_VECTOR origin;
+	bool is_identity; // lets us skip transforming hands for our primary device
+};
+
+// Combines the frames of multiple devices into one frame.
+// Hands of all devices are moved into our common space, hands of the same type whose palms are close together
+// are seen as the same hand and fused weighted by their confidence. As a hand moves from one device to another
+// it keeps its merged id, so our scene follows it across devices without being rebound.
+// Merged hand ids are our own and don't relate to the ids LeapC gives out.
+class GDLMHandMerger {
+private:
+	struct association {
+		int device; // index of the device our hand came from, -1 if unused
+		uint32_t leap_id; // id that device gave our hand
+		uint32_t merged_id;
+		uint32_t last_used; // merge in which we last saw this hand
+	};
+
+	// a hand we're merging, already moved into our common space
+	struct candidate {
+		int device;
+		uint32_t leap_id;
+		int type;
+		float weight;
+		int group;
+		LEAP_HAND hand;
+	};
+
+	// hands we've found to be the same hand
+	struct group {
+		uint32_t merged_id;
+		int type;
+		int best; // our candidate with the highest weight
+		uint32_t device_mask; // devices that already contributed a hand
+	};
+
+	float merge_distance; // in mm
+	association associations[GDLM_MERGE_ASSOCIATIONS];
+	candidate candidates[GDLM_MAX_DEVICES * GDLM_MAX_HANDS];
+	group groups[GDLM_MAX_DEVICES * GDLM_MAX_HANDS];
+	uint32_t next_id;
+	uint32_t merge_count;
+	int64_t frame_id;
+
+	uint32_t find_association(int p_device, uint32_t p_leap_id) const;
+	void associate(int p_device, uint32_t p_leap_id, uint32_t p_merged_id);
+	int find_group(const candidate &p_candidate, int p_group_count, uint32_t p_merged_id, float p_max_distance) const;
+
+public:
+	GDLMHandMerger();
+
+	float get_merge_distance() const { return merge_distance; }
+	void set_merge_distance(float p_distance);
+
+	// forget everything, merged ids start over
+	void reset();
+	// forget the hands of device p_device, for instance because another device took its place
+	void forget_device(int p_device);
+
+	// Merges the frames in p_frames into r_frame, p_frames[d] is NULL if device d has nothing for us.
+	// Our merged frame gets a new frame id each time and the timestamp of our newest frame.
+	// Returns false if we had no frames to merge.
+	bool merge(const LEAP_TRACKING_EVENT *const p_frames[GDLM_MAX_DEVICES], const gdlm_device_transform p_transforms[GDLM_MAX_DEVICES], gdlm_frame *r_frame);
+};
+
+} // namespace godot
+
+#endif /* !GDLM_HAND_MERGER_H */
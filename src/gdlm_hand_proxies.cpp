@@ -0,0 +1,106 @@
+#include "gdlm_hand_proxies.h"
+
+#include <math.h>
+
+using namespace godot;
+
+// transforms a joint into the space of our palm
+static inline void to_palm(const gdlm_bone_frame &p_hand_inverse, const LEAP_VECTOR &p_joint, float p_world_scale, float *r_position) {
+	float x = p_joint.x * p_world_scale;
+	float y = p_joint.y * p_world_scale;
+	float z = p_joint.z * p_world_scale;
+	for (int r = 0; r < 3; r++) {
+		const float *row = p_hand_inverse.basis[r];
+		r_position[r] = row[0] * x + row[1] * y + row[2] * z + p_hand_inverse.origin[r];
+	}
+}
+
+// Places a capsule between two joints. Capsules are round so we don't care about their roll,
+// we just need a basis whose z axis points along our bone.
+static void place_capsule(const float *p_from, const float *p_to, float p_radius, gdlm_proxy *r_proxy) {
+	float z[3] = { p_to[0] - p_from[0], p_to[1] - p_from[1], p_to[2] - p_from[2] };
+	float length = sqrtf(z[0] * z[0] + z[1] * z[1] + z[2] * z[2]);
+	if (length > 0.0f) {
+		z[0] /= length;
+		z[1] /= length;
+		z[2] /= length;
+	} else {
+		z[0] = 0.0f;
+		z[1] = 0.0f;
+		z[2] = 1.0f;
+	}
+
+	// x = up.cross(z), unless our bone points straight up in which case we use our x axis as is
+	float x[3] = { z[2], 0.0f, -z[0] };
+	float x_length = sqrtf(x[0] * x[0] + x[2] * x[2]);
+	if (x_length > 0.0001f) {
+		x[0] /= x_length;
+		x[2] /= x_length;
+	} else {
+		x[0] = 1.0f;
+		x[2] = 0.0f;
+	}
+
+	// y = z.cross(x)
+	float y[3] = {
+		z[1] * x[2] - z[2] * x[1],
+		z[2] * x[0] - z[0] * x[2],
+		z[0] * x[1] - z[1] * x[0]
+	};
+
+	// our axis are the columns of our basis
+	for (int r = 0; r < 3; r++) {
+		r_proxy->frame.basis[r][0] = x[r];
+		r_proxy->frame.basis[r][1] = y[r];
+		r_proxy->frame.basis[r][2] = z[r];
+		r_proxy->frame.origin[r] = 0.5f * (p_from[r] + p_to[r]);
+	}
+
+	r_proxy->size[0] = p_radius;
+	r_proxy->size[1] = length;
+	r_proxy->size[2] = 0.0f;
+}
+
+void godot::gdlm_solve_proxies(const LEAP_HAND *p_hand, float p_world_scale, const gdlm_bone_frame &p_hand_inverse, gdlm_hand_proxies *r_proxies) {
+	float from[3];
+	float to[3];
+
+	// our palm is centered on our middle metacarpal and as long as it is, it's aligned with our palm so needs no rotation
+	const LEAP_BONE &middle_metacarpal = p_hand->digits[2].bones[0];
+	to_palm(p_hand_inverse, middle_metacarpal.prev_joint, p_world_scale, from);
+	to_palm(p_hand_inverse, middle_metacarpal.next_joint, p_world_scale, to);
+
+	gdlm_proxy *palm = &r_proxies->proxies[0];
+	float length_sq = 0.0f;
+	for (int r = 0; r < 3; r++) {
+		for (int c = 0; c < 3; c++) {
+			palm->frame.basis[r][c] = r == c ? 1.0f : 0.0f;
+		}
+		palm->frame.origin[r] = 0.5f * (from[r] + to[r]);
+		length_sq += (to[r] - from[r]) * (to[r] - from[r]);
+	}
+	palm->size[0] = 0.5f * p_hand->palm.width * p_world_scale;
+	palm->size[1] = 0.5f * GDLM_PALM_THICKNESS_MM * p_world_scale;
+	palm->size[2] = 0.5f * sqrtf(length_sq);
+
+	// and a capsule for each bone, our thumbs metacarpal has no length so we skip it
+	int p = 1;
+	for (int d = 0; d < 5; d++) {
+		for (int b = d == 0 ? 1 : 0; b < 4; b++) {
+			const LEAP_BONE &bone = p_hand->digits[d].bones[b];
+			to_palm(p_hand_inverse, bone.prev_joint, p_world_scale, from);
+			to_palm(p_hand_inverse, bone.next_joint, p_world_scale, to);
+			place_capsule(from, to, 0.5f * bone.width * p_world_scale, &r_proxies->proxies[p++]);
+		}
+	}
+}
+
+bool godot::gdlm_proxy_resized(const gdlm_proxy &p_proxy, const float *p_size, float p_tolerance) {
+	for (int i = 0; i < 3; i++) {
+		if (fabsf(p_proxy.size[i] - p_size[i]) > p_tolerance) {
+			return true;
+		}
+	}
+
+	return false;
+}
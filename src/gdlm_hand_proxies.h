@@ -0,0 +1,44 @@
+#ifndef GDLM_HAND_PROXIES_H
+#define GDLM_HAND_PROXIES_H
+
+// our leap motion data structures
+#include "gdlm_leap_types.h"
+
+// our bone frames
+#include "gdlm_hand_solver.h"
+
+// Our palm followed by one proxy for each bone of our fingers, our thumb has no metacarpal.
+#define GDLM_HAND_PROXIES 20
+
+// Thickness of the box around our palm in mm, LeapC doesn't tell us how thick a hand is.
+#define GDLM_PALM_THICKNESS_MM 20.0f
+
+// We only reshape our proxies once their size changes by more than this in mm.
+#define GDLM_PROXY_TOLERANCE_MM 1.0f
+
+namespace godot {
+
+// A collision proxy relative to our palm.
+// proxies[0] is a box around our palm and size holds its half extents.
+// The others are capsules around our bones, these lie along their z axis like Godot 3 capsules do,
+// size[0] is their radius and size[1] the length between our joints, size[2] is unused.
+struct gdlm_proxy {
+	gdlm_bone_frame frame;
+	float size[3];
+};
+
+struct gdlm_hand_proxies {
+	gdlm_proxy proxies[GDLM_HAND_PROXIES];
+};
+
+// Places the collision proxies of p_hand relative to p_hand_inverse which should be the inverse of our
+// palm transform, like gdlm_solve_hand. Joint positions and sizes are scaled by p_world_scale.
+void gdlm_solve_proxies(const LEAP_HAND *p_hand, float p_world_scale, const gdlm_bone_frame &p_hand_inverse, gdlm_hand_proxies *r_proxies);
+
+// Returns true if p_proxy differs in size from p_size by more than p_tolerance.
+// Reshaping a physics shape is much more expensive than moving it so we only do so when it matters.
+bool gdlm_proxy_resized(const gdlm_proxy &p_proxy, const float *p_size, float p_tolerance);
+
+} // namespace godot
+
+#endif /* !GDLM_HAND_PROXIES_H */
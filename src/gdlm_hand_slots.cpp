@@ -0,0 +1,205 @@
+#include "gdlm_hand_slots.h"
+
+#include <string.h>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+using namespace godot;
+
+GDLMHandSlots::GDLMHandSlots() {
+	for (int t = 0; t < 2; t++) {
+		scene_mask[t] = 0;
+		pooled_mask[t] = 0;
+		used_mask[t] = 0;
+		active_mask[t] = 0;
+		was_active_mask[t] = 0;
+	}
+
+	memset(leap_ids, 0, sizeof(leap_ids));
+	memset(generations, 0, sizeof(generations));
+
+	for (int i = 0; i < GDLM_HAND_ID_MAP_SIZE; i++) {
+		id_map[i].type = -1;
+	}
+}
+
+int GDLMHandSlots::lowest_slot(uint32_t p_mask) {
+	if (p_mask == 0) {
+		return -1;
+	}
+
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward(&index, p_mask);
+	return (int)index;
+#else
+	return __builtin_ctz(p_mask);
+#endif
+}
+
+int GDLMHandSlots::count_slots(uint32_t p_mask) {
+	// count our bits in parallel, works on every compiler
+	p_mask = p_mask - ((p_mask >> 1) & 0x55555555u);
+	p_mask = (p_mask & 0x33333333u) + ((p_mask >> 2) & 0x33333333u);
+	p_mask = (p_mask + (p_mask >> 4)) & 0x0F0F0F0Fu;
+	return (int)((p_mask * 0x01010101u) >> 24);
+}
+
+uint32_t GDLMHandSlots::hash_id(uint32_t p_leap_id) {
+	// leap ids just count up, multiplying spreads them over our map
+	return (p_leap_id * 2654435761u) >> 16;
+}
+
+void GDLMHandSlots::map_id(int p_type, int p_slot) {
+	uint32_t index = hash_id(leap_ids[p_type][p_slot]) & (GDLM_HAND_ID_MAP_SIZE - 1);
+	while (id_map[index].type != -1) {
+		index = (index + 1) & (GDLM_HAND_ID_MAP_SIZE - 1);
+	}
+
+	id_map[index].leap_id = leap_ids[p_type][p_slot];
+	id_map[index].type = (int8_t)p_type;
+	id_map[index].slot = (int8_t)p_slot;
+	id_map[index].generation = generations[p_type][p_slot];
+}
+
+void GDLMHandSlots::unmap_id(int p_type, uint32_t p_leap_id) {
+	uint32_t index = hash_id(p_leap_id) & (GDLM_HAND_ID_MAP_SIZE - 1);
+	while (id_map[index].type != -1 && (id_map[index].leap_id != p_leap_id || id_map[index].type != p_type)) {
+		index = (index + 1) & (GDLM_HAND_ID_MAP_SIZE - 1);
+	}
+	if (id_map[index].type == -1) {
+		// not mapped
+		return;
+	}
+
+	// Move entries after ours back into the gap we leave, as long as that doesn't put them before their home.
+	// This way our probes never need to skip deleted entries.
+	uint32_t gap = index;
+	uint32_t next = index;
+	while (true) {
+		next = (next + 1) & (GDLM_HAND_ID_MAP_SIZE - 1);
+		if (id_map[next].type == -1) {
+			break;
+		}
+
+		uint32_t home = hash_id(id_map[next].leap_id) & (GDLM_HAND_ID_MAP_SIZE - 1);
+		bool stays = gap <= next ? (gap < home && home <= next) : (gap < home || home <= next);
+		if (!stays) {
+			id_map[gap] = id_map[next];
+			gap = next;
+		}
+	}
+
+	id_map[gap].type = -1;
+}
+
+int GDLMHandSlots::acquire(int p_type) {
+	uint32_t all = 0xFFFFFFFFu >> (32 - GDLM_MAX_HAND_SLOTS);
+	int slot = lowest_slot(all & ~scene_mask[p_type]);
+	if (slot != -1) {
+		scene_mask[p_type] |= 1u << slot;
+	}
+
+	return slot;
+}
+
+void GDLMHandSlots::release(int p_type, int p_slot) {
+	if ((used_mask[p_type] & (1u << p_slot)) != 0) {
+		unbind(p_type, p_slot);
+	}
+
+	uint32_t bit = 1u << p_slot;
+	scene_mask[p_type] &= ~bit;
+	pooled_mask[p_type] &= ~bit;
+}
+
+void GDLMHandSlots::add_to_pool(int p_type, int p_slot) {
+	pooled_mask[p_type] |= 1u << p_slot;
+}
+
+int GDLMHandSlots::take_from_pool(int p_type) {
+	int slot = lowest_slot(pooled_mask[p_type]);
+	if (slot != -1) {
+		pooled_mask[p_type] &= ~(1u << slot);
+	}
+
+	return slot;
+}
+
+void GDLMHandSlots::bind(int p_type, int p_slot, uint32_t p_leap_id) {
+	if ((used_mask[p_type] & (1u << p_slot)) != 0) {
+		if (leap_ids[p_type][p_slot] == p_leap_id) {
+			// nothing changes
+			return;
+		}
+
+		// we're taking over a hand we lost, anyone holding on to our old binding should know
+		unbind(p_type, p_slot);
+	}
+
+	used_mask[p_type] |= 1u << p_slot;
+	leap_ids[p_type][p_slot] = p_leap_id;
+	map_id(p_type, p_slot);
+}
+
+void GDLMHandSlots::unbind(int p_type, int p_slot) {
+	uint32_t bit = 1u << p_slot;
+	if ((used_mask[p_type] & bit) == 0) {
+		return;
+	}
+
+	unmap_id(p_type, leap_ids[p_type][p_slot]);
+	used_mask[p_type] &= ~bit;
+	active_mask[p_type] &= ~bit;
+	was_active_mask[p_type] &= ~bit;
+	generations[p_type][p_slot]++;
+}
+
+int GDLMHandSlots::find(int p_type, uint32_t p_leap_id) const {
+	uint32_t index = hash_id(p_leap_id) & (GDLM_HAND_ID_MAP_SIZE - 1);
+	while (id_map[index].type != -1) {
+		const id_entry &entry = id_map[index];
+		if (entry.leap_id == p_leap_id && entry.type == p_type) {
+			// make sure our slot wasn't given to another hand since
+			bool is_bound = (used_mask[p_type] & (1u << entry.slot)) != 0;
+			return is_bound && generations[p_type][entry.slot] == entry.generation ? entry.slot : -1;
+		}
+		index = (index + 1) & (GDLM_HAND_ID_MAP_SIZE - 1);
+	}
+
+	return -1;
+}
+
+int GDLMHandSlots::find_lost(int p_type) const {
+	// hands that were active in our previous frame but not (yet) in this one aren't lost, they're just not processed yet
+	return lowest_slot(used_mask[p_type] & ~active_mask[p_type] & ~was_active_mask[p_type]);
+}
+
+void GDLMHandSlots::begin_frame() {
+	for (int t = 0; t < 2; t++) {
+		was_active_mask[t] = active_mask[t];
+		active_mask[t] = 0;
+	}
+}
+
+void GDLMHandSlots::mark_active(int p_type, int p_slot) {
+	active_mask[p_type] |= 1u << p_slot;
+}
+
+gdlm_hand_handle GDLMHandSlots::get_handle(int p_type, int p_slot) const {
+	gdlm_hand_handle handle;
+	handle.type = p_type;
+	handle.slot = p_slot;
+	handle.generation = generations[p_type][p_slot];
+	return handle;
+}
+
+bool GDLMHandSlots::is_current(const gdlm_hand_handle &p_handle) const {
+	if (p_handle.type < 0 || p_handle.type > 1 || p_handle.slot < 0 || p_handle.slot >= GDLM_MAX_HAND_SLOTS) {
+		return false;
+	}
+
+	return (used_mask[p_handle.type] & (1u << p_handle.slot)) != 0 && generations[p_handle.type][p_handle.slot] == p_handle.generation;
+}
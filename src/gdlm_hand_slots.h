@@ -0,0 +1,96 @@
+#ifndef GDLM_HAND_SLOTS_H
+#define GDLM_HAND_SLOTS_H
+
+#include <stdint.h>
+
+// Maximum number of hand scenes we keep for each hand type, tracked, recently lost or pooled.
+// Our masks are 32 bits so this can't go above 32.
+#define GDLM_MAX_HAND_SLOTS 16
+
+// Size of our leap id to slot map, a power of two at least twice the number of slots we have so probing stays short.
+#define GDLM_HAND_ID_MAP_SIZE 64
+
+namespace godot {
+
+// Refers to a hand slot, stays recognisable as stale once our slot is given to another hand.
+struct gdlm_hand_handle {
+	int type;
+	int slot;
+	uint32_t generation;
+};
+
+// Bookkeeping for our hand scenes, without any allocation.
+// For each hand type (0 = left, 1 = right) we have a fixed number of slots, a slot:
+// - is free if it has no scene,
+// - is pooled if it has a hidden scene ready for use,
+// - is used if it is bound to a leap id, it is active if that hand is tracked in our current frame.
+// Each state is a bitmask so finding, counting and iterating slots doesn't depend on how many hands we have.
+// Leap ids are mapped to their slots with a small hash map, a slots generation goes up each time it is unbound
+// so map entries and handles that outlive their binding are never mistaken for the hand now using that slot.
+class GDLMHandSlots {
+private:
+	struct id_entry {
+		uint32_t leap_id;
+		int8_t type; // -1 if empty
+		int8_t slot;
+		uint32_t generation;
+	};
+
+	uint32_t scene_mask[2];
+	uint32_t pooled_mask[2];
+	uint32_t used_mask[2];
+	uint32_t active_mask[2];
+	uint32_t was_active_mask[2]; // active in our previous frame
+	uint32_t leap_ids[2][GDLM_MAX_HAND_SLOTS];
+	uint32_t generations[2][GDLM_MAX_HAND_SLOTS];
+	id_entry id_map[GDLM_HAND_ID_MAP_SIZE];
+
+	static uint32_t hash_id(uint32_t p_leap_id);
+	void map_id(int p_type, int p_slot);
+	void unmap_id(int p_type, uint32_t p_leap_id);
+
+public:
+	GDLMHandSlots();
+
+	static int lowest_slot(uint32_t p_mask);
+	static int count_slots(uint32_t p_mask);
+
+	// takes a free slot for a new scene, returns -1 if we're out of slots
+	int acquire(int p_type);
+	// our slots scene is gone, our slot is free again
+	void release(int p_type, int p_slot);
+
+	// pooled slots are hidden scenes ready for use
+	void add_to_pool(int p_type, int p_slot);
+	int take_from_pool(int p_type); // returns -1 if our pool is empty
+
+	// binds our slot to a leap id, if our slot was bound to another id that binding is replaced
+	void bind(int p_type, int p_slot, uint32_t p_leap_id);
+	// unbinds our slot, our scene is still ours to pool or release
+	void unbind(int p_type, int p_slot);
+
+	// returns the slot bound to p_leap_id or -1
+	int find(int p_type, uint32_t p_leap_id) const;
+	// returns a bound slot whose hand was lost before our current frame and hasn't been found again, or -1
+	int find_lost(int p_type) const;
+
+	// starts a new frame, all our slots become inactive until they are marked again
+	void begin_frame();
+	void mark_active(int p_type, int p_slot);
+	bool is_active(int p_type, int p_slot) const { return (active_mask[p_type] & (1u << p_slot)) != 0; }
+
+	uint32_t get_scene_mask(int p_type) const { return scene_mask[p_type]; }
+	uint32_t get_used_mask(int p_type) const { return used_mask[p_type]; }
+	uint32_t get_active_mask(int p_type) const { return active_mask[p_type]; }
+	uint32_t get_pooled_mask(int p_type) const { return pooled_mask[p_type]; }
+	int get_used_count(int p_type) const { return count_slots(used_mask[p_type]); }
+	int get_pooled_count(int p_type) const { return count_slots(pooled_mask[p_type]); }
+
+	gdlm_hand_handle get_handle(int p_type, int p_slot) const;
+	// is our handle still bound to the same hand?
+	bool is_current(const gdlm_hand_handle &p_handle) const;
+};
+
+} // namespace godot
+
+#endif /* !GDLM_HAND_SLOTS_H */
@@ -0,0 +1,266 @@
+#include "gdlm_hand_solver.h"
+
+#include <math.h>
+
+#include "gdlm_simd.h"
+
+// Our five digits are padded to 8 lanes so we can process them 8 (AVX), 4 (SSE) or 1 (scalar) at a time.
+#define GDLM_SOLVER_LANES 8
+
+using namespace godot;
+
+// Our solver state as structure of arrays, one lane per digit.
+struct gdlm_solver_lanes {
+	alignas(32) float parent[12][GDLM_SOLVER_LANES]; // inverse of our parent transform, basis rows then origin
+	alignas(32) float origin[3][GDLM_SOLVER_LANES]; // origin of the bone we're solving, relative to our parent
+	alignas(32) float joint[3][GDLM_SOLVER_LANES]; // next joint of the bone we're solving, in leap motion space
+	alignas(32) float frame[12][GDLM_SOLVER_LANES]; // our solved local frame, basis rows then origin
+	alignas(32) float length[GDLM_SOLVER_LANES]; // length of the bone we solved
+};
+
+static inline lanes dot_lanes(lanes p_ax, lanes p_ay, lanes p_az, lanes p_bx, lanes p_by, lanes p_bz) {
+	return lanes_add(lanes_add(lanes_mul(p_ax, p_bx), lanes_mul(p_ay, p_by)), lanes_mul(p_az, p_bz));
+}
+
+// Solves one bone for every digit, this is the same math as our original per bone code:
+// we bring our next joint into our parents space, build a basis by crossing with up,
+// and multiply our parents inverse with the inverse of our new frame.
+static void solve_step(gdlm_solver_lanes *p_lanes) {
+	for (int i = 0; i < GDLM_SOLVER_LANES; i += GDLM_SIMD_WIDTH) {
+		lanes p[12];
+		for (int e = 0; e < 12; e++) {
+			p[e] = lanes_load(&p_lanes->parent[e][i]);
+		}
+
+		lanes ox = lanes_load(&p_lanes->origin[0][i]);
+		lanes oy = lanes_load(&p_lanes->origin[1][i]);
+		lanes oz = lanes_load(&p_lanes->origin[2][i]);
+		lanes jx = lanes_load(&p_lanes->joint[0][i]);
+		lanes jy = lanes_load(&p_lanes->joint[1][i]);
+		lanes jz = lanes_load(&p_lanes->joint[2][i]);
+
+		// transform our joint into our parents space and remove our origin to get our delta
+		lanes vx = lanes_sub(lanes_add(dot_lanes(p[0], p[1], p[2], jx, jy, jz), p[9]), ox);
+		lanes vy = lanes_sub(lanes_add(dot_lanes(p[3], p[4], p[5], jx, jy, jz), p[10]), oy);
+		lanes vz = lanes_sub(lanes_add(dot_lanes(p[6], p[7], p[8], jx, jy, jz), p[11]), oz);
+
+		// our z axis points along our bone
+		lanes len = lanes_sqrt(dot_lanes(vx, vy, vz, vx, vy, vz));
+		lanes zx = lanes_safe_div(vx, len);
+		lanes zy = lanes_safe_div(vy, len);
+		lanes zz = lanes_safe_div(vz, len);
+
+		// x = up.cross(z), with up being (0, 1, 0) our y component is always zero
+		lanes zero = lanes_set(0.0f);
+		lanes x_len = lanes_sqrt(lanes_add(lanes_mul(zz, zz), lanes_mul(zx, zx)));
+		lanes xx = lanes_safe_div(zz, x_len);
+		lanes xz = lanes_safe_div(lanes_sub(zero, zx), x_len);
+
+		// y = z.cross(x)
+		lanes yx = lanes_mul(zy, xz);
+		lanes yy = lanes_sub(lanes_mul(zz, xx), lanes_mul(zx, xz));
+		lanes yz = lanes_sub(zero, lanes_mul(zy, xx));
+		lanes y_len = lanes_sqrt(dot_lanes(yx, yy, yz, yx, yy, yz));
+		yx = lanes_safe_div(yx, y_len);
+		yy = lanes_safe_div(yy, y_len);
+		yz = lanes_safe_div(yz, y_len);
+
+		// our axis are the columns of our basis
+		lanes_store(&p_lanes->frame[0][i], xx);
+		lanes_store(&p_lanes->frame[1][i], yx);
+		lanes_store(&p_lanes->frame[2][i], zx);
+		lanes_store(&p_lanes->frame[3][i], zero);
+		lanes_store(&p_lanes->frame[4][i], yy);
+		lanes_store(&p_lanes->frame[5][i], zy);
+		lanes_store(&p_lanes->frame[6][i], xz);
+		lanes_store(&p_lanes->frame[7][i], yz);
+		lanes_store(&p_lanes->frame[8][i], zz);
+		lanes_store(&p_lanes->frame[9][i], ox);
+		lanes_store(&p_lanes->frame[10][i], oy);
+		lanes_store(&p_lanes->frame[11][i], oz);
+		lanes_store(&p_lanes->length[i], len);
+
+		// Our basis is orthonormal so its inverse is its transpose, whose rows are our axis.
+		// parent = frame.inverse() * parent
+		for (int c = 0; c < 3; c++) {
+			lanes_store(&p_lanes->parent[c][i], dot_lanes(xx, zero, xz, p[c], p[3 + c], p[6 + c]));
+			lanes_store(&p_lanes->parent[3 + c][i], dot_lanes(yx, yy, yz, p[c], p[3 + c], p[6 + c]));
+			lanes_store(&p_lanes->parent[6 + c][i], dot_lanes(zx, zy, zz, p[c], p[3 + c], p[6 + c]));
+		}
+
+		lanes dx = lanes_sub(p[9], ox);
+		lanes dy = lanes_sub(p[10], oy);
+		lanes dz = lanes_sub(p[11], oz);
+		lanes_store(&p_lanes->parent[9][i], dot_lanes(xx, zero, xz, dx, dy, dz));
+		lanes_store(&p_lanes->parent[10][i], dot_lanes(yx, yy, yz, dx, dy, dz));
+		lanes_store(&p_lanes->parent[11][i], dot_lanes(zx, zy, zz, dx, dy, dz));
+
+		// and our next bone starts at the end of this one
+		lanes_store(&p_lanes->origin[0][i], zero);
+		lanes_store(&p_lanes->origin[1][i], zero);
+		lanes_store(&p_lanes->origin[2][i], len);
+	}
+}
+
+static inline void set_identity(gdlm_bone_frame *r_frame) {
+	for (int r = 0; r < 3; r++) {
+		for (int c = 0; c < 3; c++) {
+			r_frame->basis[r][c] = r == c ? 1.0f : 0.0f;
+		}
+	}
+}
+
+void godot::gdlm_solve_hand(const LEAP_HAND *p_hand, float p_world_scale, const gdlm_bone_frame &p_hand_inverse, gdlm_hand_frames *r_frames) {
+	gdlm_solver_lanes solver;
+
+	// our padding lanes simply repeat our pinky
+	for (int l = 0; l < GDLM_SOLVER_LANES; l++) {
+		const LEAP_VECTOR &start = p_hand->digits[l < 5 ? l : 4].bones[0].prev_joint;
+		float sx = start.x * p_world_scale;
+		float sy = start.y * p_world_scale;
+		float sz = start.z * p_world_scale;
+
+		for (int r = 0; r < 3; r++) {
+			for (int c = 0; c < 3; c++) {
+				solver.parent[r * 3 + c][l] = p_hand_inverse.basis[r][c];
+			}
+			solver.parent[9 + r][l] = p_hand_inverse.origin[r];
+
+			// Our first bone provides our starting position
+			const float *row = p_hand_inverse.basis[r];
+			solver.origin[r][l] = row[0] * sx + row[1] * sy + row[2] * sz + p_hand_inverse.origin[r];
+		}
+	}
+
+	// Our thumb has one bone less, it simply runs a bone ahead and we ignore its last step.
+	float tip_length[5];
+	for (int s = 0; s < 4; s++) {
+		for (int l = 0; l < GDLM_SOLVER_LANES; l++) {
+			int d = l < 5 ? l : 4;
+			int b = d == 0 ? (s < 3 ? s + 1 : 3) : s;
+			const LEAP_VECTOR &joint = p_hand->digits[d].bones[b].next_joint;
+			solver.joint[0][l] = joint.x * p_world_scale;
+			solver.joint[1][l] = joint.y * p_world_scale;
+			solver.joint[2][l] = joint.z * p_world_scale;
+		}
+
+		solve_step(&solver);
+
+		for (int d = 0; d < 5; d++) {
+			int steps = d == 0 ? 3 : 4;
+			if (s < steps) {
+				gdlm_bone_frame *frame = &r_frames->frames[d][s];
+				for (int e = 0; e < 9; e++) {
+					frame->basis[e / 3][e % 3] = solver.frame[e][d];
+				}
+				for (int e = 0; e < 3; e++) {
+					frame->origin[e] = solver.frame[9 + e][d];
+				}
+				tip_length[d] = solver.length[d];
+			}
+		}
+	}
+
+	// and our finger tips are placed at the end of our last bone
+	for (int d = 0; d < 5; d++) {
+		gdlm_bone_frame *tip = &r_frames->frames[d][d == 0 ? 3 : 4];
+		set_identity(tip);
+		tip->origin[0] = 0.0f;
+		tip->origin[1] = 0.0f;
+		tip->origin[2] = tip_length[d];
+	}
+}
+
+// Quaternion helpers for our rotation based solver, LEAP_QUATERNION is laid out as x, y, z, w.
+
+static inline LEAP_QUATERNION quat_mul(const LEAP_QUATERNION &p_a, const LEAP_QUATERNION &p_b) {
+	LEAP_QUATERNION r;
+	r.x = p_a.w * p_b.x + p_a.x * p_b.w + p_a.y * p_b.z - p_a.z * p_b.y;
+	r.y = p_a.w * p_b.y + p_a.y * p_b.w + p_a.z * p_b.x - p_a.x * p_b.z;
+	r.z = p_a.w * p_b.z + p_a.z * p_b.w + p_a.x * p_b.y - p_a.y * p_b.x;
+	r.w = p_a.w * p_b.w - p_a.x * p_b.x - p_a.y * p_b.y - p_a.z * p_b.z;
+	return r;
+}
+
+static inline LEAP_QUATERNION quat_inverse(const LEAP_QUATERNION &p_q) {
+	// LeapC gives us unit quaternions so our conjugate is our inverse
+	LEAP_QUATERNION r;
+	r.x = -p_q.x;
+	r.y = -p_q.y;
+	r.z = -p_q.z;
+	r.w = p_q.w;
+	return r;
+}
+
+// LeapC bones point along their -Z axis while our nodes point along +Z, turning 180 degrees around Y fixes this.
+static inline LEAP_QUATERNION bone_rotation(const LEAP_BONE &p_bone) {
+	LEAP_QUATERNION fix;
+	fix.x = 0.0f;
+	fix.y = 1.0f;
+	fix.z = 0.0f;
+	fix.w = 0.0f;
+	return quat_mul(p_bone.rotation, fix);
+}
+
+// rotates the vector from p_from to p_to into the space of p_inverse
+static inline void rotate_delta(float *r_vector, const LEAP_QUATERNION &p_inverse, const LEAP_VECTOR &p_from, const LEAP_VECTOR &p_to, float p_world_scale) {
+	LEAP_QUATERNION v;
+	v.x = (p_to.x - p_from.x) * p_world_scale;
+	v.y = (p_to.y - p_from.y) * p_world_scale;
+	v.z = (p_to.z - p_from.z) * p_world_scale;
+	v.w = 0.0f;
+
+	LEAP_QUATERNION r = quat_mul(quat_mul(p_inverse, v), quat_inverse(p_inverse));
+	r_vector[0] = r.x;
+	r_vector[1] = r.y;
+	r_vector[2] = r.z;
+}
+
+// same as constructing a Godot Basis from a Quat
+static void set_rotation(gdlm_bone_frame *r_frame, const LEAP_QUATERNION &p_q) {
+	float d = p_q.x * p_q.x + p_q.y * p_q.y + p_q.z * p_q.z + p_q.w * p_q.w;
+	float s = 2.0f / d;
+	float xs = p_q.x * s, ys = p_q.y * s, zs = p_q.z * s;
+	float wx = p_q.w * xs, wy = p_q.w * ys, wz = p_q.w * zs;
+	float xx = p_q.x * xs, xy = p_q.x * ys, xz = p_q.x * zs;
+	float yy = p_q.y * ys, yz = p_q.y * zs, zz = p_q.z * zs;
+
+	r_frame->basis[0][0] = 1.0f - (yy + zz);
+	r_frame->basis[0][1] = xy - wz;
+	r_frame->basis[0][2] = xz + wy;
+	r_frame->basis[1][0] = xy + wz;
+	r_frame->basis[1][1] = 1.0f - (xx + zz);
+	r_frame->basis[1][2] = yz - wx;
+	r_frame->basis[2][0] = xz - wy;
+	r_frame->basis[2][1] = yz + wx;
+	r_frame->basis[2][2] = 1.0f - (xx + yy);
+}
+
+void godot::gdlm_solve_hand_rotations(const LEAP_HAND *p_hand, float p_world_scale, gdlm_hand_frames *r_frames) {
+	for (int d = 0; d < 5; d++) {
+		const LEAP_DIGIT &digit = p_hand->digits[d];
+
+		// our first bone is relative to our palm, we skip the first bone for our thumb
+		int first_bone = d == 0 ? 1 : 0;
+		LEAP_QUATERNION parent_rotation = p_hand->palm.orientation;
+		const LEAP_VECTOR *parent_position = &p_hand->palm.position;
+
+		for (int b = first_bone; b < 4; b++) {
+			const LEAP_BONE &bone = digit.bones[b];
+			LEAP_QUATERNION rotation = bone_rotation(bone);
+			LEAP_QUATERNION parent_inverse = quat_inverse(parent_rotation);
+
+			gdlm_bone_frame *frame = &r_frames->frames[d][b - first_bone];
+			set_rotation(frame, quat_mul(parent_inverse, rotation));
+			rotate_delta(frame->origin, parent_inverse, *parent_position, bone.prev_joint, p_world_scale);
+
+			parent_rotation = rotation;
+			parent_position = &bone.prev_joint;
+		}
+
+		// and our finger tip is placed at the end of our last bone
+		gdlm_bone_frame *tip = &r_frames->frames[d][4 - first_bone];
+		set_identity(tip);
+		rotate_delta(tip->origin, quat_inverse(parent_rotation), *parent_position, digit.bones[3].next_joint, p_world_scale);
+	}
+}
@@ -0,0 +1,35 @@
+#ifndef GDLM_HAND_SOLVER_H
+#define GDLM_HAND_SOLVER_H
+
+// our leap motion data structures
+#include "gdlm_leap_types.h"
+
+namespace godot {
+
+// A bone frame laid out like a Godot Transform, basis[row][column] followed by our origin.
+struct gdlm_bone_frame {
+	float basis[3][3];
+	float origin[3];
+};
+
+// The local frames for all bones of a hand, laid out like the nodes in our hand scenes.
+// frames[d][0] is the frame for the finger node, frames[d][1..] for the digit nodes that follow,
+// the last of which is our finger tip. Our thumb is one bone short so only uses frames[0][0..3].
+struct gdlm_hand_frames {
+	gdlm_bone_frame frames[5][5];
+};
+
+// Solves the local frames of all bones of p_hand, relative to p_hand_inverse which should be
+// the inverse of our palm transform. Joint positions are scaled by p_world_scale.
+// All five digits are solved side by side in SIMD lanes where supported, this produces the same
+// frames as solving each bone in turn by crossing with an up vector.
+void gdlm_solve_hand(const LEAP_HAND *p_hand, float p_world_scale, const gdlm_bone_frame &p_hand_inverse, gdlm_hand_frames *r_frames);
+
+// Solves the same local frames using the bone rotations reported by LeapC, each local rotation is
+// the inverse of our parents rotation multiplied by our bones rotation. This keeps the roll of each
+// bone and doesn't fail on sharp bends, but the frames are not identical to gdlm_solve_hand.
+void gdlm_solve_hand_rotations(const LEAP_HAND *p_hand, float p_world_scale, gdlm_hand_frames *r_frames);
+
+} // namespace godot
+
+#endif /* !GDLM_HAND_SOLVER_H */
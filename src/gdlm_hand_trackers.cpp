@@ -0,0 +1,123 @@
+#include "gdlm_hand_trackers.h"
+
+#include <stddef.h>
+
+using namespace godot;
+
+// same as constructing a Godot Transform from our palm orientation and position
+static void set_palm_pose(const LEAP_PALM &p_palm, gdlm_bone_frame *r_pose) {
+	const LEAP_QUATERNION &q = p_palm.orientation;
+	float d = q.x * q.x + q.y * q.y + q.z * q.z + q.w * q.w;
+	float s = d > 0.0f ? 2.0f / d : 0.0f;
+	float xs = q.x * s, ys = q.y * s, zs = q.z * s;
+	float wx = q.w * xs, wy = q.w * ys, wz = q.w * zs;
+	float xx = q.x * xs, xy = q.x * ys, xz = q.x * zs;
+	float yy = q.y * ys, yz = q.y * zs, zz = q.z * zs;
+
+	r_pose->basis[0][0] = 1.0f - (yy + zz);
+	r_pose->basis[0][1] = xy - wz;
+	r_pose->basis[0][2] = xz + wy;
+	r_pose->basis[1][0] = xy + wz;
+	r_pose->basis[1][1] = 1.0f - (xx + zz);
+	r_pose->basis[1][2] = yz - wx;
+	r_pose->basis[2][0] = xz - wy;
+	r_pose->basis[2][1] = yz + wx;
+	r_pose->basis[2][2] = 1.0f - (xx + yy);
+
+	// LeapC works in mm
+	r_pose->origin[0] = p_palm.position.x * 0.001f;
+	r_pose->origin[1] = p_palm.position.y * 0.001f;
+	r_pose->origin[2] = p_palm.position.z * 0.001f;
+}
+
+GDLMHandTrackers::GDLMHandTrackers() {
+	reset();
+}
+
+void GDLMHandTrackers::reset() {
+	for (int t = 0; t < 2; t++) {
+		trackers[t].is_tracking = false;
+		trackers[t].leap_id = 0;
+		trackers[t].unused_frames = 0;
+		trackers[t].filter.reset();
+		trackers[t].gestures.reset();
+	}
+}
+
+void GDLMHandTrackers::update(const LEAP_TRACKING_EVENT *p_frame, const gdlm_filter_params *p_filter_params, const gdlm_gesture_params &p_gesture_params, uint32_t p_keep_frames, bool p_keep_last, uint32_t *r_changes) {
+	// find the first hand of each type
+	const LEAP_HAND *found[2] = { NULL, NULL };
+	for (uint32_t h = 0; h < p_frame->nHands; h++) {
+		const LEAP_HAND *hand = &p_frame->pHands[h];
+		int type = hand->type == eLeapHandType_Left ? 0 : 1;
+		if (found[type] == NULL) {
+			found[type] = hand;
+		}
+	}
+
+	for (int t = 0; t < 2; t++) {
+		gdlm_hand_tracker &tracker = trackers[t];
+		r_changes[t] = 0;
+
+		if (found[t] == NULL) {
+			if (!tracker.is_tracking) {
+				continue;
+			}
+
+			// lost tracking for awhile now? let go of whatever we were holding and remove our tracker
+			tracker.unused_frames++;
+			if (tracker.unused_frames > p_keep_frames && !p_keep_last) {
+				r_changes[t] = tracker.gestures.release() | TRACKER_REMOVED;
+				tracker.is_tracking = false;
+			}
+			continue;
+		}
+
+		if (!tracker.is_tracking) {
+			tracker.is_tracking = true;
+			tracker.leap_id = found[t]->id;
+			tracker.filter.reset();
+			tracker.gestures.reset();
+			r_changes[t] |= TRACKER_ADDED;
+		} else if (tracker.leap_id != found[t]->id) {
+			// we're following a different hand now, don't smooth towards where our old one was
+			tracker.leap_id = found[t]->id;
+			tracker.filter.reset();
+		}
+		tracker.unused_frames = 0;
+
+		if (p_filter_params[t].min_cutoff > 0.0f) {
+			tracker.filter.filter(found[t], p_frame->info.timestamp, p_filter_params[t], &tracker.hand);
+		} else {
+			tracker.hand = *found[t];
+		}
+
+		set_palm_pose(tracker.hand.palm, &tracker.pose);
+		r_changes[t] |= tracker.gestures.update(&tracker.hand, p_gesture_params) | TRACKER_UPDATED;
+	}
+}
+
+void GDLMHandTrackers::refresh(const LEAP_TRACKING_EVENT *p_frame, const gdlm_filter_params *p_filter_params, uint32_t *r_changes) {
+	r_changes[0] = 0;
+	r_changes[1] = 0;
+
+	for (uint32_t h = 0; h < p_frame->nHands; h++) {
+		const LEAP_HAND *hand = &p_frame->pHands[h];
+		int type = hand->type == eLeapHandType_Left ? 0 : 1;
+		gdlm_hand_tracker &tracker = trackers[type];
+
+		// only the hand we're following, picking up a different hand is left to update
+		if (!tracker.is_tracking || tracker.leap_id != hand->id || r_changes[type] != 0) {
+			continue;
+		}
+
+		if (p_filter_params[type].min_cutoff > 0.0f) {
+			tracker.filter.filter(hand, p_frame->info.timestamp, p_filter_params[type], &tracker.hand);
+		} else {
+			tracker.hand = *hand;
+		}
+
+		set_palm_pose(tracker.hand.palm, &tracker.pose);
+		r_changes[type] = TRACKER_UPDATED;
+	}
+}
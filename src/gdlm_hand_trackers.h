@@ -0,0 +1,61 @@
+#ifndef GDLM_HAND_TRACKERS_H
+#define GDLM_HAND_TRACKERS_H
+
+#include <stdint.h>
+
+// our leap motion data structures
+#include "gdlm_leap_types.h"
+
+#include "gdlm_hand_filter.h"
+#include "gdlm_hand_gestures.h"
+#include "gdlm_hand_solver.h"
+
+namespace godot {
+
+// What we know about the tracker for one hand type.
+struct gdlm_hand_tracker {
+	bool is_tracking; // do we have a tracker for this hand type?
+	uint32_t leap_id; // the hand we're following
+	uint32_t unused_frames; // number of frames since we last saw our hand
+	GDLMHandFilter filter; // smooths our hand, reset whenever we start following a different hand
+	GDLMHandGestures gestures; // is our hand pinching or grabbing
+	LEAP_HAND hand; // our hand after filtering
+	gdlm_bone_frame pose; // our palm in leap motion space, in meters
+};
+
+// Follows the first left and the first right hand in our frames so they can be handed to Godots ARVR server as
+// positional trackers. This only decides what our trackers should do, our sensor registers and updates the actual
+// trackers, so this doesn't depend on Godot and we can benchmark it.
+class GDLMHandTrackers {
+private:
+	gdlm_hand_tracker trackers[2]; // 0 = left, 1 = right
+
+public:
+	enum {
+		// PINCH_CHANGED and GRAB_CHANGED from GDLMHandGestures are reported as is
+		TRACKER_ADDED = 0x04, // register a tracker for this hand type
+		TRACKER_UPDATED = 0x08, // our pose and hand have changed
+		TRACKER_REMOVED = 0x10 // our hand is gone, remove our tracker
+	};
+
+	GDLMHandTrackers();
+
+	// forget all our hands, without reporting any changes
+	void reset();
+
+	// Updates our trackers from p_frame, r_changes receives what happened to our left and right tracker.
+	// p_filter_params holds the filter settings for our left and right hand.
+	// We keep following a hand for p_keep_frames frames after we lose it, or for as long as it takes if p_keep_last is set.
+	void update(const LEAP_TRACKING_EVENT *p_frame, const gdlm_filter_params *p_filter_params, const gdlm_gesture_params &p_gesture_params, uint32_t p_keep_frames, bool p_keep_last, uint32_t *r_changes);
+
+	// Only moves the trackers we already have to where their hands are in p_frame, r_changes receives TRACKER_UPDATED
+	// for each tracker we moved. Trackers are never added or removed, nor do we count frames or change gestures here,
+	// so this can be called in between calls to update without making our trackers go away sooner.
+	void refresh(const LEAP_TRACKING_EVENT *p_frame, const gdlm_filter_params *p_filter_params, uint32_t *r_changes);
+
+	const gdlm_hand_tracker &get_tracker(int p_type) const { return trackers[p_type]; }
+};
+
+} // namespace godot
+
+#endif /* !GDLM_HAND_TRACKERS_H */
@@ -0,0 +1,232 @@
+#include "gdlm_image_stream.h"
+
+#include <string.h>
+
+// Number of source pixels of a row we add up at a time.
+#define GDLM_IMAGE_CHUNK 2048
+
+using namespace godot;
+
+static inline int clamp_int(int p_value, int p_min, int p_max) {
+	return p_value < p_min ? p_min : (p_value > p_max ? p_max : p_value);
+}
+
+// Averages each block of n x n pixels so we don't alias, rounded to nearest.
+// We first add up the n rows of a block with plain adds over contiguous pixels which our compiler vectorises,
+// then add up each n of those sums and divide by multiplying with a fixed point reciprocal.
+// With n at most GDLM_MAX_DOWNSAMPLE our row sums fit in 16 bits, and our block sums stay below 2^20 which
+// makes our 32 bit reciprocal exact, we give the same result as (sum + n * n / 2) / (n * n).
+static void downsample(const uint8_t *p_src, int p_width, int p_out_width, int p_out_height, int p_n, uint8_t *r_pixels) {
+	uint16_t sums[GDLM_IMAGE_CHUNK];
+	uint32_t area = (uint32_t)(p_n * p_n);
+	uint64_t reciprocal = ((uint64_t)1 << 32) / area + 1;
+	int chunk_width = GDLM_IMAGE_CHUNK / p_n; // downsampled pixels per chunk
+	for (int y = 0; y < p_out_height; y++) {
+		const uint8_t *row = p_src + y * p_n * p_width;
+		uint8_t *dst = r_pixels + y * p_out_width;
+		for (int chunk = 0; chunk < p_out_width; chunk += chunk_width) {
+			int count = p_out_width - chunk < chunk_width ? p_out_width - chunk : chunk_width;
+			int columns = count * p_n;
+			const uint8_t *p = row + chunk * p_n;
+			for (int x = 0; x < columns; x++) {
+				sums[x] = p[x];
+			}
+			for (int by = 1; by < p_n; by++) {
+				p += p_width;
+				for (int x = 0; x < columns; x++) {
+					sums[x] += p[x];
+				}
+			}
+
+			const uint16_t *s = sums;
+			for (int x = 0; x < count; x++) {
+				uint32_t sum = area / 2;
+				for (int bx = 0; bx < p_n; bx++) {
+					sum += s[bx];
+				}
+				s += p_n;
+				dst[chunk + x] = (uint8_t)((sum * reciprocal) >> 32);
+			}
+		}
+	}
+}
+
+// Same for the block sizes we expect to be used most, with our block size known our compiler can vectorise this
+// which makes it many times faster.
+template <int N>
+static void downsample_fixed(const uint8_t *p_src, int p_width, int p_out_width, int p_out_height, uint8_t *r_pixels) {
+	for (int y = 0; y < p_out_height; y++) {
+		const uint8_t *row = p_src + y * N * p_width;
+		uint8_t *dst = r_pixels + y * p_out_width;
+		for (int x = 0; x < p_out_width; x++) {
+			uint32_t sum = 0;
+			for (int by = 0; by < N; by++) {
+				for (int bx = 0; bx < N; bx++) {
+					sum += row[by * p_width + x * N + bx];
+				}
+			}
+			dst[x] = (uint8_t)((sum + N * N / 2) / (N * N));
+		}
+	}
+}
+
+bool godot::gdlm_copy_image(const LEAP_IMAGE *p_image, const gdlm_image_settings &p_settings, uint8_t *r_pixels, uint32_t *r_width, uint32_t *r_height) {
+	const LEAP_IMAGE_PROPERTIES &properties = p_image->properties;
+	if (properties.bpp != 1 || p_image->data == NULL || properties.width == 0 || properties.height == 0) {
+		return false;
+	}
+
+	// our crop region in pixels, always at least one pixel
+	int width = (int)properties.width;
+	int height = (int)properties.height;
+	int crop_x = clamp_int((int)(p_settings.crop_x * (float)width), 0, width - 1);
+	int crop_y = clamp_int((int)(p_settings.crop_y * (float)height), 0, height - 1);
+	int crop_width = clamp_int((int)(p_settings.crop_width * (float)width + 0.5f), 1, width - crop_x);
+	int crop_height = clamp_int((int)(p_settings.crop_height * (float)height + 0.5f), 1, height - crop_y);
+
+	// downsample further if we don't fit, but never below a single pixel
+	int n = p_settings.downsample < 1 ? 1 : p_settings.downsample;
+	while ((crop_width / n) * (crop_height / n) > GDLM_MAX_IMAGE_BYTES) {
+		n *= 2;
+	}
+	n = clamp_int(n, 1, crop_width < crop_height ? crop_width : crop_height);
+	if (n > GDLM_MAX_DOWNSAMPLE) {
+		n = GDLM_MAX_DOWNSAMPLE;
+		if ((crop_width / n) * (crop_height / n) > GDLM_MAX_IMAGE_BYTES) {
+			// way larger than any camera image we know of
+			return false;
+		}
+	}
+
+	int out_width = crop_width / n;
+	int out_height = crop_height / n;
+	const uint8_t *src = (const uint8_t *)p_image->data + p_image->offset + crop_y * width + crop_x;
+
+	if (n == 1) {
+		for (int y = 0; y < out_height; y++) {
+			memcpy(r_pixels + y * out_width, src + y * width, out_width);
+		}
+	} else if (n == 2) {
+		downsample_fixed<2>(src, width, out_width, out_height, r_pixels);
+	} else if (n == 4) {
+		downsample_fixed<4>(src, width, out_width, out_height, r_pixels);
+	} else {
+		downsample(src, width, out_width, out_height, n, r_pixels);
+	}
+
+	*r_width = (uint32_t)out_width;
+	*r_height = (uint32_t)out_height;
+	return true;
+}
+
+GDLMImageStream::GDLMImageStream() {
+	storage = NULL;
+	for (int i = 0; i < 3; i++) {
+		images[i].frame_id = 0;
+		images[i].timestamp = 0;
+		images[i].width = 0;
+		images[i].height = 0;
+		images[i].pixels[0] = NULL;
+		images[i].pixels[1] = NULL;
+	}
+
+	enabled.store(false);
+	front = 0;
+	middle.store(1);
+	back = 2;
+
+	settings.crop_x = 0.0f;
+	settings.crop_y = 0.0f;
+	settings.crop_width = 1.0f;
+	settings.crop_height = 1.0f;
+	settings.downsample = 1;
+
+	received.store(0);
+	dropped.store(0);
+}
+
+GDLMImageStream::~GDLMImageStream() {
+	// our writer is gone by now
+	if (storage != NULL) {
+		delete[] storage;
+		storage = NULL;
+	}
+}
+
+void GDLMImageStream::set_enabled(bool p_set) {
+	if (p_set && storage == NULL) {
+		// allocate our buffers before our writer can see we're enabled
+		storage = new uint8_t[6 * GDLM_MAX_IMAGE_BYTES];
+		for (int i = 0; i < 3; i++) {
+			images[i].pixels[0] = storage + (2 * i) * GDLM_MAX_IMAGE_BYTES;
+			images[i].pixels[1] = storage + (2 * i + 1) * GDLM_MAX_IMAGE_BYTES;
+		}
+	}
+
+	enabled.store(p_set, std::memory_order_release);
+}
+
+gdlm_image_settings GDLMImageStream::get_settings() {
+	std::lock_guard<std::mutex> guard(settings_mutex);
+	return settings;
+}
+
+void GDLMImageStream::set_settings(const gdlm_image_settings &p_settings) {
+	std::lock_guard<std::mutex> guard(settings_mutex);
+	settings = p_settings;
+}
+
+bool GDLMImageStream::write(const LEAP_IMAGE_EVENT *p_event) {
+	if (!is_enabled()) {
+		return false;
+	}
+
+	gdlm_image_settings current = get_settings();
+	gdlm_image_pair &pair = images[back];
+	uint32_t width[2];
+	uint32_t height[2];
+	for (int c = 0; c < 2; c++) {
+		if (!gdlm_copy_image(&p_event->image[c], current, pair.pixels[c], &width[c], &height[c])) {
+			return false;
+		}
+	}
+
+	// both cameras of a device have the same resolution, we don't know what to do with a pair that doesn't
+	if (width[0] != width[1] || height[0] != height[1]) {
+		return false;
+	}
+
+	pair.width = width[0];
+	pair.height = height[0];
+	pair.frame_id = p_event->info.frame_id;
+	pair.timestamp = p_event->info.timestamp;
+
+	// publish our back buffer and take whatever was in the middle as our new back buffer,
+	// if our reader never picked that up we've dropped it
+	uint32_t old_middle = middle.exchange(back | NEW_IMAGE, std::memory_order_acq_rel);
+	back = old_middle & INDEX_MASK;
+
+	received.fetch_add(1, std::memory_order_relaxed);
+	if ((old_middle & NEW_IMAGE) != 0) {
+		dropped.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	return true;
+}
+
+const gdlm_image_pair *GDLMImageStream::read() {
+	if ((middle.load(std::memory_order_relaxed) & NEW_IMAGE) == 0) {
+		return NULL;
+	}
+
+	// swap our front buffer with the newly published middle buffer
+	uint32_t old_middle = middle.exchange(front, std::memory_order_acq_rel);
+	front = old_middle & INDEX_MASK;
+
+	return &images[front];
+}
+
+void GDLMImageStream::reset_stats() {
+	received.store(0, std::memory_order_relaxed);
+	dropped.store(0, std::memory_order_relaxed);
+}
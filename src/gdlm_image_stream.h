@@ -0,0 +1,92 @@
+#ifndef GDLM_IMAGE_STREAM_H
+#define GDLM_IMAGE_STREAM_H
+
+#include <atomic>
+#include <mutex>
+#include <stdint.h>
+
+// our leap motion data structures
+#include "gdlm_leap_types.h"
+
+// Room we preallocate for each camera image in bytes. Leap motion devices send 8 bit IR images well below this,
+// larger images are downsampled further until they fit.
+#define GDLM_MAX_IMAGE_BYTES (1024 * 1024)
+
+// Largest block of pixels we average, larger values of image_downsample are clamped to this.
+#define GDLM_MAX_DOWNSAMPLE 64
+
+namespace godot {
+
+// Which part of our camera images we keep and at what resolution.
+struct gdlm_image_settings {
+	// region we keep, relative to the size of our images so it doesn't depend on our device
+	float crop_x;
+	float crop_y;
+	float crop_width;
+	float crop_height;
+	int downsample; // we average blocks of downsample x downsample pixels, 1 keeps our full resolution
+};
+
+// A stereo pair of 8 bit images as we hand them to Godot.
+struct gdlm_image_pair {
+	int64_t frame_id;
+	int64_t timestamp;
+	uint32_t width; // of each image
+	uint32_t height;
+	uint8_t *pixels[2]; // left and right, width * height bytes each, points into our preallocated buffers
+};
+
+// Copies the cropped and downsampled pixels of p_image into r_pixels, which holds GDLM_MAX_IMAGE_BYTES.
+// Returns false if we can't use this image, we only handle 8 bit images.
+bool gdlm_copy_image(const LEAP_IMAGE *p_image, const gdlm_image_settings &p_settings, uint8_t *r_pixels, uint32_t *r_width, uint32_t *r_height);
+
+// Triple buffer for handing camera images from our leap motion thread to Godots main thread, works like GDLMFrameBuffer.
+// Images Godot doesn't pick up in time are replaced by newer ones, we never queue images.
+// Our buffers are allocated the first time we're enabled and kept until we're destroyed, so our writer never allocates
+// and never has to worry about our buffers going away.
+class GDLMImageStream {
+private:
+	enum {
+		INDEX_MASK = 0x03,
+		NEW_IMAGE = 0x04
+	};
+
+	gdlm_image_pair images[3];
+	uint8_t *storage; // the pixels of all our images, NULL until we're first enabled
+	std::atomic<bool> enabled;
+	std::atomic<uint32_t> middle; // index of our middle buffer, NEW_IMAGE is set if the writer published into it
+	uint32_t back; // only accessed by our writer
+	uint32_t front; // only accessed by our reader
+
+	std::mutex settings_mutex; // only contested when our settings change
+	gdlm_image_settings settings;
+
+	std::atomic<uint64_t> received;
+	std::atomic<uint64_t> dropped; // images our reader never picked up
+
+public:
+	GDLMImageStream();
+	~GDLMImageStream();
+
+	// called from Godots thread
+	void set_enabled(bool p_set);
+	bool is_enabled() const { return enabled.load(std::memory_order_acquire); }
+	gdlm_image_settings get_settings();
+	void set_settings(const gdlm_image_settings &p_settings);
+
+	// called from the writer, copies our images into our back buffer and publishes them.
+	// Returns false if we're not enabled or couldn't use these images.
+	bool write(const LEAP_IMAGE_EVENT *p_event);
+
+	// called from the reader, returns our newest images if we have images we haven't read yet, else NULL.
+	// The images stay valid and unchanged until the next call to read.
+	const gdlm_image_pair *read();
+
+	uint64_t get_received() const { return received.load(std::memory_order_relaxed); }
+	uint64_t get_dropped() const { return dropped.load(std::memory_order_relaxed); }
+	void reset_stats();
+};
+
+} // namespace godot
+
+#endif /* !GDLM_IMAGE_STREAM_H */
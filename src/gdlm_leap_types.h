@@ -0,0 +1,129 @@
+#ifndef GDLM_LEAP_TYPES_H
+#define GDLM_LEAP_TYPES_H
+
+// All our tracking data is passed around in LeapC's own structures.
+// When we're built without LeapC (scons leapc=no) we define the subset of those structures we use ourselves,
+// so our frame buffers, solvers and recordings work the same regardless of where our frames come from.
+
+#ifndef GDLM_NO_LEAPC
+
+// include leap motion library
+#include <LeapC.h>
+
+#else
+
+#include <stdint.h>
+
+typedef struct _LEAP_VECTOR {
+	float x;
+	float y;
+	float z;
+} LEAP_VECTOR;
+
+typedef struct _LEAP_QUATERNION {
+	float x;
+	float y;
+	float z;
+	float w;
+} LEAP_QUATERNION;
+
+typedef struct _LEAP_BONE {
+	LEAP_VECTOR prev_joint;
+	LEAP_VECTOR next_joint;
+	float width;
+	LEAP_QUATERNION rotation;
+} LEAP_BONE;
+
+typedef struct _LEAP_DIGIT {
+	int32_t finger_id;
+	LEAP_BONE bones[4];
+	uint32_t is_extended;
+} LEAP_DIGIT;
+
+typedef struct _LEAP_PALM {
+	LEAP_VECTOR position;
+	LEAP_VECTOR stabilized_position;
+	LEAP_VECTOR velocity;
+	LEAP_VECTOR normal;
+	float width;
+	LEAP_VECTOR direction;
+	LEAP_QUATERNION orientation;
+} LEAP_PALM;
+
+typedef enum _eLeapHandType {
+	eLeapHandType_Left,
+	eLeapHandType_Right
+} eLeapHandType;
+
+typedef struct _LEAP_HAND {
+	uint32_t id;
+	uint32_t flags;
+	eLeapHandType type;
+	float confidence;
+	uint64_t visible_time;
+	float pinch_distance;
+	float grab_angle;
+	float pinch_strength;
+	float grab_strength;
+	LEAP_PALM palm;
+	LEAP_DIGIT digits[5];
+	LEAP_BONE arm;
+} LEAP_HAND;
+
+typedef struct _LEAP_FRAME_HEADER {
+	void *reserved;
+	int64_t frame_id;
+	int64_t timestamp;
+} LEAP_FRAME_HEADER;
+
+typedef struct _LEAP_TRACKING_EVENT {
+	LEAP_FRAME_HEADER info;
+	int64_t tracking_frame_id;
+	uint32_t nHands;
+	LEAP_HAND *pHands;
+	float framerate;
+} LEAP_TRACKING_EVENT;
+
+typedef enum _eLeapImageType {
+	eLeapImageType_Unknown = 0,
+	eLeapImageType_Default,
+	eLeapImageType_Raw
+} eLeapImageType;
+
+typedef enum _eLeapImageFormat {
+	eLeapImageFormat_UNKNOWN = 0,
+	eLeapImageFormat_IR = 0x317249,
+	eLeapImageFormat_RGBIr_Bayer = 0x49425247
+} eLeapImageFormat;
+
+typedef struct _LEAP_IMAGE_PROPERTIES {
+	eLeapImageType type;
+	eLeapImageFormat format;
+	uint32_t bpp;
+	uint32_t width;
+	uint32_t height;
+	float x_scale;
+	float y_scale;
+	float x_offset;
+	float y_offset;
+} LEAP_IMAGE_PROPERTIES;
+
+// we never look at the distortion of our images
+typedef struct _LEAP_DISTORTION_MATRIX LEAP_DISTORTION_MATRIX;
+
+typedef struct _LEAP_IMAGE {
+	LEAP_IMAGE_PROPERTIES properties;
+	uint64_t matrix_version;
+	LEAP_DISTORTION_MATRIX *distortion_matrix;
+	void *data;
+	uint32_t offset;
+} LEAP_IMAGE;
+
+typedef struct _LEAP_IMAGE_EVENT {
+	LEAP_FRAME_HEADER info;
+	LEAP_IMAGE image[2];
+} LEAP_IMAGE_EVENT;
+
+#endif /* !GDLM_NO_LEAPC */
+
+#endif /* !GDLM_LEAP_TYPES_H */
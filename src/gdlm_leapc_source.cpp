@@ -0,0 +1,586 @@
+#ifndef GDLM_NO_LEAPC
+
+#include "gdlm_leapc_source.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+using namespace godot;
+
+GDLMLeapCSource::GDLMLeapCSource() {
+	leap_connection = NULL;
+	service_frame = NULL;
+	service_frame_size = 0;
+	memset(devices, 0, sizeof(devices));
+	is_connected.store(false);
+	hmd_optimized = false;
+	images_enabled = false;
+	listener = NULL;
+}
+
+GDLMLeapCSource::~GDLMLeapCSource() {
+	close();
+
+	if (service_frame != NULL) {
+		::free(service_frame);
+		service_frame = NULL;
+		service_frame_size = 0;
+	}
+}
+
+bool GDLMLeapCSource::open() {
+#ifdef GDLM_LEAPC_MULTI_DEVICE
+	// without this the service only tells us about one device
+	LEAP_CONNECTION_CONFIG config = { sizeof(config) };
+	config.flags = eLeapConnectionConfig_MultiDeviceAware;
+	eLeapRS result = LeapCreateConnection(&config, &leap_connection);
+#else
+	eLeapRS result = LeapCreateConnection(NULL, &leap_connection);
+#endif
+	if (result != eLeapRS_Success) {
+		printf("LeapMotion - couldn't create connection %s\n", ResultString(result));
+		leap_connection = NULL;
+		return false;
+	}
+
+	result = LeapOpenConnection(leap_connection);
+	if (result != eLeapRS_Success) {
+		printf("LeapMotion - couldn't open connection %s\n", ResultString(result));
+		LeapDestroyConnection(leap_connection);
+		leap_connection = NULL;
+		return false;
+	}
+
+	// our old samples relate to our old connection
+	clock_sync.reset();
+
+	return true;
+}
+
+void GDLMLeapCSource::close() {
+	set_is_connected(false);
+	close_devices();
+
+	if (leap_connection != NULL) {
+		LeapDestroyConnection(leap_connection);
+		leap_connection = NULL;
+	}
+}
+
+void GDLMLeapCSource::poll(GDLMFrameSourceListener *p_listener, unsigned int p_timeout) {
+	LEAP_CONNECTION_MESSAGE msg;
+
+	if (leap_connection == NULL) {
+		return;
+	}
+
+	// poll connection, this sleeps our thread until we have a message to handle or we time out
+	listener = p_listener;
+	eLeapRS result = LeapPollConnection(leap_connection, p_timeout, &msg);
+	while (result == eLeapRS_Success) {
+		handle_message(&msg);
+
+		// then handle anything that queued up in the meantime without sleeping, so nothing waits for our next wakeup
+		result = LeapPollConnection(leap_connection, 0, &msg);
+	}
+	listener = NULL;
+}
+
+void GDLMLeapCSource::interrupt() {
+	// closing our connection makes LeapPollConnection return right away, we destroy it in close
+	if (leap_connection != NULL) {
+		LeapCloseConnection(leap_connection);
+	}
+}
+
+void GDLMLeapCSource::handle_message(const LEAP_CONNECTION_MESSAGE *p_msg) {
+	// Handle messages by calling
+	switch (p_msg->type) {
+		case eLeapEventType_Connection:
+			handleConnectionEvent(p_msg->connection_event);
+			break;
+		case eLeapEventType_ConnectionLost:
+			handleConnectionLostEvent(p_msg->connection_lost_event);
+			break;
+		case eLeapEventType_Device:
+			handleDeviceEvent(p_msg->device_event);
+			break;
+		case eLeapEventType_DeviceLost:
+			handleDeviceLostEvent(p_msg->device_event);
+			break;
+		case eLeapEventType_DeviceFailure:
+			handleDeviceFailureEvent(p_msg->device_failure_event);
+			break;
+		case eLeapEventType_Tracking:
+#ifdef GDLM_LEAPC_MULTI_DEVICE
+			// messages of our primary device may come without a device id
+			handleTrackingEvent(p_msg->device_id != 0 ? p_msg->device_id : get_primary_device_id(), p_msg->tracking_event);
+#else
+			handleTrackingEvent(get_primary_device_id(), p_msg->tracking_event);
+#endif
+			break;
+		case eLeapEventType_ImageComplete:
+			// Ignore since 4.0.0
+			break;
+		case eLeapEventType_ImageRequestError:
+			// Ignore since 4.0.0
+			break;
+		case eLeapEventType_LogEvent:
+			handleLogEvent(p_msg->log_event);
+			break;
+		case eLeapEventType_Policy:
+			handlePolicyEvent(p_msg->policy_event);
+			break;
+		case eLeapEventType_ConfigChange:
+			handleConfigChangeEvent(p_msg->config_change_event);
+			break;
+		case eLeapEventType_ConfigResponse:
+			handleConfigResponseEvent(p_msg->config_response_event);
+			break;
+		case eLeapEventType_Image:
+#ifdef GDLM_LEAPC_MULTI_DEVICE
+			handleImageEvent(p_msg->device_id != 0 ? p_msg->device_id : get_primary_device_id(), p_msg->image_event);
+#else
+			handleImageEvent(get_primary_device_id(), p_msg->image_event);
+#endif
+			break;
+		case eLeapEventType_PointMappingChange:
+			handlePointMappingChangeEvent(p_msg->point_mapping_change_event);
+			break;
+		case eLeapEventType_LogEvents:
+			handleLogEvents(p_msg->log_events);
+			break;
+		case eLeapEventType_HeadPose:
+			handleHeadPoseEvent(p_msg->head_pose_event);
+			break;
+		default: {
+			// ignore
+		} break;
+	}
+}
+
+void GDLMLeapCSource::set_is_connected(bool p_set) {
+	is_connected.store(p_set);
+
+	if (p_set) {
+		update_policy();
+	}
+}
+
+void GDLMLeapCSource::update_policy() {
+	source_mutex.lock();
+	if (is_connected.load()) {
+		uint64_t set = (hmd_optimized ? eLeapPolicyFlag_OptimizeHMD : 0) | (images_enabled ? eLeapPolicyFlag_Images : 0);
+		uint64_t clear = (hmd_optimized ? 0 : eLeapPolicyFlag_OptimizeHMD) | (images_enabled ? 0 : eLeapPolicyFlag_Images);
+		printf("Setting arvr to %s\n", hmd_optimized ? "true" : "false");
+		LeapSetPolicyFlags(leap_connection, set, clear);
+
+#ifdef GDLM_LEAPC_MULTI_DEVICE
+		// our policy only applies to our primary device, our other devices need to be told separately
+		for (int d = 0; d < GDLM_MAX_DEVICES; d++) {
+			if (devices[d].id != 0) {
+				LeapSetPolicyFlagsEx(leap_connection, devices[d].handle, set, clear);
+			}
+		}
+#endif
+	}
+	source_mutex.unlock();
+}
+
+void GDLMLeapCSource::set_hmd_optimized(bool p_set) {
+	source_mutex.lock();
+	bool changed = hmd_optimized != p_set;
+	hmd_optimized = p_set;
+	source_mutex.unlock();
+
+	if (changed) {
+		update_policy();
+	}
+}
+
+void GDLMLeapCSource::set_images_enabled(bool p_set) {
+	source_mutex.lock();
+	bool changed = images_enabled != p_set;
+	images_enabled = p_set;
+	source_mutex.unlock();
+
+	if (changed) {
+		update_policy();
+	}
+}
+
+int64_t GDLMLeapCSource::get_now() {
+	return LeapGetNow();
+}
+
+void GDLMLeapCSource::update_clock(int64_t p_godot_usec, int64_t p_resolution_usec) {
+	if (leap_connection == NULL) {
+		return;
+	}
+
+	// we do our own rebasing instead of using LeapC's clock rebaser so we can make up for drift between Godots clock and ours
+	int64_t before = GDLMClockSync::get_local_usec();
+	clock_sync.add_godot_sample(p_godot_usec, p_resolution_usec, before);
+	int64_t leap_now = LeapGetNow();
+	int64_t after = GDLMClockSync::get_local_usec();
+	clock_sync.add_source_sample(before, leap_now, after);
+}
+
+bool GDLMLeapCSource::rebase_clock(int64_t p_godot_usec, int64_t *r_usec) {
+	if (!is_connected.load()) {
+		return false;
+	}
+
+	return clock_sync.godot_to_source(p_godot_usec, r_usec);
+}
+
+bool GDLMLeapCSource::get_clock_stats(gdlm_clock_stats *r_stats) const {
+	return clock_sync.get_stats(r_stats);
+}
+
+const LEAP_TRACKING_EVENT *GDLMLeapCSource::interpolate_frame(uint32_t p_device, int64_t p_timestamp) {
+	if (leap_connection == NULL) {
+		return NULL;
+	}
+
+	// make sure our device isn't closed while we're using it
+	std::lock_guard<std::mutex> guard(source_mutex);
+
+#ifdef GDLM_LEAPC_MULTI_DEVICE
+	LEAP_DEVICE device = NULL;
+	for (int d = 0; d < GDLM_MAX_DEVICES && device == NULL; d++) {
+		if (devices[d].id == p_device && p_device != 0) {
+			device = devices[d].handle;
+		}
+	}
+	if (device == NULL) {
+		return NULL;
+	}
+#endif
+
+	// We need the right amount of memory to store our interpolated frame data at our timestamp,
+	// we keep our buffer around so we only allocate when it needs to grow.
+	uint64_t target_frame_size;
+#ifdef GDLM_LEAPC_MULTI_DEVICE
+	eLeapRS result = LeapGetFrameSizeEx(leap_connection, device, p_timestamp, &target_frame_size);
+#else
+	eLeapRS result = LeapGetFrameSize(leap_connection, p_timestamp, &target_frame_size);
+#endif
+	if (result != eLeapRS_Success) {
+		return NULL;
+	}
+
+	if (service_frame_size < target_frame_size) {
+		LEAP_TRACKING_EVENT *new_frame = (LEAP_TRACKING_EVENT *)realloc(service_frame, (size_t)target_frame_size);
+		if (new_frame == NULL) {
+			return NULL;
+		}
+
+		service_frame = new_frame;
+		service_frame_size = target_frame_size;
+	}
+
+	// and lets get our interpolated frame!!
+#ifdef GDLM_LEAPC_MULTI_DEVICE
+	result = LeapInterpolateFrameEx(leap_connection, device, p_timestamp, service_frame, target_frame_size);
+#else
+	result = LeapInterpolateFrame(leap_connection, p_timestamp, service_frame, target_frame_size);
+#endif
+	if (result != eLeapRS_Success) {
+		// this is not good... need to add some error handling here.
+		return NULL;
+	}
+
+	return service_frame;
+}
+
+uint32_t GDLMLeapCSource::get_primary_device_id() {
+	// Our primary device is the first one we found that is still attached.
+	// Only our leap motion thread changes our devices and we're called from it, so we don't need to lock.
+	for (int d = 0; d < GDLM_MAX_DEVICES; d++) {
+		if (devices[d].id != 0) {
+			return devices[d].id;
+		}
+	}
+
+	return 0;
+}
+
+void GDLMLeapCSource::close_devices() {
+	source_mutex.lock();
+	for (int d = 0; d < GDLM_MAX_DEVICES; d++) {
+		if (devices[d].id == 0) {
+			continue;
+		}
+
+#ifdef GDLM_LEAPC_MULTI_DEVICE
+		if (leap_connection != NULL) {
+			LeapUnsubscribeEvents(leap_connection, devices[d].handle);
+		}
+		LeapCloseDevice(devices[d].handle);
+#endif
+
+		// let our listener know if we're still polling
+		if (listener != NULL) {
+			listener->on_device_changed(devices[d].id, devices[d].serial, false);
+		}
+
+		devices[d].id = 0;
+	}
+	source_mutex.unlock();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+// All methods below here are running in our leap motion thread!!
+
+/** Translates eLeapRS result codes into a human-readable string. */
+const char *GDLMLeapCSource::ResultString(eLeapRS r) {
+	switch (r) {
+		case eLeapRS_Success: return "eLeapRS_Success";
+		case eLeapRS_UnknownError: return "eLeapRS_UnknownError";
+		case eLeapRS_InvalidArgument: return "eLeapRS_InvalidArgument";
+		case eLeapRS_InsufficientResources: return "eLeapRS_InsufficientResources";
+		case eLeapRS_InsufficientBuffer: return "eLeapRS_InsufficientBuffer";
+		case eLeapRS_Timeout: return "eLeapRS_Timeout";
+		case eLeapRS_NotConnected: return "eLeapRS_NotConnected";
+		case eLeapRS_HandshakeIncomplete: return "eLeapRS_HandshakeIncomplete";
+		case eLeapRS_BufferSizeOverflow: return "eLeapRS_BufferSizeOverflow";
+		case eLeapRS_ProtocolError: return "eLeapRS_ProtocolError";
+		case eLeapRS_InvalidClientID: return "eLeapRS_InvalidClientID";
+		case eLeapRS_UnexpectedClosed: return "eLeapRS_UnexpectedClosed";
+		case eLeapRS_UnknownImageFrameRequest: return "eLeapRS_UnknownImageFrameRequest";
+		case eLeapRS_UnknownTrackingFrameID: return "eLeapRS_UnknownTrackingFrameID";
+		case eLeapRS_RoutineIsNotSeer: return "eLeapRS_RoutineIsNotSeer";
+		case eLeapRS_TimestampTooEarly: return "eLeapRS_TimestampTooEarly";
+		case eLeapRS_ConcurrentPoll: return "eLeapRS_ConcurrentPoll";
+		case eLeapRS_NotAvailable: return "eLeapRS_NotAvailable";
+		case eLeapRS_NotStreaming: return "eLeapRS_NotStreaming";
+		case eLeapRS_CannotOpenDevice: return "eLeapRS_CannotOpenDevice";
+		default: return "unknown result type.";
+	}
+}
+
+void GDLMLeapCSource::handleConnectionEvent(const LEAP_CONNECTION_EVENT *connection_event) {
+	// log..
+	printf("LeapMotion - connected to leap motion\n");
+
+	// update our status
+	set_is_connected(true);
+	listener->on_connection_changed(true);
+}
+
+void GDLMLeapCSource::handleConnectionLostEvent(const LEAP_CONNECTION_LOST_EVENT *connection_lost_event) {
+	// update our status
+	set_is_connected(false);
+	close_devices();
+	listener->on_connection_changed(false);
+
+	// log...
+	printf("LeapMotion - connection lost\n");
+}
+
+void GDLMLeapCSource::handleDeviceEvent(const LEAP_DEVICE_EVENT *device_event) {
+	LEAP_DEVICE deviceHandle;
+
+	//Open device using LEAP_DEVICE_REF from event struct.
+	eLeapRS result = LeapOpenDevice(device_event->device, &deviceHandle);
+	if (result != eLeapRS_Success) {
+		printf("Could not open device %s.\n", ResultString(result));
+		return;
+	}
+
+	//Create a struct to hold the device properties, we have to provide a buffer for the serial string
+	LEAP_DEVICE_INFO deviceProperties = { sizeof(deviceProperties) };
+
+	// Start with a length of 1 (pretending we don't know a priori what the length is).
+	// Currently device serial numbers are all the same length, but that could change in the future
+	deviceProperties.serial_length = 1;
+	deviceProperties.serial = (char *)malloc(deviceProperties.serial_length);
+
+	// This will fail since the serial buffer is only 1 character long
+	// But deviceProperties is updated to contain the required buffer length
+	result = LeapGetDeviceInfo(deviceHandle, &deviceProperties);
+	if (result == eLeapRS_InsufficientBuffer) {
+		//try again with correct buffer size
+		deviceProperties.serial = (char *)realloc(deviceProperties.serial, deviceProperties.serial_length);
+		result = LeapGetDeviceInfo(deviceHandle, &deviceProperties);
+		if (result != eLeapRS_Success) {
+			printf("Failed to get device info %s.\n", ResultString(result));
+			::free(deviceProperties.serial);
+			LeapCloseDevice(deviceHandle);
+			return;
+		}
+	}
+
+	// log this for now
+	printf("LeapMotion - found device %s\n", deviceProperties.serial);
+
+	// find room to remember our device
+	source_mutex.lock();
+	device_entry *entry = NULL;
+	for (int d = 0; d < GDLM_MAX_DEVICES && entry == NULL; d++) {
+		if (devices[d].id == 0) {
+			entry = &devices[d];
+		}
+	}
+#ifndef GDLM_LEAPC_MULTI_DEVICE
+	if (entry != &devices[0]) {
+		// the service only sends us the frames of one device
+		entry = NULL;
+	}
+#endif
+
+	if (entry != NULL) {
+		entry->id = device_event->device.id;
+		entry->handle = deviceHandle;
+		strncpy(entry->serial, deviceProperties.serial, GDLM_MAX_SERIAL - 1);
+		entry->serial[GDLM_MAX_SERIAL - 1] = '\0';
+	}
+	source_mutex.unlock();
+
+	::free(deviceProperties.serial);
+
+	if (entry == NULL) {
+		printf("LeapMotion - can't use any more devices, ignoring this one\n");
+		LeapCloseDevice(deviceHandle);
+		return;
+	}
+
+#ifdef GDLM_LEAPC_MULTI_DEVICE
+	// we keep our device open so we can subscribe to its tracking events and apply our policy
+	result = LeapSubscribeEvents(leap_connection, deviceHandle);
+	if (result != eLeapRS_Success) {
+		printf("LeapMotion - couldn't subscribe to device %s\n", ResultString(result));
+	}
+	update_policy();
+#else
+	LeapCloseDevice(deviceHandle);
+#endif
+
+	listener->on_device_changed(entry->id, entry->serial, true);
+}
+
+void GDLMLeapCSource::handleDeviceLostEvent(const LEAP_DEVICE_EVENT *device_event) {
+	source_mutex.lock();
+	device_entry *entry = NULL;
+	for (int d = 0; d < GDLM_MAX_DEVICES && entry == NULL; d++) {
+		if (devices[d].id != 0 && devices[d].id == device_event->device.id) {
+			entry = &devices[d];
+		}
+	}
+
+	if (entry != NULL) {
+		printf("LeapMotion - lost device %s\n", entry->serial);
+
+#ifdef GDLM_LEAPC_MULTI_DEVICE
+		LeapUnsubscribeEvents(leap_connection, entry->handle);
+		LeapCloseDevice(entry->handle);
+#endif
+
+		listener->on_device_changed(entry->id, entry->serial, false);
+		entry->id = 0;
+	} else {
+		printf("LeapMotion - lost device\n");
+	}
+	source_mutex.unlock();
+}
+
+void GDLMLeapCSource::handleDeviceFailureEvent(const LEAP_DEVICE_FAILURE_EVENT *device_failure_event) {
+	// do something with this
+	// device_failure_event->status, device_failure_event->hDevice
+
+	// just log for now
+	printf("LeapMotion - device failure %i\n", device_failure_event->status);
+}
+
+void GDLMLeapCSource::handleTrackingEvent(uint32_t device_id, const LEAP_TRACKING_EVENT *tracking_event) {
+	// our listener makes a copy if it needs one, LeapC only guarantees this pointer until our next poll
+	listener->on_tracking_event(device_id, tracking_event);
+}
+
+void GDLMLeapCSource::handleLogEvent(const LEAP_LOG_EVENT *log_event) {
+	// just log for now
+	char lvl[250];
+	switch (log_event->severity) {
+		case eLeapLogSeverity_Critical:
+			strcpy(lvl, "Critical");
+			break;
+		case eLeapLogSeverity_Warning:
+			strcpy(lvl, "Warning");
+			break;
+		case eLeapLogSeverity_Information:
+			strcpy(lvl, "Information");
+			break;
+		default:
+			strcpy(lvl, "Unknown");
+			break;
+	}
+
+	printf("LeapMotion - %s - %lli: %s\n", lvl, log_event->timestamp, log_event->message);
+}
+
+/** Called by serviceMessageLoop() when a log event is returned by LeapPollConnection(). */
+void GDLMLeapCSource::handleLogEvents(const LEAP_LOG_EVENTS *log_events) {
+	for (int i = 0; i < (int)(log_events->nEvents); i++) {
+		handleLogEvent(&log_events->events[i]);
+	}
+}
+
+void GDLMLeapCSource::handlePolicyEvent(const LEAP_POLICY_EVENT *policy_event) {
+	// just log for now
+	printf("LeapMotion - policy event");
+
+	if (policy_event->current_policy & eLeapPolicyFlag_BackgroundFrames) {
+		printf(", background frames");
+	}
+	if (policy_event->current_policy & eLeapPolicyFlag_OptimizeHMD) {
+		printf(", optimised for HMD");
+	}
+	if (policy_event->current_policy & eLeapPolicyFlag_AllowPauseResume) {
+		printf(", allow pause and resume");
+	}
+	if (policy_event->current_policy & eLeapPolicyFlag_Images) {
+		printf(", images");
+	}
+
+	printf("\n");
+}
+
+void GDLMLeapCSource::handleConfigChangeEvent(const LEAP_CONFIG_CHANGE_EVENT *config_change_event) {
+	// do something with this?
+
+	// just log for now
+	printf("LeapMotion - config change event\n");
+}
+
+void GDLMLeapCSource::handleConfigResponseEvent(const LEAP_CONFIG_RESPONSE_EVENT *config_response_event) {
+	// do something with this?
+
+	// just log for now
+	printf("LeapMotion - config response event\n");
+}
+
+/** Called by serviceMessageLoop() when an image event is returned by LeapPollConnection(). */
+void GDLMLeapCSource::handleImageEvent(uint32_t device_id, const LEAP_IMAGE_EVENT *image_event) {
+	// our images point into LeapC's buffers which are only valid until our next poll, our listener copies what it needs
+	listener->on_image_event(device_id, image_event);
+}
+
+/** Called by serviceMessageLoop() when a point mapping change event is returned by LeapPollConnection(). */
+void GDLMLeapCSource::handlePointMappingChangeEvent(const LEAP_POINT_MAPPING_CHANGE_EVENT *point_mapping_change_event) {
+	// do something with this?
+
+	// just log for now
+	printf("LeapMotion - point mapping change event\n");
+}
+
+/** Called by serviceMessageLoop() when a point mapping change event is returned by LeapPollConnection(). */
+void GDLMLeapCSource::handleHeadPoseEvent(const LEAP_HEAD_POSE_EVENT *head_pose_event) {
+	// definately need to implement this once we add an ARVR interface for this.
+
+	// just log for now
+	printf("LeapMotion - head pose event\n");
+}
+
+#endif /* !GDLM_NO_LEAPC */
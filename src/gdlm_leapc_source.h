@@ -0,0 +1,84 @@
+#ifndef GDLM_LEAPC_SOURCE_H
+#define GDLM_LEAPC_SOURCE_H
+
+#ifndef GDLM_NO_LEAPC
+
+#include <atomic>
+#include <mutex>
+
+#include "gdlm_frame_source.h"
+
+namespace godot {
+
+// Our frame source for real leap motion devices, talks to the leap motion service through LeapC.
+// Built with GDLM_LEAPC_MULTI_DEVICE (LeapC 4.1 or later) we subscribe to the tracking events of every device
+// that is attached, otherwise the service only sends us the frames of one device.
+class GDLMLeapCSource : public GDLMFrameSource {
+private:
+	struct device_entry {
+		uint32_t id; // LeapC's id for our device, 0 if this entry is unused
+		LEAP_DEVICE handle; // only kept open when we subscribe to our devices
+		char serial[GDLM_MAX_SERIAL];
+	};
+
+	LEAP_CONNECTION leap_connection;
+	GDLMClockSync clock_sync; /* relates Godots clock to LeapGetNow */
+	LEAP_TRACKING_EVENT *service_frame; /* buffer for frames interpolated by the leap motion service */
+	uint64_t service_frame_size;
+	device_entry devices[GDLM_MAX_DEVICES]; /* devices we know about, guarded by source_mutex */
+	std::atomic<bool> is_connected; /* read by Godots thread every physics tick so we don't lock */
+	bool hmd_optimized;
+	bool images_enabled;
+	std::mutex source_mutex; /* guards our policy and devices, only taken when these change or when we ask LeapC for a frame */
+
+	GDLMFrameSourceListener *listener; /* only valid while polling */
+
+	void set_is_connected(bool p_set);
+	void update_policy();
+	void handle_message(const LEAP_CONNECTION_MESSAGE *p_msg);
+	void close_devices();
+	uint32_t get_primary_device_id();
+
+	// return result state as a string
+	const char *ResultString(eLeapRS r);
+
+	// these are handlers for all the messages LeapC sends us
+	void handleConnectionEvent(const LEAP_CONNECTION_EVENT *connection_event);
+	void handleConnectionLostEvent(const LEAP_CONNECTION_LOST_EVENT *connection_lost_event);
+	void handleDeviceEvent(const LEAP_DEVICE_EVENT *device_event);
+	void handleDeviceLostEvent(const LEAP_DEVICE_EVENT *device_event);
+	void handleDeviceFailureEvent(const LEAP_DEVICE_FAILURE_EVENT *device_failure_event);
+	void handleTrackingEvent(uint32_t device_id, const LEAP_TRACKING_EVENT *tracking_event);
+	void handleLogEvent(const LEAP_LOG_EVENT *log_event);
+	void handleLogEvents(const LEAP_LOG_EVENTS *log_events);
+	void handlePolicyEvent(const LEAP_POLICY_EVENT *policy_event);
+	void handleConfigChangeEvent(const LEAP_CONFIG_CHANGE_EVENT *config_change_event);
+	void handleConfigResponseEvent(const LEAP_CONFIG_RESPONSE_EVENT *config_response_event);
+	void handleImageEvent(uint32_t device_id, const LEAP_IMAGE_EVENT *image_event);
+	void handlePointMappingChangeEvent(const LEAP_POINT_MAPPING_CHANGE_EVENT *point_mapping_change_event);
+	void handleHeadPoseEvent(const LEAP_HEAD_POSE_EVENT *head_pose_event);
+
+public:
+	GDLMLeapCSource();
+	~GDLMLeapCSource();
+
+	virtual bool open();
+	virtual void close();
+	virtual void poll(GDLMFrameSourceListener *p_listener, unsigned int p_timeout);
+	virtual void interrupt();
+
+	virtual int64_t get_now();
+	virtual void update_clock(int64_t p_godot_usec, int64_t p_resolution_usec);
+	virtual bool rebase_clock(int64_t p_godot_usec, int64_t *r_usec);
+	virtual bool get_clock_stats(gdlm_clock_stats *r_stats) const;
+
+	virtual void set_hmd_optimized(bool p_set);
+	virtual void set_images_enabled(bool p_set);
+	virtual const LEAP_TRACKING_EVENT *interpolate_frame(uint32_t p_device, int64_t p_timestamp);
+};
+
+} // namespace godot
+
+#endif /* !GDLM_NO_LEAPC */
+
+#endif /* !GDLM_LEAPC_SOURCE_H */
@@ -0,0 +1,257 @@
+#include "gdlm_recording.h"
+
+#include <string.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace godot;
+
+static inline size_t align_record(size_t p_size) {
+	return (p_size + 7) & ~((size_t)7);
+}
+
+GDLMRecorder::GDLMRecorder() {
+	file = NULL;
+	recording.store(false);
+}
+
+GDLMRecorder::~GDLMRecorder() {
+	stop();
+}
+
+bool GDLMRecorder::start(const char *p_path) {
+	std::lock_guard<std::mutex> guard(file_mutex);
+
+	if (file != NULL) {
+		recording.store(false);
+		fclose(file);
+		file = NULL;
+	}
+
+	file = fopen(p_path, "wb");
+	if (file == NULL) {
+		printf("LeapMotion - couldn't create recording %s\n", p_path);
+		return false;
+	}
+
+	gdlm_recording_header header;
+	memset(&header, 0, sizeof(header));
+	strncpy(header.magic, GDLM_RECORDING_MAGIC, sizeof(header.magic));
+	header.version = GDLM_RECORDING_VERSION;
+	header.hand_size = sizeof(LEAP_HAND);
+
+	if (fwrite(&header, sizeof(header), 1, file) != 1) {
+		printf("LeapMotion - couldn't write recording %s\n", p_path);
+		fclose(file);
+		file = NULL;
+		return false;
+	}
+
+	recording.store(true);
+	return true;
+}
+
+void GDLMRecorder::stop() {
+	std::lock_guard<std::mutex> guard(file_mutex);
+
+	recording.store(false);
+	if (file != NULL) {
+		fclose(file);
+		file = NULL;
+	}
+}
+
+bool GDLMRecorder::is_recording() const {
+	return recording.load();
+}
+
+void GDLMRecorder::record(const LEAP_TRACKING_EVENT *p_event, int64_t p_received) {
+	// cheap check so we don't lock when we're not recording
+	if (!recording.load(std::memory_order_relaxed)) {
+		return;
+	}
+
+	std::lock_guard<std::mutex> guard(file_mutex);
+	if (file == NULL) {
+		return;
+	}
+
+	size_t hands_size = p_event->nHands * sizeof(LEAP_HAND);
+	size_t record_size = align_record(sizeof(gdlm_recording_record) + hands_size);
+
+	gdlm_recording_record record;
+	memset(&record, 0, sizeof(record));
+	record.record_size = (uint32_t)record_size;
+	record.n_hands = p_event->nHands;
+	record.received = p_received;
+	record.frame_id = p_event->info.frame_id;
+	record.timestamp = p_event->info.timestamp;
+	record.tracking_frame_id = p_event->tracking_frame_id;
+	record.framerate = p_event->framerate;
+
+	// we only ever append, if we crash halfway a record our reader simply ignores it
+	static const uint8_t padding[8] = { 0 };
+	size_t padding_size = record_size - sizeof(record) - hands_size;
+	bool written = fwrite(&record, sizeof(record), 1, file) == 1;
+	if (written && hands_size > 0) {
+		written = fwrite(p_event->pHands, hands_size, 1, file) == 1;
+	}
+	if (written && padding_size > 0) {
+		written = fwrite(padding, padding_size, 1, file) == 1;
+	}
+
+	if (!written) {
+		// most likely our disk is full, stop rather than fail on every frame
+		printf("LeapMotion - couldn't write to our recording, recording stopped\n");
+		recording.store(false);
+		fclose(file);
+		file = NULL;
+	}
+}
+
+GDLMRecording::GDLMRecording() {
+	data = NULL;
+	size = 0;
+#ifdef _WIN32
+	file_handle = INVALID_HANDLE_VALUE;
+	mapping_handle = NULL;
+#else
+	fd = -1;
+#endif
+}
+
+GDLMRecording::~GDLMRecording() {
+	close();
+}
+
+bool GDLMRecording::open(const char *p_path) {
+	close();
+
+#ifdef _WIN32
+	file_handle = CreateFileA(p_path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file_handle == INVALID_HANDLE_VALUE) {
+		printf("LeapMotion - couldn't open recording %s\n", p_path);
+		return false;
+	}
+
+	LARGE_INTEGER file_size;
+	if (!GetFileSizeEx(file_handle, &file_size) || file_size.QuadPart < (LONGLONG)sizeof(gdlm_recording_header)) {
+		printf("LeapMotion - %s is not a recording\n", p_path);
+		close();
+		return false;
+	}
+	size = (size_t)file_size.QuadPart;
+
+	mapping_handle = CreateFileMappingA(file_handle, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mapping_handle != NULL) {
+		data = (const uint8_t *)MapViewOfFile(mapping_handle, FILE_MAP_READ, 0, 0, 0);
+	}
+#else
+	fd = ::open(p_path, O_RDONLY);
+	if (fd == -1) {
+		printf("LeapMotion - couldn't open recording %s\n", p_path);
+		return false;
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(gdlm_recording_header)) {
+		printf("LeapMotion - %s is not a recording\n", p_path);
+		close();
+		return false;
+	}
+	size = (size_t)st.st_size;
+
+	void *mapped = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (mapped != MAP_FAILED) {
+		data = (const uint8_t *)mapped;
+	}
+#endif
+
+	if (data == NULL) {
+		printf("LeapMotion - couldn't map recording %s\n", p_path);
+		close();
+		return false;
+	}
+
+	const gdlm_recording_header *header = (const gdlm_recording_header *)data;
+	if (strncmp(header->magic, GDLM_RECORDING_MAGIC, sizeof(header->magic)) != 0) {
+		printf("LeapMotion - %s is not a recording\n", p_path);
+		close();
+		return false;
+	} else if (header->version != GDLM_RECORDING_VERSION || header->hand_size != sizeof(LEAP_HAND)) {
+		printf("LeapMotion - %s was recorded with an incompatible version\n", p_path);
+		close();
+		return false;
+	}
+
+	return true;
+}
+
+void GDLMRecording::close() {
+#ifdef _WIN32
+	if (data != NULL) {
+		UnmapViewOfFile(data);
+	}
+	if (mapping_handle != NULL) {
+		CloseHandle(mapping_handle);
+		mapping_handle = NULL;
+	}
+	if (file_handle != INVALID_HANDLE_VALUE) {
+		CloseHandle(file_handle);
+		file_handle = INVALID_HANDLE_VALUE;
+	}
+#else
+	if (data != NULL) {
+		munmap((void *)data, size);
+	}
+	if (fd != -1) {
+		::close(fd);
+		fd = -1;
+	}
+#endif
+
+	data = NULL;
+	size = 0;
+}
+
+bool GDLMRecording::is_open() const {
+	return data != NULL;
+}
+
+size_t GDLMRecording::first() const {
+	return sizeof(gdlm_recording_header);
+}
+
+bool GDLMRecording::read(size_t *r_offset, LEAP_TRACKING_EVENT *r_event, int64_t *r_received) const {
+	if (data == NULL || *r_offset + sizeof(gdlm_recording_record) > size) {
+		return false;
+	}
+
+	const gdlm_recording_record *record = (const gdlm_recording_record *)(data + *r_offset);
+	size_t hands_size = record->n_hands * sizeof(LEAP_HAND);
+	if (record->record_size < sizeof(gdlm_recording_record) + hands_size || *r_offset + record->record_size > size) {
+		// truncated or corrupt
+		return false;
+	}
+
+	memset(r_event, 0, sizeof(LEAP_TRACKING_EVENT));
+	r_event->info.frame_id = record->frame_id;
+	r_event->info.timestamp = record->timestamp;
+	r_event->tracking_frame_id = record->tracking_frame_id;
+	r_event->framerate = record->framerate;
+	r_event->nHands = record->n_hands;
+	r_event->pHands = (LEAP_HAND *)(data + *r_offset + sizeof(gdlm_recording_record));
+	*r_received = record->received;
+
+	*r_offset += record->record_size;
+	return true;
+}
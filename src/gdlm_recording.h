@@ -0,0 +1,88 @@
+#ifndef GDLM_RECORDING_H
+#define GDLM_RECORDING_H
+
+#include <atomic>
+#include <mutex>
+#include <stdint.h>
+#include <stdio.h>
+
+// our leap motion data structures
+#include "gdlm_leap_types.h"
+
+// Our recordings start with this header, followed by one record per tracking event.
+// Everything is written in native byte order and aligned to 8 bytes so we can map our hands directly.
+#define GDLM_RECORDING_MAGIC "GDLMREC"
+#define GDLM_RECORDING_VERSION 1
+
+namespace godot {
+
+struct gdlm_recording_header {
+	char magic[8];
+	uint32_t version;
+	uint32_t hand_size; // sizeof(LEAP_HAND) when recorded, we refuse recordings from a different SDK layout
+};
+
+// Each record is followed by n_hands LEAP_HANDs, record_size includes our hands and padding.
+struct gdlm_recording_record {
+	uint32_t record_size;
+	uint32_t n_hands;
+	int64_t received; // leap motion time at which we received this event
+	int64_t frame_id;
+	int64_t timestamp;
+	int64_t tracking_frame_id;
+	float framerate;
+	uint32_t padding;
+};
+
+// Appends tracking events to a recording file.
+// record is called from our leap motion thread, start and stop from Godots main thread.
+class GDLMRecorder {
+private:
+	FILE *file;
+	std::atomic<bool> recording; // so our leap motion thread can check this without locking
+	std::mutex file_mutex;
+
+public:
+	GDLMRecorder();
+	~GDLMRecorder();
+
+	// creates a new recording at p_path, any existing file is overwritten
+	bool start(const char *p_path);
+	void stop();
+	bool is_recording() const;
+
+	void record(const LEAP_TRACKING_EVENT *p_event, int64_t p_received);
+};
+
+// Read only, memory mapped access to a recording.
+class GDLMRecording {
+private:
+	const uint8_t *data;
+	size_t size;
+#ifdef _WIN32
+	void *file_handle;
+	void *mapping_handle;
+#else
+	int fd;
+#endif
+
+public:
+	GDLMRecording();
+	~GDLMRecording();
+
+	bool open(const char *p_path);
+	void close();
+	bool is_open() const;
+
+	// Reads the record at r_offset into r_event and moves r_offset onto our next record.
+	// r_event->pHands points into our mapped file so it remains valid until we're closed.
+	// Returns false at the end of our recording, a truncated last record is ignored.
+	bool read(size_t *r_offset, LEAP_TRACKING_EVENT *r_event, int64_t *r_received) const;
+
+	// offset of our first record
+	size_t first() const;
+};
+
+} // namespace godot
+
+#endif /* !GDLM_RECORDING_H */
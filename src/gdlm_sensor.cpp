@@ -2,6 +2,13 @@
 
 #define PI 3.14159265359f
 
+// without LeapC our synthetic source is all we have
+#ifdef GDLM_NO_LEAPC
+#define DEFAULT_FRAME_SOURCE GDLMSensor::FRAME_SOURCE_SYNTHETIC
+#else
+#define DEFAULT_FRAME_SOURCE GDLMSensor::FRAME_SOURCE_LEAPC
+#endif
+
 using namespace godot;
 
 void GDLMSensor::_register_methods() {
@@ -11,30 +18,158 @@ void GDLMSensor::_register_methods() {
 	register_signal<GDLMSensor>("new_hand", args);
 	register_signal<GDLMSensor>("about_to_remove_hand", args);
 
+	Dictionary pinched_args;
+	pinched_args[Variant("hand")] = Variant(Variant::OBJECT);
+	pinched_args[Variant("is_pinched")] = Variant(Variant::BOOL);
+	register_signal<GDLMSensor>("pinched", pinched_args);
+
+	Dictionary grabbed_args;
+	grabbed_args[Variant("hand")] = Variant(Variant::OBJECT);
+	grabbed_args[Variant("is_grabbed")] = Variant(Variant::BOOL);
+	register_signal<GDLMSensor>("grabbed", grabbed_args);
+
+	Dictionary hand_state_args;
+	hand_state_args[Variant("hand")] = Variant(Variant::OBJECT);
+	hand_state_args[Variant("pinch_distance")] = Variant(Variant::REAL);
+	hand_state_args[Variant("pinch_strength")] = Variant(Variant::REAL);
+	hand_state_args[Variant("grab_strength")] = Variant(Variant::REAL);
+	register_signal<GDLMSensor>("hand_state_changed", hand_state_args);
+
 	register_method("get_is_running", &GDLMSensor::get_is_running);
 	register_method("get_is_connected", &GDLMSensor::get_is_connected);
 	register_method("get_left_hand_scene", &GDLMSensor::get_left_hand_scene);
 	register_method("set_left_hand_scene", &GDLMSensor::set_left_hand_scene);
 	register_method("get_right_hand_scene", &GDLMSensor::get_right_hand_scene);
 	register_method("set_right_hand_scene", &GDLMSensor::set_right_hand_scene);
+	register_method("get_frame_source", &GDLMSensor::get_frame_source);
+	register_method("set_frame_source", &GDLMSensor::set_frame_source);
+	register_method("get_synthetic_rate", &GDLMSensor::get_synthetic_rate);
+	register_method("set_synthetic_rate", &GDLMSensor::set_synthetic_rate);
+	register_method("get_synthetic_hands", &GDLMSensor::get_synthetic_hands);
+	register_method("set_synthetic_hands", &GDLMSensor::set_synthetic_hands);
+	register_method("get_synthetic_devices", &GDLMSensor::get_synthetic_devices);
+	register_method("set_synthetic_devices", &GDLMSensor::set_synthetic_devices);
 	register_method("get_arvr", &GDLMSensor::get_arvr);
 	register_method("set_arvr", &GDLMSensor::set_arvr);
 	register_method("get_smooth_factor", &GDLMSensor::get_smooth_factor);
 	register_method("set_smooth_factor", &GDLMSensor::set_smooth_factor);
+	register_method("get_filter_min_cutoff", &GDLMSensor::get_filter_min_cutoff);
+	register_method("set_filter_min_cutoff", &GDLMSensor::set_filter_min_cutoff);
+	register_method("get_filter_beta", &GDLMSensor::get_filter_beta);
+	register_method("set_filter_beta", &GDLMSensor::set_filter_beta);
+	register_method("get_filter_d_cutoff", &GDLMSensor::get_filter_d_cutoff);
+	register_method("set_filter_d_cutoff", &GDLMSensor::set_filter_d_cutoff);
+	register_method("set_hand_filter", &GDLMSensor::set_hand_filter);
+	register_method("clear_hand_filter", &GDLMSensor::clear_hand_filter);
+	register_method("get_hand_data_epsilon", &GDLMSensor::get_hand_data_epsilon);
+	register_method("set_hand_data_epsilon", &GDLMSensor::set_hand_data_epsilon);
+	register_method("get_pinch_distance_epsilon_mm", &GDLMSensor::get_pinch_distance_epsilon_mm);
+	register_method("set_pinch_distance_epsilon_mm", &GDLMSensor::set_pinch_distance_epsilon_mm);
+	register_method("get_push_hand_data", &GDLMSensor::get_push_hand_data);
+	register_method("set_push_hand_data", &GDLMSensor::set_push_hand_data);
+	register_method("get_pinch_on_threshold", &GDLMSensor::get_pinch_on_threshold);
+	register_method("set_pinch_on_threshold", &GDLMSensor::set_pinch_on_threshold);
+	register_method("get_pinch_off_threshold", &GDLMSensor::get_pinch_off_threshold);
+	register_method("set_pinch_off_threshold", &GDLMSensor::set_pinch_off_threshold);
+	register_method("get_pinch_max_distance_mm", &GDLMSensor::get_pinch_max_distance_mm);
+	register_method("set_pinch_max_distance_mm", &GDLMSensor::set_pinch_max_distance_mm);
+	register_method("get_grab_on_threshold", &GDLMSensor::get_grab_on_threshold);
+	register_method("set_grab_on_threshold", &GDLMSensor::set_grab_on_threshold);
+	register_method("get_grab_off_threshold", &GDLMSensor::get_grab_off_threshold);
+	register_method("set_grab_off_threshold", &GDLMSensor::set_grab_off_threshold);
+	register_method("get_hand_state_rate", &GDLMSensor::get_hand_state_rate);
+	register_method("set_hand_state_rate", &GDLMSensor::set_hand_state_rate);
+	register_method("get_collision_proxies", &GDLMSensor::get_collision_proxies);
+	register_method("set_collision_proxies", &GDLMSensor::set_collision_proxies);
+	register_method("get_collision_layer", &GDLMSensor::get_collision_layer);
+	register_method("set_collision_layer", &GDLMSensor::set_collision_layer);
+	register_method("get_collision_mask", &GDLMSensor::get_collision_mask);
+	register_method("set_collision_mask", &GDLMSensor::set_collision_mask);
+	register_method("get_use_bone_rotations", &GDLMSensor::get_use_bone_rotations);
+	register_method("set_use_bone_rotations", &GDLMSensor::set_use_bone_rotations);
+	register_method("get_prediction_ms", &GDLMSensor::get_prediction_ms);
+	register_method("set_prediction_ms", &GDLMSensor::set_prediction_ms);
+	register_method("get_update_mode", &GDLMSensor::get_update_mode);
+	register_method("set_update_mode", &GDLMSensor::set_update_mode);
+	register_method("get_hand_pool_size", &GDLMSensor::get_hand_pool_size);
+	register_method("set_hand_pool_size", &GDLMSensor::set_hand_pool_size);
+	register_method("get_hand_pool_hits", &GDLMSensor::get_hand_pool_hits);
+	register_method("get_hand_pool_misses", &GDLMSensor::get_hand_pool_misses);
+	register_method("get_instance_hands", &GDLMSensor::get_instance_hands);
+	register_method("set_instance_hands", &GDLMSensor::set_instance_hands);
+	register_method("get_arvr_trackers", &GDLMSensor::get_arvr_trackers);
+	register_method("set_arvr_trackers", &GDLMSensor::set_arvr_trackers);
+	register_method("get_tracker_id", &GDLMSensor::get_tracker_id);
+	register_method("get_hand_count", &GDLMSensor::get_hand_count);
+	register_method("get_hand_joints", &GDLMSensor::get_hand_joints);
+	register_method("get_hand_data", &GDLMSensor::get_hand_data);
+	register_method("get_all_hand_joints", &GDLMSensor::get_all_hand_joints);
+	register_method("get_all_hand_data", &GDLMSensor::get_all_hand_data);
 	register_method("get_keep_frames", &GDLMSensor::get_keep_frames);
 	register_method("set_keep_frames", &GDLMSensor::set_keep_frames);
 	register_method("get_keep_last_hand", &GDLMSensor::get_keep_last_hand);
 	register_method("set_keep_last_hand", &GDLMSensor::set_keep_last_hand);
 	register_method("get_hmd_to_leap_motion", &GDLMSensor::get_hmd_to_leap_motion);
 	register_method("set_hmd_to_leap_motion", &GDLMSensor::set_hmd_to_leap_motion);
+	register_method("get_devices", &GDLMSensor::get_devices);
+	register_method("get_device_transform", &GDLMSensor::get_device_transform);
+	register_method("set_device_transform", &GDLMSensor::set_device_transform);
+	register_method("get_merge_distance_mm", &GDLMSensor::get_merge_distance_mm);
+	register_method("set_merge_distance_mm", &GDLMSensor::set_merge_distance_mm);
+	register_method("get_images_enabled", &GDLMSensor::get_images_enabled);
+	register_method("set_images_enabled", &GDLMSensor::set_images_enabled);
+	register_method("get_image_downsample", &GDLMSensor::get_image_downsample);
+	register_method("set_image_downsample", &GDLMSensor::set_image_downsample);
+	register_method("get_image_crop", &GDLMSensor::get_image_crop);
+	register_method("set_image_crop", &GDLMSensor::set_image_crop);
+	register_method("get_image_texture", &GDLMSensor::get_image_texture);
+	register_method("start_recording", &GDLMSensor::start_recording);
+	register_method("stop_recording", &GDLMSensor::stop_recording);
+	register_method("get_is_recording", &GDLMSensor::get_is_recording);
+	register_method("play_recording", &GDLMSensor::play_recording);
+	register_method("stop_playback", &GDLMSensor::stop_playback);
+	register_method("get_is_playing", &GDLMSensor::get_is_playing);
+	register_method("get_stats", &GDLMSensor::get_stats);
+	register_method("reset_stats", &GDLMSensor::reset_stats);
+	register_method("_exit_tree", &GDLMSensor::_exit_tree);
 	register_method("_physics_process", &GDLMSensor::_physics_process);
+	register_method("_process", &GDLMSensor::_process);
 	register_method("get_finger_name", &GDLMSensor::get_finger_name);
 	register_method("get_finger_bone_name", &GDLMSensor::get_finger_bone_name);
 
+	register_property<GDLMSensor, int>("frame_source", &GDLMSensor::set_frame_source, &GDLMSensor::get_frame_source, DEFAULT_FRAME_SOURCE);
+	register_property<GDLMSensor, float>("synthetic_rate", &GDLMSensor::set_synthetic_rate, &GDLMSensor::get_synthetic_rate, 110.0);
+	register_property<GDLMSensor, int>("synthetic_hands", &GDLMSensor::set_synthetic_hands, &GDLMSensor::get_synthetic_hands, 2);
+	register_property<GDLMSensor, int>("synthetic_devices", &GDLMSensor::set_synthetic_devices, &GDLMSensor::get_synthetic_devices, 1);
 	register_property<GDLMSensor, bool>("arvr", &GDLMSensor::set_arvr, &GDLMSensor::get_arvr, false);
 	register_property<GDLMSensor, float>("smooth_factor", &GDLMSensor::set_smooth_factor, &GDLMSensor::get_smooth_factor, 0.5);
+	register_property<GDLMSensor, float>("filter_min_cutoff", &GDLMSensor::set_filter_min_cutoff, &GDLMSensor::get_filter_min_cutoff, 1.0);
+	register_property<GDLMSensor, float>("filter_beta", &GDLMSensor::set_filter_beta, &GDLMSensor::get_filter_beta, 0.1);
+	register_property<GDLMSensor, float>("filter_d_cutoff", &GDLMSensor::set_filter_d_cutoff, &GDLMSensor::get_filter_d_cutoff, 1.0);
+	register_property<GDLMSensor, float>("hand_data_epsilon", &GDLMSensor::set_hand_data_epsilon, &GDLMSensor::get_hand_data_epsilon, 0.0);
+	register_property<GDLMSensor, float>("pinch_distance_epsilon_mm", &GDLMSensor::set_pinch_distance_epsilon_mm, &GDLMSensor::get_pinch_distance_epsilon_mm, 1.0);
+	register_property<GDLMSensor, bool>("push_hand_data", &GDLMSensor::set_push_hand_data, &GDLMSensor::get_push_hand_data, true);
+	register_property<GDLMSensor, float>("pinch_on_threshold", &GDLMSensor::set_pinch_on_threshold, &GDLMSensor::get_pinch_on_threshold, 0.9);
+	register_property<GDLMSensor, float>("pinch_off_threshold", &GDLMSensor::set_pinch_off_threshold, &GDLMSensor::get_pinch_off_threshold, 0.8);
+	register_property<GDLMSensor, float>("pinch_max_distance_mm", &GDLMSensor::set_pinch_max_distance_mm, &GDLMSensor::get_pinch_max_distance_mm, 0.0);
+	register_property<GDLMSensor, float>("grab_on_threshold", &GDLMSensor::set_grab_on_threshold, &GDLMSensor::get_grab_on_threshold, 0.9);
+	register_property<GDLMSensor, float>("grab_off_threshold", &GDLMSensor::set_grab_off_threshold, &GDLMSensor::get_grab_off_threshold, 0.8);
+	register_property<GDLMSensor, float>("hand_state_rate", &GDLMSensor::set_hand_state_rate, &GDLMSensor::get_hand_state_rate, 0.0);
+	register_property<GDLMSensor, bool>("collision_proxies", &GDLMSensor::set_collision_proxies, &GDLMSensor::get_collision_proxies, false);
+	register_property<GDLMSensor, int>("collision_layer", &GDLMSensor::set_collision_layer, &GDLMSensor::get_collision_layer, 1);
+	register_property<GDLMSensor, int>("collision_mask", &GDLMSensor::set_collision_mask, &GDLMSensor::get_collision_mask, 1);
+	register_property<GDLMSensor, bool>("use_bone_rotations", &GDLMSensor::set_use_bone_rotations, &GDLMSensor::get_use_bone_rotations, false);
+	register_property<GDLMSensor, float>("prediction_ms", &GDLMSensor::set_prediction_ms, &GDLMSensor::get_prediction_ms, 0.0);
+	register_property<GDLMSensor, int>("update_mode", &GDLMSensor::set_update_mode, &GDLMSensor::get_update_mode, UPDATE_PHYSICS);
 	register_property<GDLMSensor, int>("keep_hands_for_frames", &GDLMSensor::set_keep_frames, &GDLMSensor::get_keep_frames, 60);
+	register_property<GDLMSensor, bool>("arvr_trackers", &GDLMSensor::set_arvr_trackers, &GDLMSensor::get_arvr_trackers, false);
+	register_property<GDLMSensor, bool>("instance_hands", &GDLMSensor::set_instance_hands, &GDLMSensor::get_instance_hands, true);
+	register_property<GDLMSensor, int>("hand_pool_size", &GDLMSensor::set_hand_pool_size, &GDLMSensor::get_hand_pool_size, 1);
 	register_property<GDLMSensor, bool>("keep_last_hand", &GDLMSensor::set_keep_last_hand, &GDLMSensor::get_keep_last_hand, true);
+	register_property<GDLMSensor, float>("merge_distance_mm", &GDLMSensor::set_merge_distance_mm, &GDLMSensor::get_merge_distance_mm, 60.0);
+	register_property<GDLMSensor, bool>("images_enabled", &GDLMSensor::set_images_enabled, &GDLMSensor::get_images_enabled, false);
+	register_property<GDLMSensor, int>("image_downsample", &GDLMSensor::set_image_downsample, &GDLMSensor::get_image_downsample, 1);
+	register_property<GDLMSensor, Rect2>("image_crop", &GDLMSensor::set_image_crop, &GDLMSensor::get_image_crop, Rect2(0.0, 0.0, 1.0, 1.0));
 
 	register_property<GDLMSensor, String>("left_hand_scene", &GDLMSensor::set_left_hand_scene, &GDLMSensor::get_left_hand_scene, String());
 	register_property<GDLMSensor, String>("right_hand_scene", &GDLMSensor::set_right_hand_scene, &GDLMSensor::get_right_hand_scene, String());
@@ -53,42 +188,146 @@ void GDLMSensor::_init() {
 GDLMSensor::GDLMSensor() {
 	printf("Construct leap motion\n");
 
-	clock_synchronizer = NULL;
+	frame_source = NULL;
+	frame_source_type = DEFAULT_FRAME_SOURCE;
+	synthetic_rate = 110.0;
+	synthetic_hands = 2;
+	synthetic_devices = 1;
 	lm_thread = NULL;
-	is_running = false;
-	is_connected = false;
+	replay_thread = NULL;
+	is_playing.store(false);
+	replay_realtime = true;
+	is_running.store(false);
+	is_connected.store(false);
 	arvr = false;
 	keep_last_hand = true;
 	smooth_factor = 0.5;
-	last_frame = NULL;
-	last_device = NULL;
-	last_frame_id = 0;
+	filter_params.min_cutoff = 1.0;
+	filter_params.beta = 0.1;
+	filter_params.d_cutoff = 1.0;
+	has_hand_filter_params[0] = false;
+	has_hand_filter_params[1] = false;
+	hand_data_epsilon = 0.0;
+	pinch_distance_epsilon_mm = 1.0;
+	push_hand_data = true;
+	gesture_params.pinch_on = 0.9;
+	gesture_params.pinch_off = 0.8;
+	gesture_params.pinch_max_distance = 0.0;
+	gesture_params.grab_on = 0.9;
+	gesture_params.grab_off = 0.8;
+	hand_state_rate = 0.0;
+	collision_proxies = false;
+	collision_layer = 1;
+	collision_mask = 1;
+	use_bone_rotations = false;
+	prediction_ms = 0.0;
+	first_prediction = 0;
+	prediction_count = 0;
+	prediction_check_frame.event.info.timestamp = 0;
+	for (int d = 0; d < GDLM_MAX_DEVICES; d++) {
+		last_frame_ids[d] = 0;
+		last_process_frame_ids[d] = 0;
+		device_states[d].generation = 0;
+		device_states[d].transforms_version = 0;
+		device_states[d].transform.rotation.x = 0.0f;
+		device_states[d].transform.rotation.y = 0.0f;
+		device_states[d].transform.rotation.z = 0.0f;
+		device_states[d].transform.rotation.w = 1.0f;
+		device_states[d].transform.origin.x = 0.0f;
+		device_states[d].transform.origin.y = 0.0f;
+		device_states[d].transform.origin.z = 0.0f;
+		device_states[d].transform.is_identity = true;
+	}
+	device_transforms_version = 0;
+	update_mode = UPDATE_PHYSICS;
 	keep_hands_for_frames = 60;
+	hand_pool_size = 1;
+	instance_hands = true;
+	arvr_trackers = false;
+	tracker_ids[0] = 0;
+	tracker_ids[1] = 0;
+	current_frame.event.info.frame_id = 0;
+	current_frame.event.info.timestamp = 0;
+	current_frame.event.nHands = 0;
+	current_frame.event.pHands = current_frame.hands;
+	current_scale = 0.001f;
+	hand_scene_versions[0] = 0;
+	hand_scene_versions[1] = 0;
+	hand_bindings[0].is_valid = false;
+	hand_bindings[1].is_valid = false;
+	pool_hits = 0;
+	pool_misses = 0;
 
 	// assume rotated by 90 degrees on x axis and -180 on Y and 8cm from center
 	hmd_to_leap_motion.basis = Basis(Vector3(90.0f * PI / 180.0f, -180.0f * PI / 180.0f, 0.0f));
 	hmd_to_leap_motion.origin = Vector3(0.0f, 0.0f, -0.08f);
 
-	eLeapRS result = LeapCreateConnection(NULL, &leap_connection);
-	if (result == eLeapRS_Success) {
-		result = LeapOpenConnection(leap_connection);
-		if (result == eLeapRS_Success) {
-			set_is_running(true);
-			lm_thread = new std::thread(GDLMSensor::lm_main, this);
-		} else {
-			LeapDestroyConnection(leap_connection);
-			leap_connection = NULL;
-		}
-	}
+	// prepare our arguments for set_hand_state once
+	set_hand_state_method = "set_hand_state";
+	hand_state_args.resize(3);
+	hand_state_signal = "hand_state_changed";
+	hand_state_signal_args.resize(4);
+
+	start_frame_source();
 }
 
 GDLMSensor::~GDLMSensor() {
 	printf("Cleanup leap motion\n");
 
+	// stops our thread, any playback we may have going, and cleans up our source
+	stop_frame_source();
+	recorder.stop();
+	remove_trackers();
+
+	// our hands live in our slots and our scenes will be removed by Godot, our collision proxies are ours to free
+	for (int t = 0; t < 2; t++) {
+		for (uint32_t mask = hand_slots.get_scene_mask(t); mask != 0; mask &= mask - 1) {
+			free_proxies(&hands[t][GDLMHandSlots::lowest_slot(mask)]);
+		}
+	}
+}
+
+void GDLMSensor::start_frame_source() {
+	// make sure our old source is gone
+	stop_frame_source();
+
+	if (frame_source_type == FRAME_SOURCE_SYNTHETIC) {
+		GDLMSyntheticSource *synthetic_source = new GDLMSyntheticSource();
+		synthetic_source->set_rate(synthetic_rate);
+		synthetic_source->set_hand_count(synthetic_hands);
+		synthetic_source->set_device_count(synthetic_devices);
+		frame_source = synthetic_source;
+	} else {
+#ifndef GDLM_NO_LEAPC
+		frame_source = new GDLMLeapCSource();
+#else
+		printf("LeapMotion - built without LeapC, use our synthetic frame source instead\n");
+		return;
+#endif
+	}
+
+	frame_source->set_hmd_optimized(arvr);
+	frame_source->set_images_enabled(image_stream.is_enabled());
+	if (!frame_source->open()) {
+		delete frame_source;
+		frame_source = NULL;
+		return;
+	}
+
+	set_is_running(true);
+	lm_thread = new std::thread(GDLMSensor::lm_main, this);
+}
+
+void GDLMSensor::stop_frame_source() {
+	// timestamps in our recording were moved to the clock of our old source
+	stop_playback();
+
 	if (lm_thread != NULL) {
 		// if our loop is still running, this will exit it...
 		set_is_running(false);
-		set_is_connected(false);
+
+		// and this wakes it up if it's waiting on our frame source so we don't wait for it to time out
+		frame_source->interrupt();
 
 		// join up with our thread if it hasn't already completed
 		lm_thread->join();
@@ -98,93 +337,38 @@ GDLMSensor::~GDLMSensor() {
 		lm_thread = NULL;
 	}
 
-	// our thread should no longer be running so save to clean up..
-	if (clock_synchronizer != NULL) {
-		LeapDestroyClockRebaser(clock_synchronizer);
-		clock_synchronizer = NULL;
-	}
-	if (leap_connection != NULL) {
-		LeapDestroyConnection(leap_connection);
-		leap_connection = NULL;
-	}
-
-	if (last_device != NULL) {
-		// free the space we allocated for our serial number
-		::free(last_device->serial);
-
-		// free our device
-		::free(last_device);
-		last_device = NULL;
+	// our thread is no longer running so save to clean up..
+	if (frame_source != NULL) {
+		frame_source->close();
+		delete frame_source;
+		frame_source = NULL;
 	}
 
-	// and clear this JIC
-	last_frame = NULL;
-
-	// finally clean up hands, note that we don't need to free our scenes because they will be removed by Godot.
-	while (hand_nodes.size() > 0) {
-		GDLMSensor::hand_data *hd = hand_nodes.back();
-		hand_nodes.pop_back();
-		::free(hd);
+	// our devices belonged to our old source
+	for (int d = 0; d < GDLM_MAX_DEVICES; d++) {
+		device_streams[d].detach();
 	}
-}
 
-void GDLMSensor::lock() {
-	lm_mutex.lock();
-}
-
-void GDLMSensor::unlock() {
-	lm_mutex.unlock();
+	set_is_connected(false);
 }
 
 bool GDLMSensor::get_is_running() {
-	bool ret;
-
-	lock();
-	ret = is_running;
-	unlock();
-
-	return ret;
+	return is_running.load();
 }
 
 void GDLMSensor::set_is_running(bool p_set) {
-	lock();
-	is_running = p_set;
+	is_running.store(p_set);
 	// maybe issue signal?
-	unlock();
 }
 
 bool GDLMSensor::get_is_connected() {
-	bool ret;
-
-	lock();
-	ret = is_connected;
-	unlock();
-
-	return ret;
+	return is_connected.load();
 }
 
 void GDLMSensor::set_is_connected(bool p_set) {
-	lock();
-	if (is_connected != p_set) {
-		is_connected = p_set;
-		if (p_set) {
-			LeapCreateClockRebaser(&clock_synchronizer);
-
-			if (arvr) {
-				printf("Setting arvr to true\n");
-				LeapSetPolicyFlags(leap_connection, eLeapPolicyFlag_OptimizeHMD, 0);
-			} else {
-				printf("Setting arvr to false\n");
-				LeapSetPolicyFlags(leap_connection, 0, eLeapPolicyFlag_OptimizeHMD);
-			}
-		} else if (clock_synchronizer != NULL) {
-			LeapDestroyClockRebaser(clock_synchronizer);
-			clock_synchronizer = NULL;
-		}
-
-		// maybe issue signal?
-	}
-	unlock();
+	// our frame source applies our HMD policy itself once it connects
+	is_connected.store(p_set);
+	// maybe issue signal?
 }
 
 bool GDLMSensor::wait_for_connection(int timeout, int waittime) {
@@ -198,436 +382,1627 @@ bool GDLMSensor::wait_for_connection(int timeout, int waittime) {
 	return get_is_connected();
 }
 
-const LEAP_TRACKING_EVENT *GDLMSensor::get_last_frame() {
-	const LEAP_TRACKING_EVENT *ret;
+const LEAP_TRACKING_EVENT *GDLMSensor::get_interpolated_frame(int p_stream, int64_t p_leap_target_usec) {
+	// First try to interpolate our frame from our own history, this doesn't require a round trip to
+	// the leap motion service and doesn't allocate anything.
+	gdlm_frame *frame = &device_states[p_stream].frame;
+	if (device_streams[p_stream].get_history().interpolate(p_leap_target_usec, frame)) {
+		return &frame->event;
+	}
 
-	lock();
-	ret = last_frame;
-	unlock();
+	// We don't have the history for this (yet), so ask our frame source.
+	if (frame_source == NULL) {
+		return NULL;
+	}
 
-	return ret;
+	return frame_source->interpolate_frame(device_streams[p_stream].get_device_id(), p_leap_target_usec);
 }
 
-void GDLMSensor::set_last_frame(const LEAP_TRACKING_EVENT *p_frame) {
-	lock();
-	last_frame = p_frame;
-	unlock();
+const LEAP_TRACKING_EVENT *GDLMSensor::get_predicted_frame(int p_stream, int64_t p_leap_target_usec, bool p_check_predictions) {
+	// extrapolate our newest frames, our horizon keeps our hands from flying off if tracking stalls
+	gdlm_frame *frame = &device_states[p_stream].frame;
+	const GDLMFrameHistory &history = device_streams[p_stream].get_history();
+	if (!history.extrapolate(p_leap_target_usec, GDLM_MAX_PREDICTION_USEC, frame)) {
+		return NULL;
+	}
+
+	if (p_check_predictions) {
+		check_predictions(history, &frame->event);
+	}
+
+	return &frame->event;
 }
 
-const LEAP_DEVICE_INFO *GDLMSensor::get_last_device() {
-	const LEAP_DEVICE_INFO *ret;
+void GDLMSensor::check_predictions(const GDLMFrameHistory &p_history, const LEAP_TRACKING_EVENT *p_predicted) {
+	int64_t newest_usec = p_history.get_newest_timestamp();
 
-	lock();
-	ret = last_device;
-	unlock();
+	// see how far off our earlier predictions were, now that we have frames for them
+	while (prediction_count > 0 && palm_predictions[first_prediction].timestamp <= newest_usec) {
+		const palm_prediction &prediction = palm_predictions[first_prediction];
 
-	return ret;
-}
+		// all hands predicted in the same tick share a timestamp so we only interpolate once for them
+		if (prediction_check_frame.event.info.timestamp != prediction.timestamp) {
+			if (!p_history.interpolate(prediction.timestamp, &prediction_check_frame)) {
+				prediction_check_frame.event.info.timestamp = 0;
+			}
+		}
 
-void GDLMSensor::set_last_device(const LEAP_DEVICE_INFO *p_device) {
-	lock();
+		if (prediction_check_frame.event.info.timestamp == prediction.timestamp) {
+			for (uint32_t h = 0; h < prediction_check_frame.event.nHands; h++) {
+				const LEAP_HAND &hand = prediction_check_frame.hands[h];
+				if (hand.id == prediction.leap_id) {
+					Vector3 error(
+							hand.palm.position.x - prediction.position.x,
+							hand.palm.position.y - prediction.position.y,
+							hand.palm.position.z - prediction.position.z);
+					telemetry.prediction_checked(error.length());
+					break;
+				}
+			}
+		}
 
-	if (last_device != NULL) {
-		// free the space we allocated for our serial number
-		::free(last_device->serial);
-	} else {
-		// allocate memory to store our device in
-		last_device = (LEAP_DEVICE_INFO *)malloc(sizeof(*p_device));
+		first_prediction = (first_prediction + 1) % GDLM_MAX_PREDICTIONS;
+		prediction_count--;
 	}
 
-	// make a copy of our settings
-	*last_device = *p_device;
+	// only remember predictions we actually extrapolated
+	if (p_predicted->info.timestamp <= newest_usec) {
+		return;
+	}
 
-	// but allocate our own buffer for the serial number
-	last_device->serial = (char *)malloc(p_device->serial_length);
-	memcpy(last_device->serial, p_device->serial, p_device->serial_length);
+	for (uint32_t h = 0; h < p_predicted->nHands; h++) {
+		if (prediction_count == GDLM_MAX_PREDICTIONS) {
+			// forget our oldest prediction
+			first_prediction = (first_prediction + 1) % GDLM_MAX_PREDICTIONS;
+			prediction_count--;
+		}
 
-	unlock();
+		palm_prediction &prediction = palm_predictions[(first_prediction + prediction_count) % GDLM_MAX_PREDICTIONS];
+		prediction.timestamp = p_predicted->info.timestamp;
+		prediction.leap_id = p_predicted->pHands[h].id;
+		prediction.position = p_predicted->pHands[h].palm.position;
+		prediction_count++;
+	}
 }
 
-bool GDLMSensor::get_arvr() const {
-	return arvr;
+int GDLMSensor::get_frame_source() const {
+	return frame_source_type;
 }
 
-void GDLMSensor::set_arvr(bool p_set) {
-	lock();
-
-	if (arvr != p_set) {
-		arvr = p_set;
-		if (is_connected) {
-			if (arvr) {
-				printf("Setting arvr to true\n");
-				LeapSetPolicyFlags(leap_connection, eLeapPolicyFlag_OptimizeHMD, 0);
-			} else {
-				printf("Setting arvr to false\n");
-				LeapSetPolicyFlags(leap_connection, 0, eLeapPolicyFlag_OptimizeHMD);
-			}
-		}
+void GDLMSensor::set_frame_source(int p_type) {
+	if (p_type != FRAME_SOURCE_LEAPC && p_type != FRAME_SOURCE_SYNTHETIC) {
+		printf("LeapMotion - unknown frame source %i\n", p_type);
+		return;
 	}
 
-	unlock();
-
-/*	if (arvr != p_set) {
-		if (leap_connection != NULL) {
-			printf("Wait for connection\n");
-			if (wait_for_connection()) {
-				arvr = p_set;
-				if (arvr) {
-					printf("Setting arvr to true\n");
-					LeapSetPolicyFlags(leap_connection, eLeapPolicyFlag_OptimizeHMD, 0);
-				} else {
-					printf("Setting arvr to false\n");
-					LeapSetPolicyFlags(leap_connection, 0, eLeapPolicyFlag_OptimizeHMD);
-				}
-			} else {
-				printf("Failed to set ARVR\n");
-			}
-		}
-	}*/
+	if (frame_source_type != p_type) {
+		frame_source_type = p_type;
+		start_frame_source();
+	}
 }
 
-float GDLMSensor::get_smooth_factor() const {
-	return smooth_factor;
+float GDLMSensor::get_synthetic_rate() const {
+	return synthetic_rate;
 }
 
-void GDLMSensor::set_smooth_factor(float p_smooth_factor) {
-	smooth_factor = p_smooth_factor;
+void GDLMSensor::set_synthetic_rate(float p_rate) {
+	synthetic_rate = p_rate;
+	if (frame_source != NULL && frame_source_type == FRAME_SOURCE_SYNTHETIC) {
+		// safe while our thread is running
+		((GDLMSyntheticSource *)frame_source)->set_rate(p_rate);
+	}
 }
 
-int GDLMSensor::get_keep_frames() const {
-	return keep_hands_for_frames;
+int GDLMSensor::get_synthetic_hands() const {
+	return synthetic_hands;
 }
 
-void GDLMSensor::set_keep_frames(int p_keep_frames) {
-	keep_hands_for_frames = p_keep_frames;
+void GDLMSensor::set_synthetic_hands(int p_count) {
+	synthetic_hands = p_count;
+	if (frame_source != NULL && frame_source_type == FRAME_SOURCE_SYNTHETIC) {
+		// safe while our thread is running
+		((GDLMSyntheticSource *)frame_source)->set_hand_count(p_count);
+	}
 }
 
-bool GDLMSensor::get_keep_last_hand() const {
-	return keep_last_hand;
+int GDLMSensor::get_synthetic_devices() const {
+	return synthetic_devices;
 }
 
-void GDLMSensor::set_keep_last_hand(bool p_keep_hand) {
-	keep_last_hand = p_keep_hand;
+void GDLMSensor::set_synthetic_devices(int p_count) {
+	synthetic_devices = p_count;
+	if (frame_source != NULL && frame_source_type == FRAME_SOURCE_SYNTHETIC) {
+		// safe while our thread is running, our source tells us about its new devices on its next poll
+		((GDLMSyntheticSource *)frame_source)->set_device_count(p_count);
+	}
 }
 
-Transform GDLMSensor::get_hmd_to_leap_motion() const {
-	return hmd_to_leap_motion;
+bool GDLMSensor::get_arvr() const {
+	return arvr;
 }
 
-void GDLMSensor::set_hmd_to_leap_motion(Transform p_transform) {
-	hmd_to_leap_motion = p_transform;
+void GDLMSensor::set_arvr(bool p_set) {
+	bool changed = arvr != p_set;
+	arvr = p_set;
+
+	if (changed && frame_source != NULL) {
+		frame_source->set_hmd_optimized(p_set);
+	}
 }
 
-String GDLMSensor::get_left_hand_scene() const {
-	return hand_scene_names[0];
+float GDLMSensor::get_smooth_factor() const {
+	return smooth_factor;
 }
 
-void GDLMSensor::set_left_hand_scene(String p_resource) {
-	if (hand_scene_names[0] != p_resource) {
-		hand_scene_names[0] = p_resource;
+void GDLMSensor::set_smooth_factor(float p_smooth_factor) {
+	smooth_factor = p_smooth_factor;
+}
 
-		// maybe delay loading until we need it?
-		hand_scenes[0] = ResourceLoader::get_singleton()->load(p_resource);
-	}
+float GDLMSensor::get_filter_min_cutoff() const {
+	return filter_params.min_cutoff;
 }
 
-String GDLMSensor::get_right_hand_scene() const {
-	return hand_scene_names[1];
+void GDLMSensor::set_filter_min_cutoff(float p_min_cutoff) {
+	// 0.0 turns our filter off
+	filter_params.min_cutoff = p_min_cutoff < 0.0 ? 0.0 : p_min_cutoff;
 }
 
-void GDLMSensor::set_right_hand_scene(String p_resource) {
-	if (hand_scene_names[1] != p_resource) {
-		hand_scene_names[1] = p_resource;
+float GDLMSensor::get_filter_beta() const {
+	return filter_params.beta;
+}
 
-		// maybe delay loading until we need it?
-		hand_scenes[1] = ResourceLoader::get_singleton()->load(p_resource);
-	}
+void GDLMSensor::set_filter_beta(float p_beta) {
+	filter_params.beta = p_beta < 0.0 ? 0.0 : p_beta;
 }
 
-const char *const GDLMSensor::finger[] = {
-	"Thumb", "Index", "Middle", "Ring", "Pink"
-};
+float GDLMSensor::get_filter_d_cutoff() const {
+	return filter_params.d_cutoff;
+}
 
-String GDLMSensor::get_finger_name(int p_idx) {
-	String finger_name;
+void GDLMSensor::set_filter_d_cutoff(float p_d_cutoff) {
+	filter_params.d_cutoff = p_d_cutoff < 0.0 ? 0.0 : p_d_cutoff;
+}
 
-	if (p_idx > 0 && p_idx <= 5) {
-		finger_name = finger[p_idx - 1];
+void GDLMSensor::set_hand_filter(int p_type, float p_min_cutoff, float p_beta, float p_d_cutoff) {
+	if (p_type < 0 || p_type > 1) {
+		printf("LeapMotion - Unknown hand type %i\n", p_type);
+		return;
 	}
 
-	return finger_name;
+	hand_filter_params[p_type].min_cutoff = p_min_cutoff < 0.0 ? 0.0 : p_min_cutoff;
+	hand_filter_params[p_type].beta = p_beta < 0.0 ? 0.0 : p_beta;
+	hand_filter_params[p_type].d_cutoff = p_d_cutoff < 0.0 ? 0.0 : p_d_cutoff;
+	has_hand_filter_params[p_type] = true;
 }
 
-const char *const GDLMSensor::finger_bone[] = {
-	"Metacarpal", "Proximal", "Intermediate", "Distal"
-};
-
-String GDLMSensor::get_finger_bone_name(int p_idx) {
-	String finger_bone_name;
-
-	if (p_idx > 0 && p_idx <= 5) {
-		finger_bone_name = finger_bone[p_idx - 1];
+void GDLMSensor::clear_hand_filter(int p_type) {
+	if (p_type < 0 || p_type > 1) {
+		printf("LeapMotion - Unknown hand type %i\n", p_type);
+		return;
 	}
 
-	return finger_bone_name;
+	has_hand_filter_params[p_type] = false;
 }
 
-void GDLMSensor::update_hand_data(GDLMSensor::hand_data *p_hand_data, LEAP_HAND *p_leap_hand) {
-	Array args;
+float GDLMSensor::get_hand_data_epsilon() const {
+	return hand_data_epsilon;
+}
 
-	if (p_hand_data == NULL)
-		return;
+void GDLMSensor::set_hand_data_epsilon(float p_epsilon) {
+	hand_data_epsilon = p_epsilon;
+}
 
-	if (p_hand_data->scene == NULL)
-		return;
+float GDLMSensor::get_pinch_distance_epsilon_mm() const {
+	return pinch_distance_epsilon_mm;
+}
 
-	// first pinch distance
-	args.push_back(Variant(p_leap_hand->pinch_distance));
-	p_hand_data->scene->call("set_pinch_distance", args);
+void GDLMSensor::set_pinch_distance_epsilon_mm(float p_epsilon) {
+	pinch_distance_epsilon_mm = p_epsilon;
+}
 
-	// then pinch strength
-	args.clear();
-	args.push_back(Variant(p_leap_hand->pinch_strength));
-	p_hand_data->scene->call("set_pinch_strength", args);
+bool GDLMSensor::get_push_hand_data() const {
+	return push_hand_data;
+}
 
-	// and grab strength
-	args.clear();
-	args.push_back(Variant(p_leap_hand->grab_strength));
-	p_hand_data->scene->call("set_grab_strength", args);
-};
+void GDLMSensor::set_push_hand_data(bool p_set) {
+	push_hand_data = p_set;
+}
 
-void GDLMSensor::update_hand_position(GDLMSensor::hand_data *p_hand_data, LEAP_HAND *p_leap_hand) {
-	Transform hand_transform;
+float GDLMSensor::get_pinch_on_threshold() const {
+	return gesture_params.pinch_on;
+}
 
-	if (p_hand_data == NULL)
-		return;
+void GDLMSensor::set_pinch_on_threshold(float p_threshold) {
+	gesture_params.pinch_on = p_threshold;
+}
 
-	if (p_hand_data->scene == NULL)
-		return;
+float GDLMSensor::get_pinch_off_threshold() const {
+	return gesture_params.pinch_off;
+}
 
-	// orientation of our hand using LeapC quarternion
-	Quat quat(p_leap_hand->palm.orientation.x, p_leap_hand->palm.orientation.y, p_leap_hand->palm.orientation.z, p_leap_hand->palm.orientation.w);
-	Basis base_orientation(quat);
+void GDLMSensor::set_pinch_off_threshold(float p_threshold) {
+	gesture_params.pinch_off = p_threshold;
+}
 
-	// apply to our transform
-	hand_transform.set_basis(base_orientation);
+float GDLMSensor::get_pinch_max_distance_mm() const {
+	return gesture_params.pinch_max_distance;
+}
 
-	// position of our hand
-	Vector3 hand_position(
-			p_leap_hand->palm.position.x * world_scale,
-			p_leap_hand->palm.position.y * world_scale,
-			p_leap_hand->palm.position.z * world_scale);
-	hand_transform.set_origin(hand_position);
+void GDLMSensor::set_pinch_max_distance_mm(float p_distance) {
+	gesture_params.pinch_max_distance = p_distance;
+}
 
-	// get our inverse for positioning the rest of the hand
-	Transform hand_inverse = hand_transform.inverse();
+float GDLMSensor::get_grab_on_threshold() const {
+	return gesture_params.grab_on;
+}
 
-	// if in ARVR mode we should xform this to convert from HMD relative position to Origin world position
-	if (arvr) {
-		Transform last_transform = p_hand_data->scene->get_transform();
-		hand_transform = hmd_transform * hmd_to_leap_motion * hand_transform;
+void GDLMSensor::set_grab_on_threshold(float p_threshold) {
+	gesture_params.grab_on = p_threshold;
+}
 
-		// leap motions frame interpolation is pretty good but we're going to smooth things out a little bit
-		// to stop hands from visible drifting when the user turns his/her head. We can live with the position
-		// of the hand being a few frames behind
-		hand_transform.origin = last_transform.origin.linear_interpolate(hand_transform.origin, smooth_factor);
-	};
+float GDLMSensor::get_grab_off_threshold() const {
+	return gesture_params.grab_off;
+}
 
-	// and apply
-	p_hand_data->scene->set_transform(hand_transform);
+void GDLMSensor::set_grab_off_threshold(float p_threshold) {
+	gesture_params.grab_off = p_threshold;
+}
 
-	// lets parse our digits
-	for (int d = 0; d < 5; d++) {
-		LEAP_DIGIT *digit = &p_leap_hand->digits[d];
-		LEAP_BONE *bone = &digit->bones[0];
-
-		// logic for positioning stuff
-		Transform parent_inverse = hand_inverse;
-		Vector3 up = Vector3(0.0, 1.0, 0.0);
-		Transform bone_pose;
-
-		// Our first bone provides our starting position for our first node
-		Vector3 bone_start_pos(
-				bone->prev_joint.x * world_scale,
-				bone->prev_joint.y * world_scale,
-				bone->prev_joint.z * world_scale);
-		bone_start_pos = parent_inverse.xform(bone_start_pos);
-		bone_pose.origin = bone_start_pos;
-
-		// For now assume order, we may change this to naming, we should cache this, maybe do this when we load our scene.
-		Spatial *digit_node = p_hand_data->finger_nodes[d];
-		if (digit_node != NULL) {
-			// And handle our bones.
-			int first_bone = d == 0 ? 1 : 0; // we skip the first bone for our thumb
-			for (int b = first_bone; b < 4; b++) {
-				bone = &digit->bones[b];
-
-				// We calculate rotation with LeapC's quarternion, I couldn't get this to work right.
-				// This gives our rotation in world space which we need to change to the rotation diffence
-				// between this node and the previous one. Somehow it gets the axis wrong...
-				// Should revisit it some day, if we do this code becomes much simpler :)
-				// Quat quat(bone->rotation.x, bone->rotation.y, bone->rotation.z, bone->rotation.w);
-				// Basis bone_rotation(quat);
-
-				// We calculate rotation based on our next joint position
-				Vector3 bone_pos(
-						bone->next_joint.x * world_scale,
-						bone->next_joint.y * world_scale,
-						bone->next_joint.z * world_scale);
-
-				// transform it based on our last locale
-				bone_pos = parent_inverse.xform(bone_pos);
-				// remove previous position to get our delta
-				bone_pos -= bone_pose.origin;
-
-				// Standard cross normalise with up to create our matrix. Could fail on a 90 degree bend.
-				Vector3 axis_z = bone_pos;
-				axis_z.normalize();
-				Vector3 axis_x = up.cross(axis_z).normalized();
-				Vector3 axis_y = axis_z.cross(axis_x).normalized();
-
-				bone_pose.basis.set_axis(0, axis_x);
-				bone_pose.basis.set_axis(1, axis_y);
-				bone_pose.basis.set_axis(2, axis_z);
-
-				if (digit_node != NULL) {
-					// now we can set our parent
-					digit_node->set_transform(bone_pose);
-
-					digit_node = p_hand_data->digit_nodes[d][b];
-				}
+float GDLMSensor::get_hand_state_rate() const {
+	return hand_state_rate;
+}
 
-				// and update for next iteration
-				parent_inverse = bone_pose.inverse() * parent_inverse;
+void GDLMSensor::set_hand_state_rate(float p_rate) {
+	hand_state_rate = p_rate;
+}
 
-				// Our next nodes origin...
-				bone_pose.origin = Vector3(0.0, 0.0, bone_pos.length());
-			}
+bool GDLMSensor::get_collision_proxies() const {
+	return collision_proxies;
+}
 
-			// set our last digits transform...
-			if (digit_node != NULL) {
-				bone_pose.basis = Basis();
-				digit_node->set_transform(bone_pose);
+void GDLMSensor::set_collision_proxies(bool p_set) {
+	if (collision_proxies == p_set) {
+		return;
+	}
+	collision_proxies = p_set;
+
+	// hands we already have, including those in our pool, gain or lose their proxies right away
+	for (int t = 0; t < 2; t++) {
+		for (uint32_t mask = hand_slots.get_scene_mask(t); mask != 0; mask &= mask - 1) {
+			hand_data *hd = &hands[t][GDLMHandSlots::lowest_slot(mask)];
+			if (p_set) {
+				create_proxies(hd);
+			} else {
+				free_proxies(hd);
 			}
 		}
 	}
+}
 
-	// do we want to do something with the arm?
+int GDLMSensor::get_collision_layer() const {
+	return collision_layer;
 }
 
-GDLMSensor::hand_data *GDLMSensor::find_hand_by_id(int p_type, uint32_t p_leap_id) {
-	for (int h = 0; h < hand_nodes.size(); h++) {
-		if ((hand_nodes[h]->type == p_type) && (hand_nodes[h]->leap_id == p_leap_id)) {
-			return hand_nodes[h];
+void GDLMSensor::set_collision_layer(int p_layer) {
+	collision_layer = p_layer;
+
+	PhysicsServer *physics_server = PhysicsServer::get_singleton();
+	for (int t = 0; t < 2; t++) {
+		for (uint32_t mask = hand_slots.get_scene_mask(t); mask != 0; mask &= mask - 1) {
+			hand_data *hd = &hands[t][GDLMHandSlots::lowest_slot(mask)];
+			if (hd->proxy_body.is_valid()) {
+				physics_server->body_set_collision_layer(hd->proxy_body, collision_layer);
+			}
 		}
 	}
+}
 
-	return NULL;
+int GDLMSensor::get_collision_mask() const {
+	return collision_mask;
 }
 
-GDLMSensor::hand_data *GDLMSensor::find_unused_hand(int p_type) {
-	for (int h = 0; h < hand_nodes.size(); h++) {
-		// note, unused_frames must be bigger then 0, else its just that we've reset this.
-		if ((hand_nodes[h]->type == p_type) && (hand_nodes[h]->active_this_frame == false) && (hand_nodes[h]->unused_frames > 0)) {
-			return hand_nodes[h];
+void GDLMSensor::set_collision_mask(int p_mask) {
+	collision_mask = p_mask;
+
+	PhysicsServer *physics_server = PhysicsServer::get_singleton();
+	for (int t = 0; t < 2; t++) {
+		for (uint32_t mask = hand_slots.get_scene_mask(t); mask != 0; mask &= mask - 1) {
+			hand_data *hd = &hands[t][GDLMHandSlots::lowest_slot(mask)];
+			if (hd->proxy_body.is_valid()) {
+				physics_server->body_set_collision_mask(hd->proxy_body, collision_mask);
+			}
 		}
 	}
+}
 
-	return NULL;
+bool GDLMSensor::get_use_bone_rotations() const {
+	return use_bone_rotations;
 }
 
-int GDLMSensor::count_hands(int p_type, bool p_active_only) {
-	int count = 0;
-	for (int h = 0; h < hand_nodes.size(); h++) {
-		if (hand_nodes[h]->type == p_type && (hand_nodes[h]->active_this_frame || !p_active_only)) {
-			count++;
-		}
-	}
+void GDLMSensor::set_use_bone_rotations(bool p_set) {
+	use_bone_rotations = p_set;
+}
 
-	return count;
+float GDLMSensor::get_prediction_ms() const {
+	return prediction_ms;
 }
 
-GDLMSensor::hand_data *GDLMSensor::new_hand(int p_type, uint32_t p_leap_id) {
-	if (hand_scenes[p_type].is_null()) {
-		return NULL;
-	} else if (!hand_scenes[p_type]->can_instance()) {
-		return NULL;
+void GDLMSensor::set_prediction_ms(float p_prediction_ms) {
+	// we don't predict into the past, and never further than we can reasonably extrapolate
+	if (p_prediction_ms < 0.0) {
+		p_prediction_ms = 0.0;
+	} else if (p_prediction_ms > GDLM_MAX_PREDICTION_USEC / 1000.0) {
+		p_prediction_ms = GDLM_MAX_PREDICTION_USEC / 1000.0;
 	}
 
-	hand_data *new_hand_data = (hand_data *)malloc(sizeof(hand_data));
+	prediction_ms = p_prediction_ms;
+}
 
-	new_hand_data->type = p_type;
-	new_hand_data->leap_id = p_leap_id;
-	new_hand_data->active_this_frame = true;
-	new_hand_data->unused_frames = 0;
+int GDLMSensor::get_update_mode() const {
+	return update_mode;
+}
 
-	new_hand_data->scene = (Spatial *)hand_scenes[p_type]->instance(); // is it safe to cast like this?
-	new_hand_data->scene->set_name(String("Hand ") + String(p_type) + String(" ") + String(p_leap_id));
-	add_child(new_hand_data->scene, false);
+void GDLMSensor::set_update_mode(int p_mode) {
+	if (p_mode < UPDATE_PHYSICS || p_mode > UPDATE_SPLIT) {
+		printf("LeapMotion - Unknown update mode %i\n", p_mode);
+		return;
+	}
 
-	for (int d = 0; d < 5; d++) {
-		Spatial *node = (Spatial *)new_hand_data->scene->find_node(String(finger[d]), false);
-		if (node == NULL) {
-			printf("Couldn''t find node %s\n", finger[d]);
-
-			// clear just in case
-			new_hand_data->finger_nodes[d] = NULL;
-			for (int b = 0; b < 4; b++) {
-				new_hand_data->digit_nodes[d][b] = NULL;
-			}
-		} else {
-			new_hand_data->finger_nodes[d] = node;
+	// make sure whichever process takes over applies our next frame
+	update_mode = p_mode;
+	for (int d = 0; d < GDLM_MAX_DEVICES; d++) {
+		last_frame_ids[d] = 0;
+		last_process_frame_ids[d] = 0;
+	}
+}
 
-			int first_bone = 0;
-			if (d == 0) {
-				// we're one digit short on our thumb...
-				new_hand_data->digit_nodes[0][0] = NULL;
-				first_bone = 1;
-			}
-			for (int b = first_bone; b < 4; b++) {
-				if (node != NULL) {
-					// find our child node...
-					char node_name[256];
-					sprintf(node_name, "%s_%s", finger[d], finger_bone[b]);
-					node = (Spatial *)node->find_node(String(node_name), false);
-					if (node == NULL) {
-						printf("Couldn''t find node %s\n", node_name);
-					}
-				}
+int GDLMSensor::get_hand_pool_size() const {
+	return hand_pool_size;
+}
 
-				// even if node is NULL, assign it, we want to make sure we don't have old pointers...
-				new_hand_data->digit_nodes[d][b] = node;
-			}
-		}
+void GDLMSensor::set_hand_pool_size(int p_size) {
+	if (p_size < 0) {
+		p_size = 0;
+	} else if (p_size > GDLM_MAX_HAND_SLOTS) {
+		p_size = GDLM_MAX_HAND_SLOTS;
 	}
 
-	Array args;
-	args.push_back(Variant(new_hand_data->scene));
-	emit_signal("new_hand", args);
+	if (hand_pool_size != p_size) {
+		hand_pool_size = p_size;
+		fill_hand_pool(0);
+		fill_hand_pool(1);
+	}
+}
 
-	return new_hand_data;
+int GDLMSensor::get_hand_pool_hits() const {
+	return pool_hits;
 }
 
-void GDLMSensor::delete_hand(GDLMSensor::hand_data *p_hand_data) {
-	// this should free everything up and invalidate it, no need to do anything more...
-	if (p_hand_data->scene != NULL) {
+int GDLMSensor::get_hand_pool_misses() const {
+	return pool_misses;
+}
+
+bool GDLMSensor::get_instance_hands() const {
+	return instance_hands;
+}
+
+void GDLMSensor::set_instance_hands(bool p_set) {
+	if (instance_hands == p_set) {
+		return;
+	}
+	instance_hands = p_set;
+
+	for (int t = 0; t < 2; t++) {
+		if (!instance_hands) {
+			// remove the hands we have, our pool empties itself as its size is now zero
+			for (uint32_t used = hand_slots.get_used_mask(t); used != 0; used &= used - 1) {
+				delete_hand(&hands[t][GDLMHandSlots::lowest_slot(used)]);
+			}
+		}
+		fill_hand_pool(t);
+	}
+}
+
+bool GDLMSensor::get_arvr_trackers() const {
+	return arvr_trackers;
+}
+
+void GDLMSensor::set_arvr_trackers(bool p_set) {
+	arvr_trackers = p_set;
+	if (!arvr_trackers) {
+		remove_trackers();
+	}
+}
+
+int GDLMSensor::get_tracker_id(int p_type) const {
+	if (p_type < 0 || p_type > 1) {
+		printf("LeapMotion - Unknown hand type %i\n", p_type);
+		return 0;
+	}
+
+	return tracker_ids[p_type];
+}
+
+// brings a point from leap motion space into the space of our node
+static inline Vector3 to_local(const Transform &p_transform, float p_scale, const LEAP_VECTOR &p_vector) {
+	return p_transform.xform(Vector3(p_vector.x * p_scale, p_vector.y * p_scale, p_vector.z * p_scale));
+}
+
+// our 25 joints, for each digit the start of its metacarpal followed by the end of each of its bones,
+// our thumbs metacarpal has no length so its first two joints are the same
+static void write_hand_joints(const LEAP_HAND *p_hand, const Transform &p_transform, float p_scale, Vector3 *r_joints) {
+	for (int d = 0; d < 5; d++) {
+		const LEAP_DIGIT &digit = p_hand->digits[d];
+		*r_joints++ = to_local(p_transform, p_scale, digit.bones[0].prev_joint);
+		for (int b = 0; b < 4; b++) {
+			*r_joints++ = to_local(p_transform, p_scale, digit.bones[b].next_joint);
+		}
+	}
+}
+
+static inline void write_vector(real_t *r_values, const Vector3 &p_vector) {
+	r_values[0] = p_vector.x;
+	r_values[1] = p_vector.y;
+	r_values[2] = p_vector.z;
+}
+
+static void write_hand_values(const LEAP_HAND *p_hand, const Transform &p_transform, float p_scale, real_t *r_values) {
+	r_values[GDLMSensor::HAND_VALUE_ID] = (real_t)p_hand->id;
+	r_values[GDLMSensor::HAND_VALUE_TYPE] = p_hand->type == eLeapHandType_Left ? 0.0 : 1.0;
+	r_values[GDLMSensor::HAND_VALUE_CONFIDENCE] = p_hand->confidence;
+	r_values[GDLMSensor::HAND_VALUE_VISIBLE_TIME] = (real_t)((double)p_hand->visible_time / 1000000.0);
+	r_values[GDLMSensor::HAND_VALUE_PINCH_DISTANCE] = p_hand->pinch_distance;
+	r_values[GDLMSensor::HAND_VALUE_PINCH_STRENGTH] = p_hand->pinch_strength;
+	r_values[GDLMSensor::HAND_VALUE_GRAB_STRENGTH] = p_hand->grab_strength;
+	r_values[GDLMSensor::HAND_VALUE_GRAB_ANGLE] = p_hand->grab_angle;
+
+	// our orientation and directions only need rotating, our velocity also needs scaling
+	const LEAP_PALM &palm = p_hand->palm;
+	Quat orientation(palm.orientation.x, palm.orientation.y, palm.orientation.z, palm.orientation.w);
+	orientation = (p_transform.basis * Basis(orientation)).get_quat();
+	write_vector(r_values + GDLMSensor::HAND_VALUE_PALM_POSITION, to_local(p_transform, p_scale, palm.position));
+	r_values[GDLMSensor::HAND_VALUE_PALM_ORIENTATION] = orientation.x;
+	r_values[GDLMSensor::HAND_VALUE_PALM_ORIENTATION + 1] = orientation.y;
+	r_values[GDLMSensor::HAND_VALUE_PALM_ORIENTATION + 2] = orientation.z;
+	r_values[GDLMSensor::HAND_VALUE_PALM_ORIENTATION + 3] = orientation.w;
+	write_vector(r_values + GDLMSensor::HAND_VALUE_PALM_VELOCITY, p_transform.basis.xform(Vector3(palm.velocity.x, palm.velocity.y, palm.velocity.z) * p_scale));
+	write_vector(r_values + GDLMSensor::HAND_VALUE_PALM_NORMAL, p_transform.basis.xform(Vector3(palm.normal.x, palm.normal.y, palm.normal.z)));
+	write_vector(r_values + GDLMSensor::HAND_VALUE_PALM_DIRECTION, p_transform.basis.xform(Vector3(palm.direction.x, palm.direction.y, palm.direction.z)));
+	r_values[GDLMSensor::HAND_VALUE_PALM_WIDTH] = palm.width * p_scale;
+
+	// our arm runs from our elbow to our wrist
+	write_vector(r_values + GDLMSensor::HAND_VALUE_ELBOW, to_local(p_transform, p_scale, p_hand->arm.prev_joint));
+	write_vector(r_values + GDLMSensor::HAND_VALUE_WRIST, to_local(p_transform, p_scale, p_hand->arm.next_joint));
+	r_values[GDLMSensor::HAND_VALUE_ARM_WIDTH] = p_hand->arm.width * p_scale;
+}
+
+int GDLMSensor::get_hand_count() const {
+	return (int)current_frame.event.nHands;
+}
+
+PoolVector3Array GDLMSensor::get_hand_joints(int p_index) const {
+	PoolVector3Array joints;
+	if (p_index < 0 || p_index >= (int)current_frame.event.nHands) {
+		return joints;
+	}
+
+	joints.resize(25);
+	{
+		PoolVector3Array::Write write = joints.write();
+		write_hand_joints(&current_frame.hands[p_index], current_transform, current_scale, write.ptr());
+	}
+
+	return joints;
+}
+
+PoolRealArray GDLMSensor::get_hand_data(int p_index) const {
+	PoolRealArray values;
+	if (p_index < 0 || p_index >= (int)current_frame.event.nHands) {
+		return values;
+	}
+
+	values.resize(HAND_VALUE_COUNT);
+	{
+		PoolRealArray::Write write = values.write();
+		write_hand_values(&current_frame.hands[p_index], current_transform, current_scale, write.ptr());
+	}
+
+	return values;
+}
+
+PoolVector3Array GDLMSensor::get_all_hand_joints() const {
+	PoolVector3Array joints;
+	int count = (int)current_frame.event.nHands;
+
+	joints.resize(25 * count);
+	{
+		PoolVector3Array::Write write = joints.write();
+		for (int h = 0; h < count; h++) {
+			write_hand_joints(&current_frame.hands[h], current_transform, current_scale, write.ptr() + 25 * h);
+		}
+	}
+
+	return joints;
+}
+
+PoolRealArray GDLMSensor::get_all_hand_data() const {
+	PoolRealArray values;
+	int count = (int)current_frame.event.nHands;
+
+	values.resize(HAND_VALUE_COUNT * count);
+	{
+		PoolRealArray::Write write = values.write();
+		for (int h = 0; h < count; h++) {
+			write_hand_values(&current_frame.hands[h], current_transform, current_scale, write.ptr() + HAND_VALUE_COUNT * h);
+		}
+	}
+
+	return values;
+}
+
+int GDLMSensor::get_keep_frames() const {
+	return keep_hands_for_frames;
+}
+
+void GDLMSensor::set_keep_frames(int p_keep_frames) {
+	keep_hands_for_frames = p_keep_frames;
+}
+
+bool GDLMSensor::get_keep_last_hand() const {
+	return keep_last_hand;
+}
+
+void GDLMSensor::set_keep_last_hand(bool p_keep_hand) {
+	keep_last_hand = p_keep_hand;
+}
+
+Transform GDLMSensor::get_hmd_to_leap_motion() const {
+	return hmd_to_leap_motion;
+}
+
+void GDLMSensor::set_hmd_to_leap_motion(Transform p_transform) {
+	hmd_to_leap_motion = p_transform;
+}
+
+Array GDLMSensor::get_devices() {
+	Array devices;
+
+	for (int d = 0; d < GDLM_MAX_DEVICES; d++) {
+		if (device_streams[d].is_attached()) {
+			refresh_device(d);
+			devices.push_back(device_states[d].serial);
+		}
+	}
+
+	return devices;
+}
+
+Transform GDLMSensor::get_device_transform(String p_serial) const {
+	if (!device_transforms.has(p_serial)) {
+		return Transform();
+	}
+
+	return device_transforms[p_serial];
+}
+
+void GDLMSensor::set_device_transform(String p_serial, Transform p_transform) {
+	// we apply this to our hands before we turn them into Godot units, so our origin is always in meters
+	device_transforms[p_serial] = p_transform;
+	device_transforms_version++;
+}
+
+float GDLMSensor::get_merge_distance_mm() const {
+	return hand_merger.get_merge_distance();
+}
+
+void GDLMSensor::set_merge_distance_mm(float p_distance) {
+	hand_merger.set_merge_distance(p_distance);
+}
+
+bool GDLMSensor::get_images_enabled() const {
+	return image_stream.is_enabled();
+}
+
+void GDLMSensor::set_images_enabled(bool p_set) {
+	image_stream.set_enabled(p_set);
+	if (frame_source != NULL) {
+		frame_source->set_images_enabled(p_set);
+	}
+}
+
+int GDLMSensor::get_image_downsample() {
+	return image_stream.get_settings().downsample;
+}
+
+void GDLMSensor::set_image_downsample(int p_downsample) {
+	gdlm_image_settings settings = image_stream.get_settings();
+	settings.downsample = p_downsample < 1 ? 1 : p_downsample;
+	image_stream.set_settings(settings);
+}
+
+Rect2 GDLMSensor::get_image_crop() {
+	gdlm_image_settings settings = image_stream.get_settings();
+	return Rect2(settings.crop_x, settings.crop_y, settings.crop_width, settings.crop_height);
+}
+
+void GDLMSensor::set_image_crop(Rect2 p_crop) {
+	gdlm_image_settings settings = image_stream.get_settings();
+	settings.crop_x = p_crop.position.x;
+	settings.crop_y = p_crop.position.y;
+	settings.crop_width = p_crop.size.x;
+	settings.crop_height = p_crop.size.y;
+	image_stream.set_settings(settings);
+}
+
+Ref<ImageTexture> GDLMSensor::get_image_texture(int p_camera) {
+	if (p_camera < 0 || p_camera > 1) {
+		return Ref<ImageTexture>();
+	}
+
+	// our textures stay the same, we only update their data, so you can assign them once
+	if (image_textures[p_camera].is_null()) {
+		image_textures[p_camera].instance();
+	}
+
+	return image_textures[p_camera];
+}
+
+void GDLMSensor::update_images() {
+	const gdlm_image_pair *pair = image_stream.read();
+	if (pair == NULL) {
+		// nothing new
+		return;
+	}
+
+	int size = (int)(pair->width * pair->height);
+	for (int c = 0; c < 2; c++) {
+		// Godot needs the pixels in its own array, this is the only copy we make on our main thread
+		PoolByteArray data;
+		data.resize(size);
+		{
+			PoolByteArray::Write write = data.write();
+			memcpy(write.ptr(), pair->pixels[c], size);
+		}
+
+		if (images[c].is_null()) {
+			images[c].instance();
+		}
+		images[c]->create_from_data(pair->width, pair->height, false, Image::FORMAT_L8, data);
+
+		Ref<ImageTexture> texture = get_image_texture(c);
+		if (texture->get_width() != (int64_t)pair->width || texture->get_height() != (int64_t)pair->height) {
+			// our first image, or our crop or downsampling changed
+			texture->create_from_image(images[c], Texture::FLAG_FILTER);
+		} else {
+			texture->set_data(images[c]);
+		}
+	}
+}
+
+void GDLMSensor::refresh_device(int p_stream) {
+	device_state &state = device_states[p_stream];
+
+	// our leap thread bumps our generation when another device takes over this stream
+	char serial[GDLM_MAX_SERIAL];
+	uint32_t generation = device_streams[p_stream].get_serial(serial);
+	if (generation != state.generation) {
+		state.generation = generation;
+		state.serial = String(serial);
+
+		// hands of our old device are gone, and so is the transform we found for it
+		state.transforms_version = device_transforms_version - 1;
+		last_frame_ids[p_stream] = 0;
+		last_process_frame_ids[p_stream] = 0;
+		hand_merger.forget_device(p_stream);
+	}
+
+	if (state.transforms_version != device_transforms_version) {
+		state.transforms_version = device_transforms_version;
+
+		Transform transform = get_device_transform(state.serial);
+		Quat rotation = transform.basis.orthonormalized();
+		state.transform.rotation.x = rotation.x;
+		state.transform.rotation.y = rotation.y;
+		state.transform.rotation.z = rotation.z;
+		state.transform.rotation.w = rotation.w;
+
+		// our hands are still in mm when we merge them
+		state.transform.origin.x = transform.origin.x * 1000.0f;
+		state.transform.origin.y = transform.origin.y * 1000.0f;
+		state.transform.origin.z = transform.origin.z * 1000.0f;
+		state.transform.is_identity = transform == Transform();
+	}
+}
+
+bool GDLMSensor::start_recording(String p_path) {
+	String path = ProjectSettings::get_singleton()->globalize_path(p_path);
+	return recorder.start(path.utf8().get_data());
+}
+
+void GDLMSensor::stop_recording() {
+	recorder.stop();
+}
+
+bool GDLMSensor::get_is_recording() const {
+	return recorder.is_recording();
+}
+
+bool GDLMSensor::play_recording(String p_path, bool p_realtime) {
+	stop_playback();
+
+	String path = ProjectSettings::get_singleton()->globalize_path(p_path);
+	if (!recording.open(path.utf8().get_data())) {
+		return false;
+	}
+
+	replay_realtime = p_realtime;
+	{
+		// wait for any tracking event our frame source is pushing, after this it'll see we're playing
+		std::lock_guard<std::mutex> guard(push_mutex);
+		is_playing.store(true);
+	}
+	replay_thread = new std::thread(GDLMSensor::replay_main, this);
+
+	return true;
+}
+
+void GDLMSensor::stop_playback() {
+	if (replay_thread != NULL) {
+		// this will exit our loop if it is still running
+		is_playing.store(false);
+
+		replay_thread->join();
+		delete replay_thread;
+		replay_thread = NULL;
+	}
+
+	recording.close();
+}
+
+bool GDLMSensor::get_is_playing() const {
+	return is_playing.load();
+}
+
+static void add_sample_stats(Dictionary &r_stats, const char *p_name, const char *p_unit, const GDLMSampleWindow &p_window) {
+	gdlm_sample_stats stats;
+	if (!p_window.get_stats(&stats)) {
+		memset(&stats, 0, sizeof(stats));
+	}
+
+	String name = p_name;
+	String unit = p_unit;
+	r_stats[name + "_mean_" + unit] = stats.mean;
+	r_stats[name + "_p50_" + unit] = stats.p50;
+	r_stats[name + "_p99_" + unit] = stats.p99;
+	r_stats[name + "_max_" + unit] = stats.max;
+}
+
+Dictionary GDLMSensor::get_stats() const {
+	Dictionary stats;
+
+	// Latencies are measured from the timestamp of our tracking event, interpolated frames in ARVR mode
+	// are timestamped for when our HMD pose applies so their latencies can be negative.
+	add_sample_stats(stats, "receive_latency", "usec", telemetry.get_receive_latency());
+	add_sample_stats(stats, "pickup_latency", "usec", telemetry.get_pickup_latency());
+	add_sample_stats(stats, "apply_latency", "usec", telemetry.get_apply_latency());
+
+	// how far our predicted palms ended up from where our palms really were
+	add_sample_stats(stats, "prediction_error", "um", telemetry.get_prediction_error());
+
+	stats["tracking_framerate"] = telemetry.get_framerate();
+	stats["frames_received"] = (int64_t)telemetry.get_frames_received();
+	stats["frames_dropped"] = (int64_t)telemetry.get_frames_dropped();
+	stats["frames_processed"] = (int64_t)telemetry.get_frames_processed();
+	stats["frames_skipped"] = (int64_t)telemetry.get_frames_skipped();
+
+	int devices = 0;
+	for (int d = 0; d < GDLM_MAX_DEVICES; d++) {
+		if (device_streams[d].is_attached()) {
+			devices++;
+		}
+	}
+	stats["devices"] = devices;
+	stats["images_received"] = (int64_t)image_stream.get_received();
+	stats["images_dropped"] = (int64_t)image_stream.get_dropped();
+
+	// how well we can convert Godots clock to that of our frame source
+	gdlm_clock_stats clock_stats;
+	if (frame_source == NULL || !frame_source->get_clock_stats(&clock_stats)) {
+		memset(&clock_stats, 0, sizeof(clock_stats));
+	}
+	stats["clock_samples"] = clock_stats.samples;
+	stats["clock_offset_usec"] = clock_stats.offset;
+	stats["clock_drift_ppm"] = clock_stats.drift_ppm;
+	stats["clock_godot_drift_ppm"] = clock_stats.godot_drift_ppm;
+	stats["clock_jitter_usec"] = clock_stats.jitter;
+	stats["clock_error_usec"] = clock_stats.error;
+
+	return stats;
+}
+
+void GDLMSensor::reset_stats() {
+	telemetry.reset();
+	image_stream.reset_stats();
+}
+
+String GDLMSensor::get_left_hand_scene() const {
+	return hand_scene_names[0];
+}
+
+void GDLMSensor::set_left_hand_scene(String p_resource) {
+	if (hand_scene_names[0] != p_resource) {
+		hand_scene_names[0] = p_resource;
+
+		// maybe delay loading until we need it?
+		hand_scenes[0] = ResourceLoader::get_singleton()->load(p_resource);
+
+		// hands we're still tracking keep their old scene, but our pool needs to be refilled with our new one
+		hand_scene_versions[0]++;
+		bind_hand_scene(0);
+		clear_hand_pool(0);
+		fill_hand_pool(0);
+	}
+}
+
+String GDLMSensor::get_right_hand_scene() const {
+	return hand_scene_names[1];
+}
+
+void GDLMSensor::set_right_hand_scene(String p_resource) {
+	if (hand_scene_names[1] != p_resource) {
+		hand_scene_names[1] = p_resource;
+
+		// maybe delay loading until we need it?
+		hand_scenes[1] = ResourceLoader::get_singleton()->load(p_resource);
+
+		// hands we're still tracking keep their old scene, but our pool needs to be refilled with our new one
+		hand_scene_versions[1]++;
+		bind_hand_scene(1);
+		clear_hand_pool(1);
+		fill_hand_pool(1);
+	}
+}
+
+const char *const GDLMSensor::finger[] = {
+	"Thumb", "Index", "Middle", "Ring", "Pink"
+};
+
+String GDLMSensor::get_finger_name(int p_idx) {
+	String finger_name;
+
+	if (p_idx > 0 && p_idx <= 5) {
+		finger_name = finger[p_idx - 1];
+	}
+
+	return finger_name;
+}
+
+const char *const GDLMSensor::finger_bone[] = {
+	"Metacarpal", "Proximal", "Intermediate", "Distal"
+};
+
+String GDLMSensor::get_finger_bone_name(int p_idx) {
+	String finger_bone_name;
+
+	if (p_idx > 0 && p_idx <= 5) {
+		finger_bone_name = finger_bone[p_idx - 1];
+	}
+
+	return finger_bone_name;
+}
+
+void GDLMSensor::emit_gesture_signals(GDLMSensor::hand_data *p_hand_data, uint32_t p_changed) {
+	// only called when something changed, so building our arguments here is fine
+	if (p_changed & GDLMHandGestures::PINCH_CHANGED) {
+		bool is_pinched = p_hand_data->gestures.get_is_pinched();
+		Array args;
+		args.push_back(Variant(p_hand_data->scene));
+		args.push_back(Variant(is_pinched));
+		emit_signal("pinched", args);
+
+		// older scenes connect to the signal on our hand scene, so we keep it up to date as well
+		if (p_hand_data->has_gesture_signals) {
+			p_hand_data->scene->set("is_pinched", is_pinched);
+			p_hand_data->scene->emit_signal("pinched", args);
+		}
+	}
+	if (p_changed & GDLMHandGestures::GRAB_CHANGED) {
+		bool is_grabbed = p_hand_data->gestures.get_is_grabbed();
+		Array args;
+		args.push_back(Variant(p_hand_data->scene));
+		args.push_back(Variant(is_grabbed));
+		emit_signal("grabbed", args);
+
+		if (p_hand_data->has_gesture_signals) {
+			p_hand_data->scene->set("is_grabbed", is_grabbed);
+			p_hand_data->scene->emit_signal("grabbed", args);
+		}
+	}
+}
+
+void GDLMSensor::update_hand_data(GDLMSensor::hand_data *p_hand_data, LEAP_HAND *p_leap_hand, int64_t p_timestamp) {
+	if (p_hand_data == NULL)
+		return;
+
+	if (p_hand_data->scene == NULL)
+		return;
+
+	// our gestures only tell anyone when they change
+	uint32_t changed = p_hand_data->gestures.update(p_leap_hand, gesture_params);
+	if (changed != 0) {
+		emit_gesture_signals(p_hand_data, changed);
+	}
+
+	// and if asked we report our values, but no more often than our rate
+	if (hand_state_rate > 0.0 && (p_hand_data->last_state_signal == 0 || p_timestamp - p_hand_data->last_state_signal >= (int64_t)(1000000.0 / hand_state_rate))) {
+		p_hand_data->last_state_signal = p_timestamp;
+		hand_state_signal_args[0] = Variant(p_hand_data->scene);
+		hand_state_signal_args[1] = Variant(p_leap_hand->pinch_distance);
+		hand_state_signal_args[2] = Variant(p_leap_hand->pinch_strength);
+		hand_state_signal_args[3] = Variant(p_leap_hand->grab_strength);
+		emit_signal(hand_state_signal, hand_state_signal_args);
+	}
+
+	if (!push_hand_data) {
+		// our scene doesn't need our values
+		return;
+	}
+
+	// if nothing changed enough since we last pushed our data, we don't bother our scene,
+	// our pinch distance is in mm while our strengths go from 0.0 to 1.0 so each has its own epsilon
+	if (p_hand_data->has_pushed_data && hand_data_epsilon > 0.0) {
+		if (fabs(p_leap_hand->pinch_distance - p_hand_data->pinch_distance) < pinch_distance_epsilon_mm &&
+				fabs(p_leap_hand->pinch_strength - p_hand_data->pinch_strength) < hand_data_epsilon &&
+				fabs(p_leap_hand->grab_strength - p_hand_data->grab_strength) < hand_data_epsilon) {
+			return;
+		}
+	}
+
+	p_hand_data->has_pushed_data = true;
+	p_hand_data->pinch_distance = p_leap_hand->pinch_distance;
+	p_hand_data->pinch_strength = p_leap_hand->pinch_strength;
+	p_hand_data->grab_strength = p_leap_hand->grab_strength;
+
+	if (p_hand_data->has_hand_state) {
+		// push everything in one go, our arguments array is reused so this doesn't allocate
+		hand_state_args[0] = Variant(p_leap_hand->pinch_distance);
+		hand_state_args[1] = Variant(p_leap_hand->pinch_strength);
+		hand_state_args[2] = Variant(p_leap_hand->grab_strength);
+		p_hand_data->scene->call(set_hand_state_method, hand_state_args);
+	} else {
+		// older scenes only implement the individual setters
+		Array args;
+
+		// first pinch distance
+		args.push_back(Variant(p_leap_hand->pinch_distance));
+		p_hand_data->scene->call("set_pinch_distance", args);
+
+		// then pinch strength
+		args.clear();
+		args.push_back(Variant(p_leap_hand->pinch_strength));
+		p_hand_data->scene->call("set_pinch_strength", args);
+
+		// and grab strength
+		args.clear();
+		args.push_back(Variant(p_leap_hand->grab_strength));
+		p_hand_data->scene->call("set_grab_strength", args);
+	}
+};
+
+static inline Transform to_transform(const gdlm_bone_frame &p_frame) {
+	return Transform(
+			p_frame.basis[0][0], p_frame.basis[0][1], p_frame.basis[0][2],
+			p_frame.basis[1][0], p_frame.basis[1][1], p_frame.basis[1][2],
+			p_frame.basis[2][0], p_frame.basis[2][1], p_frame.basis[2][2],
+			p_frame.origin[0], p_frame.origin[1], p_frame.origin[2]);
+}
+
+void GDLMSensor::update_hand_position(GDLMSensor::hand_data *p_hand_data, LEAP_HAND *p_leap_hand, int64_t p_timestamp) {
+	Transform hand_transform;
+
+	if (p_hand_data == NULL)
+		return;
+
+	if (p_hand_data->scene == NULL)
+		return;
+
+	// smooth out our joints, we filter into our own copy as our frame may be applied more than once
+	const gdlm_filter_params &params = has_hand_filter_params[p_hand_data->type] ? hand_filter_params[p_hand_data->type] : filter_params;
+	bool is_filtered = params.min_cutoff > 0.0;
+	if (is_filtered) {
+		p_hand_data->filter.filter(p_leap_hand, p_timestamp, params, &filtered_hand);
+		p_leap_hand = &filtered_hand;
+	}
+
+	// orientation of our hand using LeapC quarternion
+	Quat quat(p_leap_hand->palm.orientation.x, p_leap_hand->palm.orientation.y, p_leap_hand->palm.orientation.z, p_leap_hand->palm.orientation.w);
+	Basis base_orientation(quat);
+
+	// apply to our transform
+	hand_transform.set_basis(base_orientation);
+
+	// position of our hand
+	Vector3 hand_position(
+			p_leap_hand->palm.position.x * world_scale,
+			p_leap_hand->palm.position.y * world_scale,
+			p_leap_hand->palm.position.z * world_scale);
+	hand_transform.set_origin(hand_position);
+
+	// get our inverse for positioning the rest of the hand
+	Transform hand_inverse = hand_transform.inverse();
+
+	// if in ARVR mode we should xform this to convert from HMD relative position to Origin world position
+	if (arvr) {
+		Transform last_transform = p_hand_data->scene->get_transform();
+		hand_transform = hmd_transform * hmd_to_leap_motion * hand_transform;
+
+		// leap motions frame interpolation is pretty good but we're going to smooth things out a little bit
+		// to stop hands from visible drifting when the user turns his/her head. We can live with the position
+		// of the hand being a few frames behind. Our filter does a better job at this so this is only a fallback.
+		if (!is_filtered) {
+			hand_transform.origin = last_transform.origin.linear_interpolate(hand_transform.origin, smooth_factor);
+		}
+	};
+
+	// and apply
+	p_hand_data->scene->set_transform(hand_transform);
+
+	// our joints are placed relative to our palm
+	gdlm_bone_frame hand_inverse_frame;
+	for (int r = 0; r < 3; r++) {
+		for (int c = 0; c < 3; c++) {
+			hand_inverse_frame.basis[r][c] = hand_inverse.basis.elements[r][c];
+		}
+		hand_inverse_frame.origin[r] = hand_inverse.origin[r];
+	}
+
+	// solve the local frames of all our bones in one go
+	if (use_bone_rotations) {
+		// LeapC already gives us the rotation of each bone, we just need to make them relative to their parent
+		gdlm_solve_hand_rotations(p_leap_hand, world_scale, &hand_frames);
+	} else {
+		// we derive our rotations from our joint positions
+		gdlm_solve_hand(p_leap_hand, world_scale, hand_inverse_frame, &hand_frames);
+	}
+
+	// and apply them to our digits
+	float bone_tolerance = GDLM_BONE_LENGTH_TOLERANCE_MM * world_scale;
+	for (int d = 0; d < 5; d++) {
+		// For now assume order, we may change this to naming.
+		// If our scene is skeleton based we pose bones instead, these are laid out exactly like our nodes.
+		Skeleton *skeleton = p_hand_data->skeleton;
+		Spatial *digit_node = skeleton == NULL ? p_hand_data->finger_nodes[d] : NULL;
+		int digit_bone = skeleton == NULL ? -1 : p_hand_data->finger_bones[d];
+		const Transform *rest_inverse = &p_hand_data->finger_rest_inverse[d];
+
+		// we skip the first bone for our thumb, so it has one frame less
+		int first_bone = d == 0 ? 1 : 0;
+		for (int f = 0; f < 5 - first_bone && (digit_node != NULL || digit_bone != -1); f++) {
+			Transform bone_pose = to_transform(hand_frames.frames[d][f]);
+
+			if (digit_node != NULL) {
+				digit_node->set_transform(bone_pose);
+
+				// Our bone mesh leads up to our digit node and is scaled along y to span our bone.
+				// Bone lengths barely change once tracking settles so we rarely need to touch these.
+				int bone = f - 1 + first_bone;
+				Spatial *bone_node = f > 0 ? p_hand_data->bone_nodes[d][bone] : NULL;
+				if (bone_node != NULL) {
+					float length = bone_pose.origin.length();
+					if (fabs(length - p_hand_data->bone_lengths[d][bone]) > bone_tolerance) {
+						bone_node->set_scale(Vector3(1.0, length, 1.0));
+						bone_node->set_translation(Vector3(0.0, 0.0, length / 2.0));
+						p_hand_data->bone_lengths[d][bone] = length;
+					}
+				}
+			} else {
+				// our bone pose is applied on top of our rest pose, this doesn't notify anything
+				skeleton->set_bone_pose(digit_bone, *rest_inverse * bone_pose);
+			}
+
+			// our next frame is for the digit node following this one
+			if (f + first_bone < 4) {
+				if (skeleton == NULL) {
+					digit_node = p_hand_data->digit_nodes[d][f + first_bone];
+				} else {
+					digit_bone = p_hand_data->digit_bones[d][f + first_bone];
+					rest_inverse = &p_hand_data->digit_rest_inverse[d][f + first_bone];
+				}
+			}
+		}
+	}
+
+	// in split mode our collisions follow our physics tick like the rest of our physics
+	if (p_hand_data->proxy_body.is_valid() && (update_mode != UPDATE_SPLIT || Engine::get_singleton()->is_in_physics_frame())) {
+		update_proxies(p_hand_data, p_leap_hand, hand_inverse_frame);
+	}
+
+	// do we want to do something with the arm?
+}
+
+void GDLMSensor::update_proxies(GDLMSensor::hand_data *p_hand_data, const LEAP_HAND *p_leap_hand, const gdlm_bone_frame &p_hand_inverse) {
+	PhysicsServer *physics_server = PhysicsServer::get_singleton();
+
+	gdlm_solve_proxies(p_leap_hand, world_scale, p_hand_inverse, &hand_proxies);
+
+	// our shapes only move relative to our body, unless our hand changed size
+	float tolerance = GDLM_PROXY_TOLERANCE_MM * world_scale;
+	for (int p = 0; p < GDLM_HAND_PROXIES; p++) {
+		const gdlm_proxy &proxy = hand_proxies.proxies[p];
+		if (gdlm_proxy_resized(proxy, p_hand_data->proxy_sizes[p], tolerance)) {
+			if (p == 0) {
+				physics_server->shape_set_data(p_hand_data->proxy_shapes[p], Vector3(proxy.size[0], proxy.size[1], proxy.size[2]));
+			} else {
+				Dictionary capsule;
+				capsule["radius"] = proxy.size[0];
+				capsule["height"] = proxy.size[1];
+				physics_server->shape_set_data(p_hand_data->proxy_shapes[p], capsule);
+			}
+
+			for (int i = 0; i < 3; i++) {
+				p_hand_data->proxy_sizes[p][i] = proxy.size[i];
+			}
+		}
+
+		physics_server->body_set_shape_transform(p_hand_data->proxy_body, p, to_transform(proxy.frame));
+	}
+
+	// our body follows our hand scene, including whatever its parents do
+	physics_server->body_set_state(p_hand_data->proxy_body, PhysicsServer::BODY_STATE_TRANSFORM, p_hand_data->scene->get_global_transform());
+
+	// only now that our shapes are in place do we start colliding
+	if (!p_hand_data->proxy_in_space) {
+		Ref<World> world = get_world();
+		if (world.is_valid()) {
+			physics_server->body_set_space(p_hand_data->proxy_body, world->get_space());
+			p_hand_data->proxy_in_space = true;
+		}
+	}
+}
+
+GDLMSensor::hand_data *GDLMSensor::find_hand_by_id(int p_type, uint32_t p_leap_id) {
+	int slot = hand_slots.find(p_type, p_leap_id);
+
+	return slot == -1 ? NULL : &hands[p_type][slot];
+}
+
+GDLMSensor::hand_data *GDLMSensor::find_unused_hand(int p_type) {
+	// only hands we lost tracking of before this frame qualify
+	int slot = hand_slots.find_lost(p_type);
+
+	return slot == -1 ? NULL : &hands[p_type][slot];
+}
+
+int GDLMSensor::count_hands(int p_type, bool p_active_only) const {
+	return p_active_only ? GDLMHandSlots::count_slots(hand_slots.get_active_mask(p_type)) : hand_slots.get_used_count(p_type);
+}
+
+GDLMSensor::hand_data *GDLMSensor::instance_hand(int p_type) {
+	const hand_binding &binding = hand_bindings[p_type];
+	if (!binding.is_valid) {
+		return NULL;
+	}
+
+	int slot = hand_slots.acquire(p_type);
+	if (slot == -1) {
+		// we're tracking as many hands as we can handle
+		return NULL;
+	}
+
+	hand_data *new_hand_data = &hands[p_type][slot];
+
+	new_hand_data->type = p_type;
+	new_hand_data->slot = slot;
+	new_hand_data->leap_id = 0;
+	new_hand_data->unused_frames = 0;
+	new_hand_data->has_pushed_data = false;
+	new_hand_data->scene_version = hand_scene_versions[p_type];
+
+	// our scene starts hidden until we start tracking a hand with it
+	new_hand_data->scene = (Spatial *)hand_scenes[p_type]->instance(); // is it safe to cast like this?
+	new_hand_data->scene->hide();
+	add_child(new_hand_data->scene, false);
+
+	new_hand_data->proxy_in_space = false;
+	if (collision_proxies) {
+		create_proxies(new_hand_data);
+	}
+
+	// our binding was resolved when our scene was loaded, so we just need to look up our nodes by path
+	new_hand_data->has_hand_state = binding.has_hand_state;
+	new_hand_data->has_gesture_signals = binding.has_gesture_signals;
+	new_hand_data->skeleton = binding.has_skeleton ? (Skeleton *)new_hand_data->scene->get_node(binding.skeleton_path) : NULL;
+
+	for (int d = 0; d < 5; d++) {
+		new_hand_data->finger_nodes[d] = binding.finger_paths[d].is_empty() ? NULL : (Spatial *)new_hand_data->scene->get_node(binding.finger_paths[d]);
+		new_hand_data->finger_bones[d] = binding.finger_bones[d];
+		new_hand_data->finger_rest_inverse[d] = binding.finger_rest_inverse[d];
+
+		for (int b = 0; b < 4; b++) {
+			new_hand_data->digit_nodes[d][b] = binding.digit_paths[d][b].is_empty() ? NULL : (Spatial *)new_hand_data->scene->get_node(binding.digit_paths[d][b]);
+			new_hand_data->bone_nodes[d][b] = binding.bone_paths[d][b].is_empty() ? NULL : (Spatial *)new_hand_data->scene->get_node(binding.bone_paths[d][b]);
+			new_hand_data->bone_lengths[d][b] = -1.0f;
+			new_hand_data->digit_bones[d][b] = binding.digit_bones[d][b];
+			new_hand_data->digit_rest_inverse[d][b] = binding.digit_rest_inverse[d][b];
+		}
+	}
+
+	return new_hand_data;
+}
+
+void GDLMSensor::free_hand(GDLMSensor::hand_data *p_hand_data) {
+	free_proxies(p_hand_data);
+
+	// this should free everything up and invalidate it, no need to do anything more...
+	if (p_hand_data->scene != NULL) {
+		// hide and then queue free, this will properly destruct our scene and remove it from our tree
+		p_hand_data->scene->hide();
+		p_hand_data->scene->queue_free();
+		p_hand_data->scene = NULL;
+	}
+
+	hand_slots.release(p_hand_data->type, p_hand_data->slot);
+}
+
+void GDLMSensor::fill_hand_pool(int p_type) {
+	// we don't keep a pool if we don't instance hands
+	int pool_size = instance_hands ? hand_pool_size : 0;
+	while (hand_slots.get_pooled_count(p_type) < pool_size) {
+		hand_data *hd = instance_hand(p_type);
+		if (hd == NULL) {
+			return;
+		}
+
+		hd->scene->set_name(String("Hand ") + String(p_type) + String(" pool ") + String::num_int64(hd->slot));
+		hand_slots.add_to_pool(p_type, hd->slot);
+	}
+
+	// if our pool got smaller, get rid of what we no longer need
+	while (hand_slots.get_pooled_count(p_type) > pool_size) {
+		free_hand(&hands[p_type][hand_slots.take_from_pool(p_type)]);
+	}
+}
+
+void GDLMSensor::clear_hand_pool(int p_type) {
+	int slot;
+	while ((slot = hand_slots.take_from_pool(p_type)) != -1) {
+		free_hand(&hands[p_type][slot]);
+	}
+}
+
+GDLMSensor::hand_data *GDLMSensor::new_hand(int p_type, uint32_t p_leap_id) {
+	hand_data *new_hand_data;
+
+	// take a hand from our pool if we can, this saves us instancing a scene on our physics thread
+	int slot = hand_slots.take_from_pool(p_type);
+	if (slot != -1) {
+		new_hand_data = &hands[p_type][slot];
+		pool_hits++;
+	} else {
+		new_hand_data = instance_hand(p_type);
+		if (new_hand_data == NULL) {
+			return NULL;
+		}
+		pool_misses++;
+	}
+
+	hand_slots.bind(p_type, new_hand_data->slot, p_leap_id);
+	hand_slots.mark_active(p_type, new_hand_data->slot);
+	new_hand_data->leap_id = p_leap_id;
+	new_hand_data->unused_frames = 0;
+	new_hand_data->has_pushed_data = false;
+	new_hand_data->filter.reset();
+	new_hand_data->gestures.reset();
+	new_hand_data->last_state_signal = 0;
+
+	new_hand_data->scene->set_name(String("Hand ") + String(p_type) + String(" ") + String(p_leap_id));
+	new_hand_data->scene->show();
+
+	Array args;
+	args.push_back(Variant(new_hand_data->scene));
+	emit_signal("new_hand", args);
+
+	return new_hand_data;
+}
+
+void GDLMSensor::delete_hand(GDLMSensor::hand_data *p_hand_data) {
+	if (p_hand_data->scene != NULL) {
+		// a hand that goes away lets go of whatever it was holding
+		uint32_t changed = p_hand_data->gestures.release();
+		if (changed != 0) {
+			emit_gesture_signals(p_hand_data, changed);
+		}
+
 		Array args;
 		args.push_back(Variant(p_hand_data->scene));
 		emit_signal("about_to_remove_hand", args);
+	}
 
-		// hide and then queue free, this will properly destruct our scene and remove it from our tree
+	// return our hand to our pool if there is room and our scene hasn't been changed in the meantime
+	int type = p_hand_data->type;
+	hand_slots.unbind(type, p_hand_data->slot);
+	if (p_hand_data->scene != NULL && p_hand_data->scene_version == hand_scene_versions[type] && hand_slots.get_pooled_count(type) < hand_pool_size) {
 		p_hand_data->scene->hide();
-		p_hand_data->scene->queue_free();
+		remove_proxies(p_hand_data);
+		hand_slots.add_to_pool(type, p_hand_data->slot);
+	} else {
+		free_hand(p_hand_data);
+	}
+}
+
+// our ARVR server wants modifiable names
+static char left_tracker_name[] = "Leap Motion Left Hand";
+static char right_tracker_name[] = "Leap Motion Right Hand";
+
+void GDLMSensor::update_trackers(const LEAP_TRACKING_EVENT *p_frame) {
+	if (arvr_api == NULL) {
+		return;
 	}
 
-	::free(p_hand_data);
+	gdlm_filter_params params[2];
+	for (int t = 0; t < 2; t++) {
+		params[t] = has_hand_filter_params[t] ? hand_filter_params[t] : filter_params;
+	}
+
+	uint32_t changes[2];
+	hand_trackers.update(p_frame, params, gesture_params, keep_hands_for_frames < 0 ? 0 : keep_hands_for_frames, keep_last_hand, changes);
+	apply_tracker_changes(changes);
 }
 
-// our Godot physics process, runs within the physic thread and is responsible for updating physics related stuff
-void GDLMSensor::_physics_process(float delta) {
-	LEAP_TRACKING_EVENT *interpolated_frame = NULL;
-	const LEAP_TRACKING_EVENT *frame = NULL;
-	uint64_t arvr_frame_usec;
+void GDLMSensor::update_tracker_positions(const LEAP_TRACKING_EVENT *p_frame) {
+	// only move trackers our physics tick already knows about, new trackers and lost trackers are handled there
+	if (arvr_api == NULL) {
+		return;
+	}
+
+	gdlm_filter_params params[2];
+	for (int t = 0; t < 2; t++) {
+		params[t] = has_hand_filter_params[t] ? hand_filter_params[t] : filter_params;
+	}
+
+	uint32_t changes[2];
+	hand_trackers.refresh(p_frame, params, changes);
+	apply_tracker_changes(changes);
+}
+
+void GDLMSensor::apply_tracker_changes(const uint32_t *p_changes) {
+	if (p_changes[0] == 0 && p_changes[1] == 0) {
+		return;
+	}
+
+	// Our trackers live in the space of our ARVR origin in real world units, our ARVR server applies its world scale.
+	// Outside of ARVR mode our node is our origin.
+	Transform to_origin;
+	if (arvr) {
+		ARVRServer *arvr_server = ARVRServer::get_singleton();
+		to_origin = arvr_server->get_hmd_transform();
+		to_origin.origin /= arvr_server->get_world_scale();
+		to_origin = to_origin * hmd_to_leap_motion;
+	}
+
+	for (int t = 0; t < 2; t++) {
+		if ((p_changes[t] & GDLMHandTrackers::TRACKER_ADDED) != 0) {
+			tracker_ids[t] = arvr_api->godot_arvr_add_controller(
+					t == 0 ? left_tracker_name : right_tracker_name,
+					t == 0 ? ARVRPositionalTracker::TRACKER_LEFT_HAND : ARVRPositionalTracker::TRACKER_RIGHT_HAND,
+					true, true);
+		}
+		if (tracker_ids[t] == 0) {
+			continue;
+		}
+
+		// our pose and our pinch and grab strength as analog trigger and grip, like a controller would
+		const gdlm_hand_tracker &tracker = hand_trackers.get_tracker(t);
+		if ((p_changes[t] & GDLMHandTrackers::TRACKER_UPDATED) != 0) {
+			Transform pose = to_origin * to_transform(tracker.pose);
+			arvr_api->godot_arvr_set_controller_transform(tracker_ids[t], (godot_transform *)&pose, true, true);
+			arvr_api->godot_arvr_set_controller_axis(tracker_ids[t], GlobalConstants::JOY_VR_ANALOG_TRIGGER, tracker.hand.pinch_strength, false);
+			arvr_api->godot_arvr_set_controller_axis(tracker_ids[t], GlobalConstants::JOY_VR_ANALOG_GRIP, tracker.hand.grab_strength, false);
+		}
+
+		// and our pinch and grab as trigger and grip buttons
+		if ((p_changes[t] & GDLMHandGestures::PINCH_CHANGED) != 0) {
+			arvr_api->godot_arvr_set_controller_button(tracker_ids[t], GlobalConstants::JOY_VR_TRIGGER, tracker.gestures.get_is_pinched());
+		}
+		if ((p_changes[t] & GDLMHandGestures::GRAB_CHANGED) != 0) {
+			arvr_api->godot_arvr_set_controller_button(tracker_ids[t], GlobalConstants::JOY_VR_GRIP, tracker.gestures.get_is_grabbed());
+		}
+
+		if ((p_changes[t] & GDLMHandTrackers::TRACKER_REMOVED) != 0) {
+			arvr_api->godot_arvr_remove_controller(tracker_ids[t]);
+			tracker_ids[t] = 0;
+		}
+	}
+}
+
+void GDLMSensor::remove_trackers() {
+	for (int t = 0; t < 2; t++) {
+		if (tracker_ids[t] != 0 && arvr_api != NULL) {
+			arvr_api->godot_arvr_remove_controller(tracker_ids[t]);
+		}
+		tracker_ids[t] = 0;
+	}
+
+	// we start over with new trackers
+	hand_trackers.reset();
+}
+
+void GDLMSensor::create_proxies(GDLMSensor::hand_data *p_hand_data) {
+	if (p_hand_data->proxy_body.is_valid()) {
+		return;
+	}
+
+	// One kinematic body per hand with a shape for each proxy, our body is only added to our space once our shapes
+	// are placed. Collisions report our hand scene as the object we collided with.
+	PhysicsServer *physics_server = PhysicsServer::get_singleton();
+	p_hand_data->proxy_body = physics_server->body_create(PhysicsServer::BODY_MODE_KINEMATIC);
+	physics_server->body_set_collision_layer(p_hand_data->proxy_body, collision_layer);
+	physics_server->body_set_collision_mask(p_hand_data->proxy_body, collision_mask);
+	physics_server->body_attach_object_instance_id(p_hand_data->proxy_body, p_hand_data->scene->get_instance_id());
+
+	for (int p = 0; p < GDLM_HAND_PROXIES; p++) {
+		p_hand_data->proxy_shapes[p] = physics_server->shape_create(p == 0 ? PhysicsServer::SHAPE_BOX : PhysicsServer::SHAPE_CAPSULE);
+		physics_server->body_add_shape(p_hand_data->proxy_body, p_hand_data->proxy_shapes[p]);
+
+		// make sure we size our shape on our first update
+		for (int i = 0; i < 3; i++) {
+			p_hand_data->proxy_sizes[p][i] = -1.0f;
+		}
+	}
+
+	p_hand_data->proxy_in_space = false;
+}
+
+void GDLMSensor::free_proxies(GDLMSensor::hand_data *p_hand_data) {
+	if (!p_hand_data->proxy_body.is_valid()) {
+		return;
+	}
+
+	// freeing our body also removes it from our space
+	PhysicsServer *physics_server = PhysicsServer::get_singleton();
+	physics_server->free_rid(p_hand_data->proxy_body);
+	p_hand_data->proxy_body = RID();
+	for (int p = 0; p < GDLM_HAND_PROXIES; p++) {
+		physics_server->free_rid(p_hand_data->proxy_shapes[p]);
+		p_hand_data->proxy_shapes[p] = RID();
+	}
+
+	p_hand_data->proxy_in_space = false;
+}
+
+void GDLMSensor::remove_proxies(GDLMSensor::hand_data *p_hand_data) {
+	// hidden hands shouldn't push things around, we're added again on our next update
+	if (p_hand_data->proxy_in_space) {
+		PhysicsServer::get_singleton()->body_set_space(p_hand_data->proxy_body, RID());
+		p_hand_data->proxy_in_space = false;
+	}
+}
+
+Skeleton *GDLMSensor::find_skeleton(Spatial *p_scene) {
+	// our scene can be a skeleton itself
+	Skeleton *skeleton = Object::cast_to<Skeleton>(p_scene);
+	if (skeleton != NULL) {
+		return skeleton;
+	}
+
+	// or have one as a direct child, skinned meshes are often imported like this
+	for (int i = 0; i < p_scene->get_child_count(); i++) {
+		skeleton = Object::cast_to<Skeleton>(p_scene->get_child(i));
+		if (skeleton != NULL) {
+			return skeleton;
+		}
+	}
+
+	return NULL;
+}
+
+void GDLMSensor::bind_hand_scene(int p_type) {
+	hand_binding &binding = hand_bindings[p_type];
+
+	// clear our binding
+	binding.is_valid = false;
+	binding.has_hand_state = false;
+	binding.has_gesture_signals = false;
+	binding.has_skeleton = false;
+	binding.skeleton_path = NodePath();
+	for (int d = 0; d < 5; d++) {
+		binding.finger_paths[d] = NodePath();
+		binding.finger_bones[d] = -1;
+		binding.finger_rest_inverse[d] = Transform();
+		for (int b = 0; b < 4; b++) {
+			binding.digit_paths[d][b] = NodePath();
+			binding.bone_paths[d][b] = NodePath();
+			binding.digit_bones[d][b] = -1;
+			binding.digit_rest_inverse[d][b] = Transform();
+		}
+	}
+
+	if (hand_scenes[p_type].is_null()) {
+		return;
+	} else if (!hand_scenes[p_type]->can_instance()) {
+		return;
+	}
+
+	// we instance our scene once to find out where everything is, every instance after that is identical
+	Spatial *scene = (Spatial *)hand_scenes[p_type]->instance();
+	binding.is_valid = true;
+
+	// check once if we can push our hand data in one call
+	binding.has_hand_state = scene->has_method(set_hand_state_method);
+
+	// and if it still has the pinched and grabbed signals our hand scenes used to emit themselves
+	Ref<Script> script = scene->get_script();
+	binding.has_gesture_signals = script.is_valid() && script->has_script_signal("pinched") && script->has_script_signal("grabbed");
+
+	// check if our scene is skeleton based, if so we look up our bones instead of our nodes
+	Skeleton *skeleton = find_skeleton(scene);
+	if (skeleton != NULL) {
+		binding.has_skeleton = true;
+		binding.skeleton_path = scene->get_path_to(skeleton);
+	}
+
+	// our bones and nodes are named and parented the same way
+	for (int d = 0; d < 5; d++) {
+		String name = finger[d];
+		Spatial *node = NULL;
+		int bone = -1;
+
+		if (skeleton != NULL) {
+			bone = skeleton->find_bone(name);
+		} else {
+			node = (Spatial *)scene->find_node(name, false);
+		}
+		if (node == NULL && bone == -1) {
+			Godot::print_warning(String("Couldn't find ") + String(skeleton == NULL ? "node " : "bone ") + name + String(" in ") + hand_scene_names[p_type], __FUNCTION__, __FILE__, __LINE__);
+			continue;
+		}
+
+		if (skeleton != NULL) {
+			binding.finger_bones[d] = bone;
+			binding.finger_rest_inverse[d] = skeleton->get_bone_rest(bone).affine_inverse();
+		} else {
+			binding.finger_paths[d] = scene->get_path_to(node);
+		}
+
+		// we're one digit short on our thumb...
+		int first_bone = d == 0 ? 1 : 0;
+		for (int b = first_bone; b < 4; b++) {
+			name = String(finger[d]) + String("_") + String(finger_bone[b]);
+
+			if (skeleton != NULL) {
+				bone = skeleton->find_bone(name);
+			} else {
+				node = (Spatial *)node->find_node(name, false);
+			}
+			if (node == NULL && bone == -1) {
+				Godot::print_warning(String("Couldn't find ") + String(skeleton == NULL ? "node " : "bone ") + name + String(" in ") + hand_scene_names[p_type], __FUNCTION__, __FILE__, __LINE__);
+
+				// no point in looking for the rest of this finger
+				break;
+			}
+
+			if (skeleton != NULL) {
+				binding.digit_bones[d][b] = bone;
+				binding.digit_rest_inverse[d][b] = skeleton->get_bone_rest(bone).affine_inverse();
+			} else {
+				binding.digit_paths[d][b] = scene->get_path_to(node);
+
+				// bone meshes are optional, they sit next to the node they lead up to
+				Node *bone_node = node->get_parent()->find_node(name + String("_Bone"), false);
+				if (bone_node != NULL && Object::cast_to<Spatial>(bone_node) != NULL) {
+					binding.bone_paths[d][b] = scene->get_path_to(bone_node);
+				}
+			}
+		}
+	}
+
+	// we no longer need our scene, it was never added to our tree
+	scene->queue_free();
+}
+
+// picks the frame we're going to apply, returns NULL if we don't have one or if we already applied it
+const LEAP_TRACKING_EVENT *GDLMSensor::get_frame_to_apply(long long int *p_last_frame_ids, bool p_record_telemetry) {
+	uint64_t arvr_frame_usec = 0;
 
 	// We're getting our measurements in mm, want them in m
 	world_scale = 0.001f;
@@ -639,6 +2014,8 @@ void GDLMSensor::_physics_process(float delta) {
 		// Once we start running rendering in a separate thread last_commit_usec will still be the last frame
 		// but last_process_usec will be newer and get_hmd_transform could be more up to date.
 		// last_frame_usec will be an average.
+		// When called from _process this is as close to rendering as we get, from _physics_process we may be
+		// a few physics ticks ahead of or behind the frame being rendered.
 		// We probably should put this whole thing into a mutex with the render thread once the time is right.
 		// For now however.... :)
 
@@ -649,72 +2026,114 @@ void GDLMSensor::_physics_process(float delta) {
 		arvr_frame_usec = arvr_server->get_last_process_usec() + arvr_server->get_last_frame_usec();
 	}
 
-	// update our timing
-	if (clock_synchronizer != NULL) {
-		uint64_t godot_usec = OS::get_singleton()->get_ticks_msec() * 1000; // why does godot not give us usec while it records it, grmbl...
-		uint64_t leap_usec = LeapGetNow();
-		LeapUpdateRebase(clock_synchronizer, godot_usec, leap_usec);
-	}
-
-	// get our frame, either interpolated or latest
-	if (arvr && clock_synchronizer != NULL && arvr_frame_usec != 0) {
-		// Get our leap motion clock value at the timing on which we expect our hmd_transform to be.
-		// This will never be exact science as we do not know how much of a timewarp Oculus/OpenVR has applied..
-		int64_t leap_target_usec;
-		uint64_t target_frame_size;
-		LeapRebaseClock(clock_synchronizer, arvr_frame_usec, &leap_target_usec);
-
-		// we need to allocate the right amount of memory to store our interpolated frame data at our timestamp
-		eLeapRS result = LeapGetFrameSize(leap_connection, leap_target_usec, &target_frame_size);
-		if (result == eLeapRS_Success) {
-			// get some space
-			interpolated_frame = (LEAP_TRACKING_EVENT *)malloc((size_t)target_frame_size);
-			if (interpolated_frame != NULL) {
-				// and lets get our interpolated frame!!
-				result = LeapInterpolateFrame(leap_connection, leap_target_usec, interpolated_frame, target_frame_size);
-				if (result == eLeapRS_Success) {
-					// copy pointer so we can use the same logic as when we call get_last_frame..
-					frame = interpolated_frame;
-				} else {
-					// this is not good... need to add some error handling here.
+	// Get our leap motion clock value at the timing on which we expect our hmd_transform to be.
+	// This will never be exact science as we do not know how much of a timewarp Oculus/OpenVR has applied..
+	// All our devices share the clock of our frame source so we only need to do this once.
+	int64_t leap_target_usec = 0;
+	bool is_interpolated = false;
+	bool is_predicted = false;
+	if (arvr && frame_source != NULL && arvr_frame_usec != 0 && frame_source->rebase_clock(arvr_frame_usec, &leap_target_usec)) {
+		is_interpolated = true;
+	} else if (!arvr && prediction_ms > 0.0 && frame_source != NULL) {
+		// Outside of ARVR we predict where our hands will be by the time they're displayed.
+		// We're on our frame sources clock already so we don't need to rebase.
+		leap_target_usec = frame_source->get_now() + (int64_t)(prediction_ms * 1000.0);
+		is_predicted = true;
+	}
 
-					// clean up so we exit..
-					::free(interpolated_frame);
-					interpolated_frame = NULL;
-				}
+	// get a frame for each of our devices, either interpolated, predicted or latest
+	// while we're playing back a recording only our first stream is fed
+	bool playing = is_playing.load();
+	const LEAP_TRACKING_EVENT *frames[GDLM_MAX_DEVICES];
+	bool has_frame = false;
+	bool has_new_frame = false;
+	for (int d = 0; d < GDLM_MAX_DEVICES; d++) {
+		frames[d] = NULL;
+		if (playing ? d != 0 : !device_streams[d].is_attached()) {
+			continue;
+		}
+
+		refresh_device(d);
+
+		const LEAP_TRACKING_EVENT *frame = NULL;
+		bool is_new = arvr;
+		if (is_interpolated) {
+			frame = get_interpolated_frame(d, leap_target_usec);
+		} else {
+			if (is_predicted) {
+				// we only check the predictions for one device, that's plenty to tune our prediction
+				frame = get_predicted_frame(d, leap_target_usec, !has_frame);
+				is_new = frame != NULL;
+			}
+
+			if (frame == NULL) {
+				// ok lets process our last frame, this is our own copy so it remains valid during this tick.
+				frame = device_streams[d].read();
 			}
 		}
-	} else {
-		// ok lets process our last frame. Note that leap motion says it caches these so I'm assuming they
-		// are valid for a few frames.
-		frame = get_last_frame();
+
+		if (frame == NULL) {
+			// we don't have a frame for this device yet, or we failed upstairs..
+			continue;
+		}
+
+		// In ARVR or when predicting we may need to do more, else we only need to do this for new frames
+		if (is_new || p_last_frame_ids[d] != frame->info.frame_id) {
+			has_new_frame = true;
+		}
+
+		frames[d] = frame;
+		has_frame = true;
 	}
 
 	// was everything above successful?
-	if (frame == NULL) {
-		// we don't have a frame yet, or we failed upstairs..
-		return;
-	} else if (!arvr && (last_frame_id == frame->info.frame_id)) {
-		// we already parsed this, no need to do this. In ARVR we may need to do more
-		return;
+	if (!has_frame) {
+		// we don't have a frame yet
+		return NULL;
+	} else if (!has_new_frame) {
+		// we already parsed this, no need to do this.
+		if (p_record_telemetry) {
+			telemetry.frame_skipped();
+		}
+		return NULL;
 	}
 
-	last_frame_id = frame->info.frame_id;
+	gdlm_device_transform transforms[GDLM_MAX_DEVICES];
+	for (int d = 0; d < GDLM_MAX_DEVICES; d++) {
+		if (frames[d] != NULL) {
+			p_last_frame_ids[d] = frames[d]->info.frame_id;
+		}
+		transforms[d] = device_states[d].transform;
+	}
 
-	// Lets process our frames...
+	// and turn them into one frame, with a single device this just gives our hands stable ids
+	if (!hand_merger.merge(frames, transforms, &merged_frame)) {
+		return NULL;
+	}
 
-	// Mark all current hand nodes as inactive, we'll mark the ones that are active as we find they are still used
-	for (int h = 0; h < hand_nodes.size(); h++) {
-		// if its already inactive we don't want to reset unused frames.
-		if (hand_nodes[h]->active_this_frame) {
-			hand_nodes[h]->active_this_frame = false;
-			hand_nodes[h]->unused_frames = 0;
-		}
+	const LEAP_TRACKING_EVENT *frame = &merged_frame.event;
+	if (p_record_telemetry && frame_source != NULL) {
+		telemetry.frame_picked_up(frame->info.timestamp, frame_source->get_now());
 	}
 
+	return frame;
+}
+
+void GDLMSensor::set_current_frame(const LEAP_TRACKING_EVENT *p_frame) {
+	// we keep a copy as the frame we're given is replaced on our next tick, along with how to bring it into
+	// the space of our node as our ARVR state may have changed by the time our hand data is asked for
+	gdlm_copy_frame(&current_frame, p_frame);
+	current_scale = world_scale;
+	current_transform = arvr ? hmd_transform * hmd_to_leap_motion : Transform();
+}
+
+void GDLMSensor::update_hands(const LEAP_TRACKING_EVENT *p_frame) {
+	// Mark all current hands as inactive, we'll mark the ones that are active as we find they are still used
+	hand_slots.begin_frame();
+
 	// process the hands we're getting from leap motion
-	for (uint32_t h = 0; h < frame->nHands; h++) {
-		LEAP_HAND *hand = &frame->pHands[h];
+	for (uint32_t h = 0; h < p_frame->nHands; h++) {
+		LEAP_HAND *hand = &p_frame->pHands[h];
 		int type = hand->type == eLeapHandType_Left ? 0 : 1;
 
 		// see if we already have a scene for this hand
@@ -724,312 +2143,326 @@ void GDLMSensor::_physics_process(float delta) {
 			hd = find_unused_hand(type);
 		}
 		if (hd == NULL) {
-			// nope? time to get a new hand
+			// nope? time to get a new hand, if we're out of slots we ignore this hand
 			hd = new_hand(type, hand->id);
-			if (hd != NULL) {
-				hand_nodes.push_back(hd);
-			}
 		}
 		if (hd != NULL) {
 			// yeah! mark as used and relate to our hand
-			hd->active_this_frame = true;
+			if (hd->leap_id != hand->id) {
+				// we're taking over a hand we lost, don't smooth towards where that one was
+				hd->filter.reset();
+			}
+			hand_slots.bind(type, hd->slot, hand->id);
+			hand_slots.mark_active(type, hd->slot);
 			hd->unused_frames = 0;
 			hd->leap_id = hand->id;
 
 			// and update
-			update_hand_data(hd, hand);
-			update_hand_position(hd, hand);
+			update_hand_data(hd, hand, p_frame->info.timestamp);
+			update_hand_position(hd, hand, p_frame->info.timestamp);
 
 			// should make sure hand is visible
 		}
 	}
 
-	// and clean up, in reverse because we may remove entries
-	for (int h = hand_nodes.size() - 1; h >= 0; h--) {
-		hand_data *hd = hand_nodes[h];
-
-		// not active?
-		if (!hd->active_this_frame) {
+	// and clean up the hands that aren't active
+	for (int t = 0; t < 2; t++) {
+		uint32_t inactive = hand_slots.get_used_mask(t) & ~hand_slots.get_active_mask(t);
+		for (; inactive != 0; inactive &= inactive - 1) {
+			hand_data *hd = &hands[t][GDLMHandSlots::lowest_slot(inactive)];
 			hd->unused_frames++;
 
 			// lost tracking for awhile now? remove it unless its the last one
-			if (hd->unused_frames > keep_hands_for_frames && (count_hands(hd->type) > 1 || !keep_last_hand)) {
+			if (hd->unused_frames > keep_hands_for_frames && (count_hands(t) > 1 || !keep_last_hand)) {
 				delete_hand(hd);
-				hand_nodes.erase(hand_nodes.begin() + h);
 			} else {
 				// should make sure hand is invisible
 			}
 		}
 	}
+}
+
+void GDLMSensor::update_hand_positions(const LEAP_TRACKING_EVENT *p_frame) {
+	// only move hands our physics tick already knows about, new hands and lost hands are handled there
+	for (uint32_t h = 0; h < p_frame->nHands; h++) {
+		LEAP_HAND *hand = &p_frame->pHands[h];
+		int type = hand->type == eLeapHandType_Left ? 0 : 1;
 
-	// free our buffer if we allocated it
-	if (interpolated_frame != NULL) {
-		::free(interpolated_frame);
+		hand_data *hd = find_hand_by_id(type, hand->id);
+		if (hd != NULL && hand_slots.is_active(type, hd->slot)) {
+			update_hand_position(hd, hand, p_frame->info.timestamp);
+		}
 	}
 }
 
-////////////////////////////////////////////////////////////////////////////////////////////////////////
-// All methods below here are running in our thread!!
+void GDLMSensor::_exit_tree() {
+	// our space belongs to our world which may go away with our tree
+	for (int t = 0; t < 2; t++) {
+		for (uint32_t mask = hand_slots.get_scene_mask(t); mask != 0; mask &= mask - 1) {
+			remove_proxies(&hands[t][GDLMHandSlots::lowest_slot(mask)]);
+		}
+	}
+}
 
-/** Translates eLeapRS result codes into a human-readable string. */
-const char *GDLMSensor::ResultString(eLeapRS r) {
-	switch (r) {
-		case eLeapRS_Success: return "eLeapRS_Success";
-		case eLeapRS_UnknownError: return "eLeapRS_UnknownError";
-		case eLeapRS_InvalidArgument: return "eLeapRS_InvalidArgument";
-		case eLeapRS_InsufficientResources: return "eLeapRS_InsufficientResources";
-		case eLeapRS_InsufficientBuffer: return "eLeapRS_InsufficientBuffer";
-		case eLeapRS_Timeout: return "eLeapRS_Timeout";
-		case eLeapRS_NotConnected: return "eLeapRS_NotConnected";
-		case eLeapRS_HandshakeIncomplete: return "eLeapRS_HandshakeIncomplete";
-		case eLeapRS_BufferSizeOverflow: return "eLeapRS_BufferSizeOverflow";
-		case eLeapRS_ProtocolError: return "eLeapRS_ProtocolError";
-		case eLeapRS_InvalidClientID: return "eLeapRS_InvalidClientID";
-		case eLeapRS_UnexpectedClosed: return "eLeapRS_UnexpectedClosed";
-		case eLeapRS_UnknownImageFrameRequest: return "eLeapRS_UnknownImageFrameRequest";
-		case eLeapRS_UnknownTrackingFrameID: return "eLeapRS_UnknownTrackingFrameID";
-		case eLeapRS_RoutineIsNotSeer: return "eLeapRS_RoutineIsNotSeer";
-		case eLeapRS_TimestampTooEarly: return "eLeapRS_TimestampTooEarly";
-		case eLeapRS_ConcurrentPoll: return "eLeapRS_ConcurrentPoll";
-		case eLeapRS_NotAvailable: return "eLeapRS_NotAvailable";
-		case eLeapRS_NotStreaming: return "eLeapRS_NotStreaming";
-		case eLeapRS_CannotOpenDevice: return "eLeapRS_CannotOpenDevice";
-		default: return "unknown result type.";
-	}
-}
-
-void GDLMSensor::handleConnectionEvent(const LEAP_CONNECTION_EVENT *connection_event) {
-	// log..
-	printf("LeapMotion - connected to leap motion\n");
-
-	// update our status
-	set_is_connected(true);
-}
-
-void GDLMSensor::handleConnectionLostEvent(const LEAP_CONNECTION_LOST_EVENT *connection_lost_event) {
-	// update our status
-	set_is_connected(false);
+// our Godot physics process, runs within the physic thread and is responsible for updating physics related stuff
+void GDLMSensor::_physics_process(float delta) {
+	if (update_mode == UPDATE_PROCESS) {
+		// everything is done in _process
+		return;
+	}
 
-	// log...
-	printf("LeapMotion - connection lost\n");
+	// in split mode _process keeps our telemetry as that is what ends up on screen
+	bool is_physics_only = update_mode == UPDATE_PHYSICS;
+	const LEAP_TRACKING_EVENT *frame = get_frame_to_apply(last_frame_ids, is_physics_only);
+	if (frame == NULL) {
+		return;
+	}
+
+	// Lets process our frames...
+	set_current_frame(frame);
+	if (arvr_trackers) {
+		update_trackers(frame);
+	}
+	if (instance_hands) {
+		update_hands(frame);
+	}
+
+	// our transforms are written, this is how old our frame is by the time it is rendered
+	if (is_physics_only && frame_source != NULL) {
+		telemetry.frame_applied(frame->info.timestamp, frame_source->get_now());
+	}
 }
 
-void GDLMSensor::handleDeviceEvent(const LEAP_DEVICE_EVENT *device_event) {
-	// copied from the SDK, just record this, not sure yet if we need to remember any of this..
-	LEAP_DEVICE deviceHandle;
+// our Godot process, runs once for every frame we render so it's as close to rendering as we can get
+void GDLMSensor::_process(float delta) {
+	// our camera images are only for display, so they're always updated here
+	update_images();
 
-	//Open device using LEAP_DEVICE_REF from event struct.
-	eLeapRS result = LeapOpenDevice(device_event->device, &deviceHandle);
-	if (result != eLeapRS_Success) {
-		printf("Could not open device %s.\n", ResultString(result));
+	if (update_mode == UPDATE_PHYSICS) {
+		// everything is done in _physics_process
 		return;
 	}
 
-	//Create a struct to hold the device properties, we have to provide a buffer for the serial string
-	LEAP_DEVICE_INFO deviceProperties = { sizeof(deviceProperties) };
-
-	// Start with a length of 1 (pretending we don't know a priori what the length is).
-	// Currently device serial numbers are all the same length, but that could change in the future
-	deviceProperties.serial_length = 1;
-	deviceProperties.serial = (char *)malloc(deviceProperties.serial_length);
-
-	// This will fail since the serial buffer is only 1 character long
-	// But deviceProperties is updated to contain the required buffer length
-	result = LeapGetDeviceInfo(deviceHandle, &deviceProperties);
-	if (result == eLeapRS_InsufficientBuffer) {
-		//try again with correct buffer size
-		deviceProperties.serial = (char *)realloc(deviceProperties.serial, deviceProperties.serial_length);
-		result = LeapGetDeviceInfo(deviceHandle, &deviceProperties);
-		if (result != eLeapRS_Success) {
-			printf("Failed to get device info %s.\n", ResultString(result));
-			::free(deviceProperties.serial);
-			return;
-		}
+	const LEAP_TRACKING_EVENT *frame = get_frame_to_apply(last_process_frame_ids, true);
+	if (frame == NULL) {
+		return;
+	}
+
+	set_current_frame(frame);
+	if (!arvr_trackers) {
+		// no trackers to update
+	} else if (update_mode == UPDATE_PROCESS) {
+		update_trackers(frame);
+	} else {
+		// just like our hands, in split mode our physics tick adds and removes our trackers and we only move them here
+		update_tracker_positions(frame);
+	}
+	if (!instance_hands) {
+		// only our hand data methods use our frame
+	} else if (update_mode == UPDATE_PROCESS) {
+		update_hands(frame);
+	} else {
+		// in split mode our physics tick has already placed our hands for our collisions,
+		// we resample them here so they follow our display and not our physics tick
+		update_hand_positions(frame);
 	}
 
-	// log this for now
-	printf("LeapMotion - found device %s\n", deviceProperties.serial);
+	if (frame_source != NULL) {
+		telemetry.frame_applied(frame->info.timestamp, frame_source->get_now());
+	}
+}
 
-	// remember this device as the last one we interacted with, we're assuming only one is attached for now.
-	set_last_device(&deviceProperties);
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+// All methods below here are running in our thread!!
 
-	::free(deviceProperties.serial);
-	LeapCloseDevice(deviceHandle);
+void GDLMSensor::on_connection_changed(bool p_is_connected) {
+	set_is_connected(p_is_connected);
 }
 
-void GDLMSensor::handleDeviceLostEvent(const LEAP_DEVICE_EVENT *device_event) {
-	// just log for now
-	printf("LeapMotion - lost device\n");
+void GDLMSensor::on_device_changed(uint32_t p_device, const char *p_serial, bool p_is_attached) {
+	if (p_is_attached) {
+		attach_stream(p_device, p_serial);
+	} else {
+		int stream = find_stream(p_device);
+		if (stream >= 0) {
+			printf("LeapMotion - lost device %s\n", p_serial == NULL ? "" : p_serial);
+			device_streams[stream].detach();
+		}
+	}
 }
 
-void GDLMSensor::handleDeviceFailureEvent(const LEAP_DEVICE_FAILURE_EVENT *device_failure_event) {
-	// do something with this
-	// device_failure_event->status, device_failure_event->hDevice
+void GDLMSensor::on_tracking_event(uint32_t p_device, const LEAP_TRACKING_EVENT *p_event) {
+	// while we're playing back a recording we ignore our frame source,
+	// we hold our lock until we've pushed our event so playback can't start halfway
+	std::lock_guard<std::mutex> guard(push_mutex);
+	if (is_playing.load()) {
+		return;
+	}
 
-	// just log for now
-	printf("LeapMotion - device failure %i\n", device_failure_event->status);
-}
+	// we may get frames before we're told about our device, we'll learn its serial once we are
+	int stream = find_stream(p_device);
+	if (stream < 0) {
+		stream = attach_stream(p_device, "");
+		if (stream < 0) {
+			return;
+		}
+	}
 
-void GDLMSensor::handleTrackingEvent(const LEAP_TRACKING_EVENT *tracking_event) {
-	// !BAS! These events supposedly are cached, but for how long is this pointer still usable?
-	// is this a pointer into a round robbin buffer or are we actually better of doing a deep copy?
-	// Leap motion sample project does this so for now we trust it.
-	// We will indeed be using this data from our main thread during our physics process
+	// record this if we're recording, this does nothing if we're not
+	// our recordings hold a single device so we record our primary device
+	int64_t received = frame_source->get_now();
+	if (stream == get_primary_stream()) {
+		recorder.record(p_event, received);
+	}
 
-	set_last_frame(tracking_event); // support polling tracking data from different thread
+	push_tracking_event(stream, p_event, received);
 }
 
-void GDLMSensor::handleLogEvent(const LEAP_LOG_EVENT *log_event) {
-	// just log for now
-	char lvl[250];
-	switch (log_event->severity) {
-		case eLeapLogSeverity_Critical:
-			strcpy(lvl, "Critical");
-			break;
-		case eLeapLogSeverity_Warning:
-			strcpy(lvl, "Warning");
-			break;
-		case eLeapLogSeverity_Information:
-			strcpy(lvl, "Information");
-			break;
-		default:
-			strcpy(lvl, "Unknown");
-			break;
+void GDLMSensor::on_image_event(uint32_t p_device, const LEAP_IMAGE_EVENT *p_event) {
+	// our images wouldn't match the hands of a recording we're playing back
+	if (is_playing.load()) {
+		return;
+	}
+
+	// we only show the cameras of our primary device
+	int stream = find_stream(p_device);
+	if (stream < 0 || stream != get_primary_stream()) {
+		return;
 	}
 
-	printf("LeapMotion - %s - %lli: %s\n", lvl, log_event->timestamp, log_event->message);
+	// we copy what we need into our own buffers, images Godot hasn't picked up yet are replaced
+	image_stream.write(p_event);
 }
 
-/** Called by serviceMessageLoop() when a log event is returned by LeapPollConnection(). */
-void GDLMSensor::handleLogEvents(const LEAP_LOG_EVENTS *log_events) {
-	for (int i = 0; i < (int)(log_events->nEvents); i++) {
-		handleLogEvent(&log_events->events[i]);
+int GDLMSensor::find_stream(uint32_t p_device) const {
+	for (int d = 0; d < GDLM_MAX_DEVICES; d++) {
+		if (device_streams[d].is_attached() && device_streams[d].get_device_id() == p_device) {
+			return d;
+		}
 	}
+
+	return -1;
 }
 
-void GDLMSensor::handlePolicyEvent(const LEAP_POLICY_EVENT *policy_event) {
-	// just log for now
-	printf("LeapMotion - policy event");
+int GDLMSensor::attach_stream(uint32_t p_device, const char *p_serial) {
+	const char *serial = p_serial == NULL ? "" : p_serial;
+	int stream = find_stream(p_device);
+
+	if (stream < 0 && serial[0] != '\0') {
+		// a device coming back gets its old stream back so it keeps its place in our merger
+		for (int d = 0; d < GDLM_MAX_DEVICES && stream < 0; d++) {
+			if (!device_streams[d].is_attached() && device_streams[d].has_serial(serial)) {
+				stream = d;
+			}
+		}
 
-	if (policy_event->current_policy & eLeapPolicyFlag_BackgroundFrames) {
-		printf(", background frames");
+		// or take over the stream we created when frames arrived before we knew their device
+		for (int d = 0; d < GDLM_MAX_DEVICES && stream < 0; d++) {
+			if (device_streams[d].is_attached() && device_streams[d].get_device_id() == 0 && device_streams[d].has_serial("")) {
+				stream = d;
+			}
+		}
 	}
-	if (policy_event->current_policy & eLeapPolicyFlag_OptimizeHMD) {
-		printf(", optimised for HMD");
+
+	for (int d = 0; d < GDLM_MAX_DEVICES && stream < 0; d++) {
+		if (!device_streams[d].is_attached()) {
+			stream = d;
+		}
 	}
-	if (policy_event->current_policy & eLeapPolicyFlag_AllowPauseResume) {
-		printf(", allow pause and resume");
+
+	if (stream < 0) {
+		printf("LeapMotion - can't use any more devices, ignoring %s\n", serial);
+		return -1;
 	}
 
-	printf("\n");
+	if (serial[0] != '\0') {
+		printf("LeapMotion - using device %s\n", serial);
+	}
+	device_streams[stream].attach(p_device, serial);
+	return stream;
 }
 
-void GDLMSensor::handleConfigChangeEvent(const LEAP_CONFIG_CHANGE_EVENT *config_change_event) {
-	// do something with this?
+int GDLMSensor::get_primary_stream() const {
+	for (int d = 0; d < GDLM_MAX_DEVICES; d++) {
+		if (device_streams[d].is_attached()) {
+			return d;
+		}
+	}
 
-	// just log for now
-	printf("LeapMotion - config change event\n");
+	return -1;
 }
 
-void GDLMSensor::handleConfigResponseEvent(const LEAP_CONFIG_RESPONSE_EVENT *config_response_event) {
-	// do something with this?
+void GDLMSensor::push_tracking_event(int p_stream, const LEAP_TRACKING_EVENT *tracking_event, int64_t p_received) {
+	// Each stream has its own buffer and history so our devices don't wait on each other,
+	// our stream copies our event and tells us which frame it had before so we can spot dropped frames.
+	int64_t previous_id = device_streams[p_stream].write(tracking_event);
 
-	// just log for now
-	printf("LeapMotion - config response event\n");
+	telemetry.frame_received(tracking_event, p_received, previous_id);
 }
 
-/** Called by serviceMessageLoop() when a point mapping change event is returned by LeapPollConnection(). */
-void GDLMSensor::handleImageEvent(const LEAP_IMAGE_EVENT *image_event) {
-	// do something with this?
+// current time on the clock of our frame source, we can still play back recordings without one
+static int64_t replay_now(GDLMFrameSource *p_frame_source) {
+	if (p_frame_source != NULL) {
+		return p_frame_source->get_now();
+	}
 
-	// just log for now
-	printf("LeapMotion - image event\n");
+	return GDLMClockSync::get_local_usec();
 }
 
-/** Called by serviceMessageLoop() when a point mapping change event is returned by LeapPollConnection(). */
-void GDLMSensor::handlePointMappingChangeEvent(const LEAP_POINT_MAPPING_CHANGE_EVENT *point_mapping_change_event) {
-	// do something with this?
+void GDLMSensor::replay_main(GDLMSensor *p_sensor) {
+	LEAP_TRACKING_EVENT event;
+	int64_t received;
+	size_t offset = p_sensor->recording.first();
 
-	// just log for now
-	printf("LeapMotion - point mapping change event\n");
-}
+	printf("LeapMotion - start playback\n");
 
-/** Called by serviceMessageLoop() when a point mapping change event is returned by LeapPollConnection(). */
-void GDLMSensor::handleHeadPoseEvent(const LEAP_HEAD_POSE_EVENT *head_pose_event) {
-	// definately need to implement this once we add an ARVR interface for this.
+	// We move our recording to the present so our timestamps make sense to our clock rebaser and frame history.
+	// Our frame source isn't replaced while we're playing back.
+	GDLMFrameSource *frame_source = p_sensor->frame_source;
+	int64_t start = replay_now(frame_source);
+	int64_t first_received = 0;
+	bool is_first = true;
 
-	// just log for now
-	printf("LeapMotion - head pose event\n");
-}
+	while (p_sensor->is_playing.load() && p_sensor->recording.read(&offset, &event, &received)) {
+		if (is_first) {
+			first_received = received;
+			is_first = false;
+		}
 
+		int64_t delta = received - first_received;
+		event.info.timestamp += start - first_received;
 
-void GDLMSensor::lm_main(GDLMSensor *p_sensor) {
-	eLeapRS result;
-	LEAP_CONNECTION_MESSAGE msg;
+		if (p_sensor->replay_realtime) {
+			// wait until it's time for this frame
+			int64_t wait = start + delta - replay_now(frame_source);
+			if (wait > 0) {
+				std::this_thread::sleep_for(std::chrono::microseconds(wait));
+			}
+		}
 
+		// once we're stopped our frame source may push again, so we check under our lock
+		std::lock_guard<std::mutex> guard(p_sensor->push_mutex);
+		if (p_sensor->is_playing.load()) {
+			p_sensor->push_tracking_event(0, &event, replay_now(frame_source));
+		}
+	}
+
+	printf("LeapMotion - end playback\n");
+	p_sensor->is_playing.store(false);
+}
+
+void GDLMSensor::lm_main(GDLMSensor *p_sensor) {
 	printf("Start thread\n");
 	// note, p_sensor should not be destroyed until our thread cleanly exists
 	// as that happens in the destruct of our sensor class we should be able to rely on this
 
 	// loop until is_running is set to false by our main process
-	while (p_sensor->get_is_running()) {
-		// poll connection, this sleeps our thread until we have a message to handle or
-		unsigned int timeout = 1000;
-		result = LeapPollConnection(p_sensor->leap_connection, timeout, &msg);
-
-		// Handle messages by calling
-		switch (msg.type) {
-			case eLeapEventType_Connection:
-				p_sensor->handleConnectionEvent(msg.connection_event);
-				break;
-			case eLeapEventType_ConnectionLost:
-				p_sensor->handleConnectionLostEvent(msg.connection_lost_event);
-				break;
-			case eLeapEventType_Device:
-				p_sensor->handleDeviceEvent(msg.device_event);
-				break;
-			case eLeapEventType_DeviceLost:
-				p_sensor->handleDeviceLostEvent(msg.device_event);
-				break;
-			case eLeapEventType_DeviceFailure:
-				p_sensor->handleDeviceFailureEvent(msg.device_failure_event);
-				break;
-			case eLeapEventType_Tracking:
-				p_sensor->handleTrackingEvent(msg.tracking_event);
-				break;
-			case eLeapEventType_ImageComplete:
-				// Ignore since 4.0.0
-				break;
-			case eLeapEventType_ImageRequestError:
-				// Ignore since 4.0.0
-				break;
-			case eLeapEventType_LogEvent:
-				p_sensor->handleLogEvent(msg.log_event);
-				break;
-			case eLeapEventType_Policy:
-				p_sensor->handlePolicyEvent(msg.policy_event);
-				break;
-			case eLeapEventType_ConfigChange:
-				p_sensor->handleConfigChangeEvent(msg.config_change_event);
-				break;
-			case eLeapEventType_ConfigResponse:
-				p_sensor->handleConfigResponseEvent(msg.config_response_event);
-				break;
-			case eLeapEventType_Image:
-				p_sensor->handleImageEvent(msg.image_event);
-				break;
-			case eLeapEventType_PointMappingChange:
-				p_sensor->handlePointMappingChangeEvent(msg.point_mapping_change_event);
-				break;
-			case eLeapEventType_LogEvents:
-				p_sensor->handleLogEvents(msg.log_events);
-				break;
-			case eLeapEventType_HeadPose:
-				p_sensor->handleHeadPoseEvent(msg.head_pose_event);
-				break;
-			default: {
-				// ignore
-			} break;
-		}
+	while (p_sensor->is_running.load(std::memory_order_acquire)) {
+		// This sleeps our thread until our frame source has something for us, then handles everything that is pending.
+		// We're woken up when we need to stop, our timeout is only a backstop in case that fails.
+		p_sensor->frame_source->poll(p_sensor, 100);
+
+		// keep our clocks in sync
+		p_sensor->frame_source->update_clock(OS::get_singleton()->get_ticks_usec(), 1);
 	}
 }
@@ -1,48 +1,185 @@
 #ifndef GDLM_SENSOR_H
 #define GDLM_SENSOR_H
 
-#include <ARVRInterface.hpp>
+#include <ARVRPositionalTracker.hpp>
 #include <ARVRServer.hpp>
 #include <Array.hpp>
 #include <Dictionary.hpp>
+#include <Engine.hpp>
 #include <GlobalConstants.hpp>
 #include <Godot.hpp>
+#include <Image.hpp>
+#include <ImageTexture.hpp>
 #include <OS.hpp>
 #include <PackedScene.hpp>
+#include <PhysicsServer.hpp>
+#include <PoolArrays.hpp>
+#include <ProjectSettings.hpp>
+#include <RID.hpp>
+#include <Rect2.hpp>
 #include <ResourceLoader.hpp>
+#include <Script.hpp>
 #include <Skeleton.hpp>
 #include <Spatial.hpp>
 #include <Transform.hpp>
+#include <World.hpp>
+#include <atomic>
 #include <chrono>
 #include <mutex>
 #include <thread>
-#include <vector>
 
-// include leap motion library
-#include <LeapC.h>
+#include "gdlm_device_stream.h"
+#include "gdlm_frame_buffer.h"
+#include "gdlm_frame_history.h"
+#include "gdlm_frame_source.h"
+#include "gdlm_hand_filter.h"
+#include "gdlm_hand_gestures.h"
+#include "gdlm_hand_merger.h"
+#include "gdlm_hand_proxies.h"
+#include "gdlm_hand_slots.h"
+#include "gdlm_hand_trackers.h"
+#include "gdlm_hand_solver.h"
+#include "gdlm_image_stream.h"
+#include "gdlm_leapc_source.h"
+#include "gdlm_recording.h"
+#include "gdlm_synthetic_source.h"
+#include "gdlm_telemetry.h"
+
+// We never predict further ahead of our newest frame than this, in microseconds.
+#define GDLM_MAX_PREDICTION_USEC 50000
+
+// Number of palm predictions we remember until we have the frames to check them against.
+#define GDLM_MAX_PREDICTIONS 64
+
+// We only rescale our bone meshes once a bone changes length by more than this in mm.
+#define GDLM_BONE_LENGTH_TOLERANCE_MM 0.5f
 
 namespace godot {
 
-class GDLMSensor : public Spatial {
+class GDLMSensor : public Spatial, public GDLMFrameSourceListener {
 	GODOT_CLASS(GDLMSensor, Spatial)
 
+public:
+	enum frame_source_type {
+		FRAME_SOURCE_LEAPC, // a leap motion device, only available if we're built with LeapC
+		FRAME_SOURCE_SYNTHETIC // hands generated by GDLMSyntheticSource
+	};
+
+	enum update_mode_type {
+		UPDATE_PHYSICS, // everything is done in _physics_process
+		UPDATE_PROCESS, // everything is done in _process
+		UPDATE_SPLIT // hands are added, removed and placed in _physics_process and placed again in _process
+	};
+
+	// Layout of the values get_hand_data returns for each hand. Positions are in meters relative to our node,
+	// just like our hand scenes, vectors take up 3 values and our orientation is a quaternion taking up 4.
+	enum hand_value {
+		HAND_VALUE_ID,
+		HAND_VALUE_TYPE, // 0 = left, 1 = right
+		HAND_VALUE_CONFIDENCE,
+		HAND_VALUE_VISIBLE_TIME, // in seconds
+		HAND_VALUE_PINCH_DISTANCE, // in mm
+		HAND_VALUE_PINCH_STRENGTH,
+		HAND_VALUE_GRAB_STRENGTH,
+		HAND_VALUE_GRAB_ANGLE, // in radians
+		HAND_VALUE_PALM_POSITION,
+		HAND_VALUE_PALM_ORIENTATION = HAND_VALUE_PALM_POSITION + 3,
+		HAND_VALUE_PALM_VELOCITY = HAND_VALUE_PALM_ORIENTATION + 4, // in meters per second
+		HAND_VALUE_PALM_NORMAL = HAND_VALUE_PALM_VELOCITY + 3,
+		HAND_VALUE_PALM_DIRECTION = HAND_VALUE_PALM_NORMAL + 3,
+		HAND_VALUE_PALM_WIDTH = HAND_VALUE_PALM_DIRECTION + 3,
+		HAND_VALUE_ELBOW,
+		HAND_VALUE_WRIST = HAND_VALUE_ELBOW + 3,
+		HAND_VALUE_ARM_WIDTH = HAND_VALUE_WRIST + 3,
+		HAND_VALUE_COUNT
+	};
+
 private:
-	LEAP_CONNECTION leap_connection;
-	LEAP_CLOCK_REBASER clock_synchronizer;
-	const LEAP_TRACKING_EVENT *last_frame;
-	LEAP_DEVICE_INFO *last_device;
-	long long int last_frame_id;
-	bool is_running;
-	bool is_connected;
+	GDLMFrameSource *frame_source; /* where our frames come from, only replaced while our thread isn't running */
+	int frame_source_type;
+	float synthetic_rate;
+	int synthetic_hands;
+	int synthetic_devices;
+	GDLMDeviceStream device_streams[GDLM_MAX_DEVICES]; /* deep copies of the tracking events of each device, written by lm_main, read by _physics_process or _process */
+	GDLMHandMerger hand_merger; /* combines the frames of our devices, only used on our main thread */
+	gdlm_frame merged_frame; /* the frame we're applying, only used on our main thread */
+	gdlm_frame current_frame; /* the frame we last applied, returned by our hand data methods */
+	Transform current_transform; /* from leap motion space to our node for our current frame, scaled by current_scale */
+	float current_scale;
+	bool instance_hands; /* instance our hand scenes, without them only our hand data methods give access to our hands */
+	bool arvr_trackers; /* register our hands with the ARVR server as positional trackers */
+	GDLMHandTrackers hand_trackers; /* decides what our trackers do, only used on our main thread */
+	int tracker_ids[2]; /* controller ids of our left and right tracker, 0 if not registered */
+	gdlm_hand_frames hand_frames; /* local frames of the bones of the hand we're updating, only used on our main thread */
+	gdlm_hand_proxies hand_proxies; /* collision proxies of the hand we're updating, only used on our main thread */
+	bool collision_proxies; /* give our hands collision proxies in our physics space */
+	int collision_layer; /* for our collision proxies */
+	int collision_mask;
+	long long int last_frame_ids[GDLM_MAX_DEVICES]; /* last frame of each device we applied in _physics_process */
+	long long int last_process_frame_ids[GDLM_MAX_DEVICES]; /* last frame of each device we applied in _process */
+	int update_mode; /* where we update our hands, see update_mode_type */
+	std::atomic<bool> is_running; /* checked by our leap motion thread on every wakeup */
+	std::atomic<bool> is_connected;
 	bool arvr;
 	bool keep_last_hand;
-	float smooth_factor;
+	float smooth_factor; /* only used in ARVR mode when our filter is off */
+	gdlm_filter_params filter_params; /* our filter settings for all hands */
+	gdlm_filter_params hand_filter_params[2]; /* filter settings for left and right hands, if overridden */
+	bool has_hand_filter_params[2];
+	LEAP_HAND filtered_hand; /* the hand we're updating after filtering, only used on our main thread */
+	bool use_bone_rotations; /* use the bone rotations LeapC gives us instead of deriving them from our joints */
+	float prediction_ms; /* outside of ARVR, how far ahead of now we predict our hands, 0.0 disables prediction */
+	float hand_data_epsilon; /* only push hand data to our scene if our strengths changed more than this, 0.0 pushes every frame */
+	float pinch_distance_epsilon_mm; /* same for our pinch distance, in mm, only used if hand_data_epsilon is set */
+	bool push_hand_data; /* push our pinch and grab values to our hand scenes */
+	Array hand_state_args; /* reused for calling set_hand_state so we don't rebuild an array for each hand each frame */
+	String set_hand_state_method;
+	gdlm_gesture_params gesture_params; /* when our hands are pinching or grabbing */
+	float hand_state_rate; /* how often per second we emit hand_state_changed for each hand, 0.0 never emits it */
+	Array hand_state_signal_args; /* reused for emitting hand_state_changed */
+	String hand_state_signal;
 	int keep_hands_for_frames;
 	Transform hmd_transform; /* for ARVR only, transform of our primary HMD */
 	Transform hmd_to_leap_motion; /* for ARVR only, transform to adjust leap motion */
+	Dictionary device_transforms; /* where each device is within our tracking space, by serial, devices we don't know are at our origin */
+	uint32_t device_transforms_version; /* goes up whenever device_transforms changes */
+
+	// What our main thread knows about each of our device streams, only used on our main thread.
+	struct device_state {
+		uint32_t generation; // generation of our stream we last refreshed for
+		uint32_t transforms_version; // version of device_transforms we last refreshed for
+		String serial;
+		gdlm_device_transform transform;
+		gdlm_frame frame; // our interpolated or predicted frame for this device
+	};
+
+	device_state device_states[GDLM_MAX_DEVICES];
+
+	GDLMImageStream image_stream; /* camera images of our primary device, written by lm_main, read by _process */
+	Ref<Image> images[2]; /* left and right camera image, only used on our main thread */
+	Ref<ImageTexture> image_textures[2]; /* our camera images as shown in Godot */
 
 	std::thread *lm_thread;
-	std::mutex lm_mutex;
+
+	GDLMRecorder recorder; /* records the tracking events we receive from our device */
+	GDLMRecording recording; /* recording we're playing back */
+	std::thread *replay_thread;
+	std::atomic<bool> is_playing;
+	std::mutex push_mutex; /* held while checking is_playing and pushing a tracking event, so we never push from our frame source and our recording at once */
+	bool replay_realtime; /* play back at the speed we recorded, or as fast as we can, recordings are played back as our first device */
+	GDLMTelemetry telemetry; /* how old our frames are when we use them and how many we lose */
+
+	// A palm position we predicted, once we have frames for its timestamp we know how far off we were.
+	struct palm_prediction {
+		int64_t timestamp;
+		uint32_t leap_id;
+		LEAP_VECTOR position;
+	};
+
+	palm_prediction palm_predictions[GDLM_MAX_PREDICTIONS]; /* ring buffer, only used on our main thread */
+	int first_prediction;
+	int prediction_count;
+	gdlm_frame prediction_check_frame; /* our actual frame at the timestamp of our prediction we're checking */
 
 	// some handy things for defining our hands
 	static const char *const finger[];
@@ -50,65 +187,119 @@ private:
 
 	struct hand_data {
 		int type; // 0 = left, 1 = right
+		int slot; // our slot in hand_slots
 		uint32_t leap_id; // ID in leap
-		bool active_this_frame; // is this hand active this frame?
 		uint32_t unused_frames; // number of frames since we lost tracking of this hand
+		GDLMHandFilter filter; // smooths our joints, reset whenever we start tracking a different hand
+		GDLMHandGestures gestures; // is our hand pinching or grabbing
+		int64_t last_state_signal; // timestamp of the frame for which we last emitted hand_state_changed, 0 if we haven't yet
 		Spatial *scene;
 		Spatial *finger_nodes[5]; // the root nodes for each finger
 		Spatial *digit_nodes[5][4]; // nodes for each digit
+		Spatial *bone_nodes[5][4]; // meshes for the bones leading up to each digit node, NULL if our scene has none
+		float bone_lengths[5][4]; // lengths we last scaled our bone meshes to
+		Skeleton *skeleton; // if our scene is skeleton based we pose its bones instead of moving nodes
+		int finger_bones[5]; // bone indices in our skeleton, laid out like finger_nodes, -1 if not found
+		int digit_bones[5][4]; // bone indices in our skeleton, laid out like digit_nodes
+		Transform finger_rest_inverse[5]; // inverse of our bone rest transforms, poses are relative to these
+		Transform digit_rest_inverse[5][4];
+		uint32_t scene_version; // version of the hand scene we were instanced from
+		bool has_hand_state; // does our scene implement set_hand_state?
+		bool has_gesture_signals; // does our scene still declare the deprecated pinched and grabbed signals?
+		bool has_pushed_data; // have we pushed our hand data at least once?
+		float pinch_distance; // last values we pushed to our scene
+		float pinch_strength;
+		float grab_strength;
+		RID proxy_body; // kinematic body holding our collision proxies, only valid while collision_proxies is set
+		RID proxy_shapes[GDLM_HAND_PROXIES]; // laid out like gdlm_hand_proxies
+		float proxy_sizes[GDLM_HAND_PROXIES][3]; // sizes our shapes currently have
+		bool proxy_in_space; // is our body in our worlds physics space?
+	};
+
+	// Where to find everything in a hand scene, resolved once when a hand scene is loaded.
+	// Our bones are only set for skeleton based scenes, our paths only for node based scenes.
+	struct hand_binding {
+		bool is_valid; // can we instance our scene?
+		bool has_hand_state; // does our scene implement set_hand_state?
+		bool has_gesture_signals; // does our scene still declare the deprecated pinched and grabbed signals?
+		bool has_skeleton;
+		NodePath skeleton_path;
+		NodePath finger_paths[5]; // paths relative to our scene root, empty if not found
+		NodePath digit_paths[5][4];
+		NodePath bone_paths[5][4]; // our bone meshes, siblings of our digit nodes named after them with _Bone added
+		int finger_bones[5]; // -1 if not found
+		int digit_bones[5][4];
+		Transform finger_rest_inverse[5];
+		Transform digit_rest_inverse[5][4];
 	};
 
 	// hands as 0 (left) and 1 (right), we will probably only have one each but just in case...
 	float world_scale;
 	String hand_scene_names[2];
 	Ref<PackedScene> hand_scenes[2];
-	std::vector<GDLMSensor::hand_data *> hand_nodes;
+	hand_binding hand_bindings[2];
+	GDLMHandSlots hand_slots; // which of our hands are free, pooled or tracking a hand
+	hand_data hands[2][GDLM_MAX_HAND_SLOTS]; // our hands by type and slot, only valid for slots that have a scene
+	uint32_t hand_scene_versions[2]; // increased whenever a hand scene changes so we don't pool outdated hands
+	int hand_pool_size;
+	int pool_hits; // number of hands we could take from our pool
+	int pool_misses; // number of hands we had to instance because our pool was empty
 
 	GDLMSensor::hand_data *find_hand_by_id(int p_type, uint32_t p_leap_id);
 	GDLMSensor::hand_data *find_unused_hand(int p_type);
-	int count_hands(int p_type, bool p_active_only = false);
+	int count_hands(int p_type, bool p_active_only = false) const;
+	GDLMSensor::hand_data *instance_hand(int p_type);
+	void free_hand(GDLMSensor::hand_data *p_hand_data);
+	void fill_hand_pool(int p_type);
+	void clear_hand_pool(int p_type);
 	GDLMSensor::hand_data *new_hand(int p_type, uint32_t p_leap_id);
 	void delete_hand(GDLMSensor::hand_data *p_hand_data);
+	Skeleton *find_skeleton(Spatial *p_scene);
+	void create_proxies(GDLMSensor::hand_data *p_hand_data);
+	void free_proxies(GDLMSensor::hand_data *p_hand_data);
+	void remove_proxies(GDLMSensor::hand_data *p_hand_data);
+	void bind_hand_scene(int p_type);
 
-	// return result state as a string
-	const char *ResultString(eLeapRS r);
-
-	// these are handlers for all the messages LeapC sends us
-	void handleConnectionEvent(const LEAP_CONNECTION_EVENT *connection_event);
-	void handleConnectionLostEvent(const LEAP_CONNECTION_LOST_EVENT *connection_lost_event);
-	void handleDeviceEvent(const LEAP_DEVICE_EVENT *device_event);
-	void handleDeviceLostEvent(const LEAP_DEVICE_EVENT *device_event);
-	void handleDeviceFailureEvent(const LEAP_DEVICE_FAILURE_EVENT *device_failure_event);
-	void handleTrackingEvent(const LEAP_TRACKING_EVENT *tracking_event);
-	void handleLogEvent(const LEAP_LOG_EVENT *log_event);
-	void handleLogEvents(const LEAP_LOG_EVENTS *log_events);
-	void handlePolicyEvent(const LEAP_POLICY_EVENT *policy_event);
-	void handleConfigChangeEvent(const LEAP_CONFIG_CHANGE_EVENT *config_change_event);
-	void handleConfigResponseEvent(const LEAP_CONFIG_RESPONSE_EVENT *config_response_event);
-	void handleImageEvent(const LEAP_IMAGE_EVENT *image_event);
-	void handlePointMappingChangeEvent(const LEAP_POINT_MAPPING_CHANGE_EVENT *point_mapping_change_event);
-	void handleHeadPoseEvent(const LEAP_HEAD_POSE_EVENT *head_pose_event);
+	void start_frame_source();
+	void stop_frame_source();
+	void push_tracking_event(int p_stream, const LEAP_TRACKING_EVENT *tracking_event, int64_t p_received);
 
-protected:
-	void lock();
-	void unlock();
+	// called from our leap motion thread
+	int find_stream(uint32_t p_device) const;
+	int attach_stream(uint32_t p_device, const char *p_serial);
+	int get_primary_stream() const;
 
-	const LEAP_TRACKING_EVENT *get_last_frame();
-	void set_last_frame(const LEAP_TRACKING_EVENT *p_frame);
-	const LEAP_DEVICE_INFO *get_last_device();
-	void set_last_device(const LEAP_DEVICE_INFO *p_device);
+	// called from our main thread
+	void refresh_device(int p_stream);
+	void update_images();
 
+protected:
 	void set_is_running(bool p_set);
 	void set_is_connected(bool p_set);
 
 	bool wait_for_connection(int timeout = 5000, int waittime = 1100);
 
-	void update_hand_data(GDLMSensor::hand_data *p_hand_data, LEAP_HAND *p_leap_hand);
-	void update_hand_position(GDLMSensor::hand_data *p_hand_data, LEAP_HAND *p_leap_hand);
+	const LEAP_TRACKING_EVENT *get_interpolated_frame(int p_stream, int64_t p_leap_target_usec);
+	const LEAP_TRACKING_EVENT *get_predicted_frame(int p_stream, int64_t p_leap_target_usec, bool p_check_predictions);
+	void check_predictions(const GDLMFrameHistory &p_history, const LEAP_TRACKING_EVENT *p_predicted);
+
+	const LEAP_TRACKING_EVENT *get_frame_to_apply(long long int *p_last_frame_ids, bool p_record_telemetry);
+	void set_current_frame(const LEAP_TRACKING_EVENT *p_frame);
+	void update_hands(const LEAP_TRACKING_EVENT *p_frame);
+	void update_trackers(const LEAP_TRACKING_EVENT *p_frame);
+	void update_tracker_positions(const LEAP_TRACKING_EVENT *p_frame);
+	void apply_tracker_changes(const uint32_t *p_changes);
+	void remove_trackers();
+	void update_hand_positions(const LEAP_TRACKING_EVENT *p_frame);
+	void update_hand_data(GDLMSensor::hand_data *p_hand_data, LEAP_HAND *p_leap_hand, int64_t p_timestamp);
+	void emit_gesture_signals(GDLMSensor::hand_data *p_hand_data, uint32_t p_changed);
+	void update_hand_position(GDLMSensor::hand_data *p_hand_data, LEAP_HAND *p_leap_hand, int64_t p_timestamp);
+	void update_proxies(GDLMSensor::hand_data *p_hand_data, const LEAP_HAND *p_leap_hand, const gdlm_bone_frame &p_hand_inverse);
 
 public:
 	static void _register_methods();
 	static void lm_main(GDLMSensor *p_sensor);
+	static void replay_main(GDLMSensor *p_sensor);
 
 	bool get_is_running();
 	bool get_is_connected();
@@ -116,12 +307,90 @@ public:
 	String get_finger_name(int p_idx);
 	String get_finger_bone_name(int p_idx);
 
+	// called by our frame source from our leap motion thread
+	virtual void on_connection_changed(bool p_is_connected);
+	virtual void on_device_changed(uint32_t p_device, const char *p_serial, bool p_is_attached);
+	virtual void on_tracking_event(uint32_t p_device, const LEAP_TRACKING_EVENT *p_event);
+	virtual void on_image_event(uint32_t p_device, const LEAP_IMAGE_EVENT *p_event);
+
+	int get_frame_source() const;
+	void set_frame_source(int p_type);
+	float get_synthetic_rate() const;
+	void set_synthetic_rate(float p_rate);
+	int get_synthetic_hands() const;
+	void set_synthetic_hands(int p_count);
+	int get_synthetic_devices() const;
+	void set_synthetic_devices(int p_count);
+
 	bool get_arvr() const;
 	void set_arvr(bool p_set);
 
 	float get_smooth_factor() const;
 	void set_smooth_factor(float p_smooth_factor);
 
+	float get_filter_min_cutoff() const;
+	void set_filter_min_cutoff(float p_min_cutoff);
+	float get_filter_beta() const;
+	void set_filter_beta(float p_beta);
+	float get_filter_d_cutoff() const;
+	void set_filter_d_cutoff(float p_d_cutoff);
+	void set_hand_filter(int p_type, float p_min_cutoff, float p_beta, float p_d_cutoff);
+	void clear_hand_filter(int p_type);
+
+	float get_hand_data_epsilon() const;
+	void set_hand_data_epsilon(float p_epsilon);
+	float get_pinch_distance_epsilon_mm() const;
+	void set_pinch_distance_epsilon_mm(float p_epsilon);
+	bool get_push_hand_data() const;
+	void set_push_hand_data(bool p_set);
+
+	float get_pinch_on_threshold() const;
+	void set_pinch_on_threshold(float p_threshold);
+	float get_pinch_off_threshold() const;
+	void set_pinch_off_threshold(float p_threshold);
+	float get_pinch_max_distance_mm() const;
+	void set_pinch_max_distance_mm(float p_distance);
+	float get_grab_on_threshold() const;
+	void set_grab_on_threshold(float p_threshold);
+	float get_grab_off_threshold() const;
+	void set_grab_off_threshold(float p_threshold);
+	float get_hand_state_rate() const;
+	void set_hand_state_rate(float p_rate);
+
+	bool get_collision_proxies() const;
+	void set_collision_proxies(bool p_set);
+	int get_collision_layer() const;
+	void set_collision_layer(int p_layer);
+	int get_collision_mask() const;
+	void set_collision_mask(int p_mask);
+
+	bool get_use_bone_rotations() const;
+	void set_use_bone_rotations(bool p_set);
+
+	float get_prediction_ms() const;
+	void set_prediction_ms(float p_prediction_ms);
+
+	int get_update_mode() const;
+	void set_update_mode(int p_mode);
+
+	int get_hand_pool_size() const;
+	void set_hand_pool_size(int p_size);
+	int get_hand_pool_hits() const;
+	int get_hand_pool_misses() const;
+
+	bool get_instance_hands() const;
+	void set_instance_hands(bool p_set);
+
+	bool get_arvr_trackers() const;
+	void set_arvr_trackers(bool p_set);
+	int get_tracker_id(int p_type) const;
+
+	int get_hand_count() const;
+	PoolVector3Array get_hand_joints(int p_index) const;
+	PoolRealArray get_hand_data(int p_index) const;
+	PoolVector3Array get_all_hand_joints() const;
+	PoolRealArray get_all_hand_data() const;
+
 	int get_keep_frames() const;
 	void set_keep_frames(int p_keep_frames);
 
@@ -131,15 +400,41 @@ public:
 	Transform get_hmd_to_leap_motion() const;
 	void set_hmd_to_leap_motion(Transform p_transform);
 
+	Array get_devices();
+	Transform get_device_transform(String p_serial) const;
+	void set_device_transform(String p_serial, Transform p_transform);
+	float get_merge_distance_mm() const;
+	void set_merge_distance_mm(float p_distance);
+
+	bool get_images_enabled() const;
+	void set_images_enabled(bool p_set);
+	int get_image_downsample();
+	void set_image_downsample(int p_downsample);
+	Rect2 get_image_crop();
+	void set_image_crop(Rect2 p_crop);
+	Ref<ImageTexture> get_image_texture(int p_camera);
+
 	void _init();
 	GDLMSensor();
 	~GDLMSensor();
 
+	bool start_recording(String p_path);
+	void stop_recording();
+	bool get_is_recording() const;
+	bool play_recording(String p_path, bool p_realtime);
+	void stop_playback();
+	bool get_is_playing() const;
+
+	Dictionary get_stats() const;
+	void reset_stats();
+
 	String get_left_hand_scene() const;
 	void set_left_hand_scene(String p_resource);
 	String get_right_hand_scene() const;
 	void set_right_hand_scene(String p_resource);
+	void _exit_tree();
 	void _physics_process(float delta);
+	void _process(float delta);
 };
 
 } // namespace godot
@@ -0,0 +1,70 @@
+#ifndef GDLM_SIMD_H
+#define GDLM_SIMD_H
+
+// Small set of lane operations so our kernels are written only once for each instruction set.
+// We process 8 (AVX), 4 (SSE) or 1 (scalar) floats at a time, GDLM_SIMD_WIDTH tells you which.
+// lanes_load and lanes_store need 32 byte aligned data, lanes_loadu and lanes_storeu don't.
+
+#include <math.h>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+
+#define GDLM_SIMD_WIDTH 8
+typedef __m256 lanes;
+
+static inline lanes lanes_load(const float *p_src) { return _mm256_load_ps(p_src); }
+static inline lanes lanes_loadu(const float *p_src) { return _mm256_loadu_ps(p_src); }
+static inline void lanes_store(float *r_dst, lanes p_a) { _mm256_store_ps(r_dst, p_a); }
+static inline void lanes_storeu(float *r_dst, lanes p_a) { _mm256_storeu_ps(r_dst, p_a); }
+static inline lanes lanes_set(float p_value) { return _mm256_set1_ps(p_value); }
+static inline lanes lanes_add(lanes p_a, lanes p_b) { return _mm256_add_ps(p_a, p_b); }
+static inline lanes lanes_sub(lanes p_a, lanes p_b) { return _mm256_sub_ps(p_a, p_b); }
+static inline lanes lanes_mul(lanes p_a, lanes p_b) { return _mm256_mul_ps(p_a, p_b); }
+static inline lanes lanes_div(lanes p_a, lanes p_b) { return _mm256_div_ps(p_a, p_b); }
+static inline lanes lanes_sqrt(lanes p_a) { return _mm256_sqrt_ps(p_a); }
+static inline lanes lanes_safe_div(lanes p_a, lanes p_b) {
+	// like Vector3::normalize we return zero when our length is zero
+	return _mm256_and_ps(_mm256_cmp_ps(p_b, _mm256_setzero_ps(), _CMP_GT_OQ), _mm256_div_ps(p_a, p_b));
+}
+#elif defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+
+#define GDLM_SIMD_WIDTH 4
+typedef __m128 lanes;
+
+static inline lanes lanes_load(const float *p_src) { return _mm_load_ps(p_src); }
+static inline lanes lanes_loadu(const float *p_src) { return _mm_loadu_ps(p_src); }
+static inline void lanes_store(float *r_dst, lanes p_a) { _mm_store_ps(r_dst, p_a); }
+static inline void lanes_storeu(float *r_dst, lanes p_a) { _mm_storeu_ps(r_dst, p_a); }
+static inline lanes lanes_set(float p_value) { return _mm_set1_ps(p_value); }
+static inline lanes lanes_add(lanes p_a, lanes p_b) { return _mm_add_ps(p_a, p_b); }
+static inline lanes lanes_sub(lanes p_a, lanes p_b) { return _mm_sub_ps(p_a, p_b); }
+static inline lanes lanes_mul(lanes p_a, lanes p_b) { return _mm_mul_ps(p_a, p_b); }
+static inline lanes lanes_div(lanes p_a, lanes p_b) { return _mm_div_ps(p_a, p_b); }
+static inline lanes lanes_sqrt(lanes p_a) { return _mm_sqrt_ps(p_a); }
+static inline lanes lanes_safe_div(lanes p_a, lanes p_b) {
+	// like Vector3::normalize we return zero when our length is zero
+	return _mm_and_ps(_mm_cmpgt_ps(p_b, _mm_setzero_ps()), _mm_div_ps(p_a, p_b));
+}
+#else
+#define GDLM_SIMD_WIDTH 1
+typedef float lanes;
+
+static inline lanes lanes_load(const float *p_src) { return *p_src; }
+static inline lanes lanes_loadu(const float *p_src) { return *p_src; }
+static inline void lanes_store(float *r_dst, lanes p_a) { *r_dst = p_a; }
+static inline void lanes_storeu(float *r_dst, lanes p_a) { *r_dst = p_a; }
+static inline lanes lanes_set(float p_value) { return p_value; }
+static inline lanes lanes_add(lanes p_a, lanes p_b) { return p_a + p_b; }
+static inline lanes lanes_sub(lanes p_a, lanes p_b) { return p_a - p_b; }
+static inline lanes lanes_mul(lanes p_a, lanes p_b) { return p_a * p_b; }
+static inline lanes lanes_div(lanes p_a, lanes p_b) { return p_a / p_b; }
+static inline lanes lanes_sqrt(lanes p_a) { return sqrtf(p_a); }
+static inline lanes lanes_safe_div(lanes p_a, lanes p_b) {
+	// like Vector3::normalize we return zero when our length is zero
+	return p_b > 0.0f ? p_a / p_b : 0.0f;
+}
+#endif
+
+#endif /* !GDLM_SIMD_H */
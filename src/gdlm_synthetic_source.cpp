@@ -0,0 +1,444 @@
+#include "gdlm_synthetic_source.h"
+
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <thread>
+
+#define TWO_PI 6.28318530718f
+
+// focal length of our cameras in pixels, and how far they are apart in mm
+#define IMAGE_FOCAL_LENGTH 200.0f
+#define IMAGE_BASELINE 40.0f
+
+using namespace godot;
+
+// Lengths of our metacarpal, proximal, intermediate and distal bones in mm, our thumb has no metacarpal.
+static const float bone_lengths[5][4] = {
+	{ 0.0f, 40.0f, 30.0f, 25.0f },
+	{ 65.0f, 40.0f, 25.0f, 18.0f },
+	{ 62.0f, 45.0f, 28.0f, 19.0f },
+	{ 58.0f, 42.0f, 26.0f, 18.0f },
+	{ 54.0f, 32.0f, 19.0f, 17.0f }
+};
+
+// Where our metacarpals start relative to our palm in mm, our hands point along -Z.
+static const float bone_starts[5][3] = {
+	{ -25.0f, -5.0f, 25.0f },
+	{ -15.0f, 0.0f, 35.0f },
+	{ 0.0f, 0.0f, 35.0f },
+	{ 15.0f, 0.0f, 35.0f },
+	{ 28.0f, 0.0f, 35.0f }
+};
+
+static inline LEAP_QUATERNION quat_mul(const LEAP_QUATERNION &p_a, const LEAP_QUATERNION &p_b) {
+	LEAP_QUATERNION r;
+	r.x = p_a.w * p_b.x + p_a.x * p_b.w + p_a.y * p_b.z - p_a.z * p_b.y;
+	r.y = p_a.w * p_b.y + p_a.y * p_b.w + p_a.z * p_b.x - p_a.x * p_b.z;
+	r.z = p_a.w * p_b.z + p_a.z * p_b.w + p_a.x * p_b.y - p_a.y * p_b.x;
+	r.w = p_a.w * p_b.w - p_a.x * p_b.x - p_a.y * p_b.y - p_a.z * p_b.z;
+	return r;
+}
+
+static inline LEAP_QUATERNION quat_axis_angle(float p_x, float p_y, float p_z, float p_angle) {
+	float s = sinf(p_angle * 0.5f);
+	LEAP_QUATERNION r;
+	r.x = p_x * s;
+	r.y = p_y * s;
+	r.z = p_z * s;
+	r.w = cosf(p_angle * 0.5f);
+	return r;
+}
+
+static inline LEAP_VECTOR quat_rotate(const LEAP_QUATERNION &p_q, float p_x, float p_y, float p_z) {
+	// v' = v + 2w(q x v) + 2(q x (q x v))
+	float cx = p_q.y * p_z - p_q.z * p_y;
+	float cy = p_q.z * p_x - p_q.x * p_z;
+	float cz = p_q.x * p_y - p_q.y * p_x;
+	float ccx = p_q.y * cz - p_q.z * cy;
+	float ccy = p_q.z * cx - p_q.x * cz;
+	float ccz = p_q.x * cy - p_q.y * cx;
+
+	LEAP_VECTOR r;
+	r.x = p_x + 2.0f * (p_q.w * cx + ccx);
+	r.y = p_y + 2.0f * (p_q.w * cy + ccy);
+	r.z = p_z + 2.0f * (p_q.w * cz + ccz);
+	return r;
+}
+
+static inline LEAP_VECTOR vector_add(const LEAP_VECTOR &p_a, const LEAP_VECTOR &p_b) {
+	LEAP_VECTOR r;
+	r.x = p_a.x + p_b.x;
+	r.y = p_a.y + p_b.y;
+	r.z = p_a.z + p_b.z;
+	return r;
+}
+
+GDLMSyntheticSource::GDLMSyntheticSource() {
+	rate.store(110.0f);
+	hand_count.store(2);
+	device_count.store(1);
+	images_enabled.store(false);
+
+	is_connected = false;
+	attached_devices = 0;
+	is_interrupted = false;
+	start_usec = 0;
+	next_usec = 0;
+	frame_number = 0;
+
+	memset(&frame, 0, sizeof(frame));
+	frame.event.pHands = frame.hands;
+	memset(&device_frame, 0, sizeof(device_frame));
+	device_frame.event.pHands = device_frame.hands;
+
+	image_pixels = NULL;
+	memset(&image_event, 0, sizeof(image_event));
+	for (int c = 0; c < 2; c++) {
+		LEAP_IMAGE_PROPERTIES &properties = image_event.image[c].properties;
+		properties.type = eLeapImageType_Default;
+		properties.format = eLeapImageFormat_IR;
+		properties.bpp = 1;
+		properties.width = GDLM_SYNTHETIC_IMAGE_WIDTH;
+		properties.height = GDLM_SYNTHETIC_IMAGE_HEIGHT;
+		properties.x_scale = 1.0f;
+		properties.y_scale = 1.0f;
+	}
+}
+
+GDLMSyntheticSource::~GDLMSyntheticSource() {
+	if (image_pixels != NULL) {
+		delete[] image_pixels;
+		image_pixels = NULL;
+	}
+}
+
+float GDLMSyntheticSource::get_rate() const {
+	return rate.load();
+}
+
+void GDLMSyntheticSource::set_rate(float p_rate) {
+	// anything slower than 1 frame per second isn't much use
+	rate.store(p_rate < 1.0f ? 1.0f : p_rate);
+}
+
+int GDLMSyntheticSource::get_hand_count() const {
+	return hand_count.load();
+}
+
+void GDLMSyntheticSource::set_hand_count(int p_count) {
+	// we can't output more hands than fit in our frames
+	if (p_count < 0) {
+		p_count = 0;
+	} else if (p_count > GDLM_MAX_HANDS) {
+		p_count = GDLM_MAX_HANDS;
+	}
+	hand_count.store(p_count);
+}
+
+int GDLMSyntheticSource::get_device_count() const {
+	return device_count.load();
+}
+
+void GDLMSyntheticSource::set_device_count(int p_count) {
+	if (p_count < 1) {
+		p_count = 1;
+	} else if (p_count > GDLM_MAX_DEVICES) {
+		p_count = GDLM_MAX_DEVICES;
+	}
+	device_count.store(p_count);
+}
+
+void GDLMSyntheticSource::update_devices(GDLMFrameSourceListener *p_listener) {
+	// our device ids start at 1, like LeapC's
+	int count = device_count.load();
+	char serial[GDLM_MAX_SERIAL];
+	while (attached_devices < count) {
+		snprintf(serial, sizeof(serial), "SYNTHETIC%i", attached_devices);
+		printf("LeapMotion - found device %s\n", serial);
+		p_listener->on_device_changed(attached_devices + 1, serial, true);
+		attached_devices++;
+	}
+	while (attached_devices > count) {
+		attached_devices--;
+		snprintf(serial, sizeof(serial), "SYNTHETIC%i", attached_devices);
+		printf("LeapMotion - lost device %s\n", serial);
+		p_listener->on_device_changed(attached_devices + 1, serial, false);
+	}
+}
+
+// moves our hand p_offset mm along x
+static void offset_hand(LEAP_HAND *r_hand, float p_offset) {
+	r_hand->palm.position.x += p_offset;
+	r_hand->palm.stabilized_position.x += p_offset;
+	for (int d = 0; d < 5; d++) {
+		for (int b = 0; b < 4; b++) {
+			r_hand->digits[d].bones[b].prev_joint.x += p_offset;
+			r_hand->digits[d].bones[b].next_joint.x += p_offset;
+		}
+	}
+	r_hand->arm.prev_joint.x += p_offset;
+	r_hand->arm.next_joint.x += p_offset;
+}
+
+void GDLMSyntheticSource::generate_hand(LEAP_HAND *r_hand, int p_index, float p_time) {
+	// alternate left and right hands, each hand gets its own phase so they don't move in lock step
+	bool is_left = (p_index % 2) == 0;
+	float side = is_left ? -1.0f : 1.0f;
+	float phase = (float)p_index * 0.7f;
+
+	memset(r_hand, 0, sizeof(LEAP_HAND));
+	r_hand->id = p_index + 1;
+	r_hand->type = is_left ? eLeapHandType_Left : eLeapHandType_Right;
+	r_hand->confidence = 1.0f;
+	r_hand->visible_time = (uint64_t)(p_time * 1000000.0f);
+
+	// our palm moves about in a lissajous pattern above our sensor while slowly turning
+	LEAP_QUATERNION palm_rotation = quat_axis_angle(0.0f, 1.0f, 0.0f, 0.4f * sinf(TWO_PI * 0.2f * p_time + phase));
+	r_hand->palm.position.x = side * (80.0f + 20.0f * (float)(p_index / 2)) + 30.0f * sinf(TWO_PI * 0.25f * p_time + phase);
+	r_hand->palm.position.y = 200.0f + 40.0f * sinf(TWO_PI * 0.15f * p_time + phase);
+	r_hand->palm.position.z = 40.0f * cosf(TWO_PI * 0.25f * p_time + phase);
+	r_hand->palm.stabilized_position = r_hand->palm.position;
+	r_hand->palm.orientation = palm_rotation;
+	r_hand->palm.normal = quat_rotate(palm_rotation, 0.0f, -1.0f, 0.0f);
+	r_hand->palm.direction = quat_rotate(palm_rotation, 0.0f, 0.0f, -1.0f);
+	r_hand->palm.width = 85.0f;
+
+	// our fingers open and close, our grab and pinch follow along
+	float curl = 0.5f + 0.5f * sinf(TWO_PI * 0.5f * p_time + phase);
+	r_hand->grab_strength = curl;
+	r_hand->grab_angle = curl * 3.14159265359f;
+	r_hand->pinch_strength = curl;
+	r_hand->pinch_distance = 60.0f * (1.0f - curl);
+
+	for (int d = 0; d < 5; d++) {
+		LEAP_DIGIT *digit = &r_hand->digits[d];
+		digit->finger_id = r_hand->id * 10 + d;
+		digit->is_extended = curl < 0.5f ? 1 : 0;
+
+		// our fingers curl down, towards our palm normal, our thumb curls less
+		float bone_curl = (d == 0 ? -0.3f : -0.6f) * (0.2f + curl);
+		LEAP_VECTOR joint = vector_add(r_hand->palm.position, quat_rotate(palm_rotation, side * bone_starts[d][0], bone_starts[d][1], bone_starts[d][2]));
+		for (int b = 0; b < 4; b++) {
+			// LeapC bones point along their -Z axis
+			LEAP_BONE *bone = &digit->bones[b];
+			bone->rotation = quat_mul(palm_rotation, quat_axis_angle(1.0f, 0.0f, 0.0f, bone_curl * (float)b));
+			bone->width = 15.0f;
+			bone->prev_joint = joint;
+			joint = vector_add(joint, quat_rotate(bone->rotation, 0.0f, 0.0f, -bone_lengths[d][b]));
+			bone->next_joint = joint;
+		}
+	}
+
+	// and our arm extends back from our wrist
+	r_hand->arm.rotation = palm_rotation;
+	r_hand->arm.width = 60.0f;
+	r_hand->arm.next_joint = vector_add(r_hand->palm.position, quat_rotate(palm_rotation, 0.0f, 0.0f, 50.0f));
+	r_hand->arm.prev_joint = vector_add(r_hand->arm.next_joint, quat_rotate(palm_rotation, 0.0f, 0.0f, 250.0f));
+}
+
+void GDLMSyntheticSource::generate_frame(float p_rate) {
+	float time = (float)frame_number / p_rate;
+	int count = hand_count.load();
+
+	frame.event.info.reserved = NULL;
+	frame.event.info.frame_id = frame_number + 1;
+	frame.event.tracking_frame_id = frame_number + 1;
+	frame.event.framerate = p_rate;
+	frame.event.nHands = count;
+	frame.event.pHands = frame.hands;
+
+	for (int h = 0; h < count; h++) {
+		generate_hand(&frame.hands[h], h, time);
+	}
+}
+
+const LEAP_TRACKING_EVENT *GDLMSyntheticSource::generate(int64_t p_frame_number) {
+	float frame_rate = rate.load();
+
+	frame_number = p_frame_number;
+	generate_frame(frame_rate);
+	frame.event.info.timestamp = (int64_t)((double)p_frame_number * 1000000.0 / frame_rate);
+
+	return &frame.event;
+}
+
+// fills a disc of radius p_radius around p_x, p_y with p_value
+static void draw_disc(uint8_t *r_pixels, float p_x, float p_y, float p_radius, uint8_t p_value) {
+	int x0 = (int)(p_x - p_radius);
+	int x1 = (int)(p_x + p_radius);
+	int y0 = (int)(p_y - p_radius);
+	int y1 = (int)(p_y + p_radius);
+	x0 = x0 < 0 ? 0 : x0;
+	y0 = y0 < 0 ? 0 : y0;
+	x1 = x1 >= GDLM_SYNTHETIC_IMAGE_WIDTH ? GDLM_SYNTHETIC_IMAGE_WIDTH - 1 : x1;
+	y1 = y1 >= GDLM_SYNTHETIC_IMAGE_HEIGHT ? GDLM_SYNTHETIC_IMAGE_HEIGHT - 1 : y1;
+
+	float radius2 = p_radius * p_radius;
+	for (int y = y0; y <= y1; y++) {
+		float dy = (float)y - p_y;
+		for (int x = x0; x <= x1; x++) {
+			float dx = (float)x - p_x;
+			if (dx * dx + dy * dy <= radius2) {
+				r_pixels[y * GDLM_SYNTHETIC_IMAGE_WIDTH + x] = p_value;
+			}
+		}
+	}
+}
+
+// projects p_position, in mm, onto a camera looking up from p_camera_x, returns false if it's behind our camera
+static bool project(const LEAP_VECTOR &p_position, float p_camera_x, float *r_x, float *r_y, float *r_scale) {
+	if (p_position.y < 10.0f) {
+		return false;
+	}
+
+	*r_scale = IMAGE_FOCAL_LENGTH / p_position.y;
+	*r_x = 0.5f * (float)GDLM_SYNTHETIC_IMAGE_WIDTH + (p_position.x - p_camera_x) * *r_scale;
+	*r_y = 0.5f * (float)GDLM_SYNTHETIC_IMAGE_HEIGHT + p_position.z * *r_scale;
+	return true;
+}
+
+const LEAP_IMAGE_EVENT *GDLMSyntheticSource::generate_images(const LEAP_TRACKING_EVENT *p_event) {
+	image_event.info = p_event->info;
+
+	for (int c = 0; c < 2; c++) {
+		uint8_t *pixels = image_pixels + c * GDLM_SYNTHETIC_IMAGE_WIDTH * GDLM_SYNTHETIC_IMAGE_HEIGHT;
+		float camera_x = (c == 0 ? -0.5f : 0.5f) * IMAGE_BASELINE;
+
+		// IR images are mostly dark with whatever is close to our sensor lit up
+		memset(pixels, 16, GDLM_SYNTHETIC_IMAGE_WIDTH * GDLM_SYNTHETIC_IMAGE_HEIGHT);
+		for (uint32_t h = 0; h < p_event->nHands; h++) {
+			const LEAP_HAND *hand = &p_event->pHands[h];
+			float x, y, scale;
+			if (project(hand->palm.position, camera_x, &x, &y, &scale)) {
+				draw_disc(pixels, x, y, 0.4f * hand->palm.width * scale, 160);
+			}
+			for (int d = 0; d < 5; d++) {
+				if (project(hand->digits[d].bones[3].next_joint, camera_x, &x, &y, &scale)) {
+					draw_disc(pixels, x, y, 8.0f * scale, 224);
+				}
+			}
+		}
+
+		image_event.image[c].data = pixels;
+		image_event.image[c].offset = 0;
+	}
+
+	return &image_event;
+}
+
+void GDLMSyntheticSource::set_images_enabled(bool p_set) {
+	if (p_set && image_pixels == NULL) {
+		// allocate our images before our thread can see we're enabled
+		image_pixels = new uint8_t[2 * GDLM_SYNTHETIC_IMAGE_WIDTH * GDLM_SYNTHETIC_IMAGE_HEIGHT];
+	}
+
+	images_enabled.store(p_set, std::memory_order_release);
+}
+
+bool GDLMSyntheticSource::open() {
+	clock_sync.reset();
+	start_usec = get_now();
+	next_usec = start_usec;
+	frame_number = 0;
+	is_connected = false;
+	attached_devices = 0;
+
+	wait_mutex.lock();
+	is_interrupted = false;
+	wait_mutex.unlock();
+
+	return true;
+}
+
+void GDLMSyntheticSource::close() {
+	is_connected = false;
+}
+
+void GDLMSyntheticSource::poll(GDLMFrameSourceListener *p_listener, unsigned int p_timeout) {
+	if (!is_connected) {
+		// we're always connected right away
+		printf("LeapMotion - connected to synthetic source\n");
+		is_connected = true;
+		p_listener->on_connection_changed(true);
+		update_devices(p_listener);
+		return;
+	}
+
+	// our device count may have changed
+	update_devices(p_listener);
+
+	// wait for our next frame to be due, until we time out, or until we're interrupted
+	int64_t now = get_now();
+	if (next_usec > now) {
+		int64_t wait = next_usec - now;
+		bool timed_out = wait > (int64_t)p_timeout * 1000;
+		if (timed_out) {
+			wait = (int64_t)p_timeout * 1000;
+		}
+
+		std::unique_lock<std::mutex> lock(wait_mutex);
+		if (wait_condition.wait_for(lock, std::chrono::microseconds(wait), [this] { return is_interrupted; }) || timed_out) {
+			return;
+		}
+	}
+
+	// output every frame that is due, so we never fall behind by a frame per wakeup
+	now = get_now();
+	while (next_usec <= now) {
+		float frame_rate = rate.load();
+		generate_frame(frame_rate);
+		frame.event.info.timestamp = next_usec;
+		p_listener->on_tracking_event(1, &frame.event);
+		if (images_enabled.load(std::memory_order_acquire)) {
+			p_listener->on_image_event(1, generate_images(&frame.event));
+		}
+
+		// our other devices see the same hands a little offset, with their own ids
+		for (int d = 1; d < attached_devices; d++) {
+			gdlm_copy_frame(&device_frame, &frame.event);
+			for (uint32_t h = 0; h < device_frame.event.nHands; h++) {
+				LEAP_HAND *hand = &device_frame.hands[h];
+				hand->id += d * 100;
+				hand->confidence = 0.8f;
+				offset_hand(hand, 2.0f * (float)d);
+			}
+			p_listener->on_tracking_event(d + 1, &device_frame.event);
+		}
+
+		// schedule our next frame, if we've fallen far behind we skip ahead instead of bursting frames
+		frame_number++;
+		next_usec += (int64_t)(1000000.0f / frame_rate);
+		if (now - next_usec > 100000) {
+			next_usec = now + (int64_t)(1000000.0f / frame_rate);
+		}
+	}
+}
+
+void GDLMSyntheticSource::interrupt() {
+	wait_mutex.lock();
+	is_interrupted = true;
+	wait_mutex.unlock();
+
+	wait_condition.notify_all();
+}
+
+int64_t GDLMSyntheticSource::get_now() {
+	// our clock is our local clock
+	return GDLMClockSync::get_local_usec();
+}
+
+void GDLMSyntheticSource::update_clock(int64_t p_godot_usec, int64_t p_resolution_usec) {
+	int64_t now = get_now();
+	clock_sync.add_godot_sample(p_godot_usec, p_resolution_usec, now);
+	clock_sync.add_source_sample(now, now, now);
+}
+
+bool GDLMSyntheticSource::rebase_clock(int64_t p_godot_usec, int64_t *r_usec) {
+	return clock_sync.godot_to_source(p_godot_usec, r_usec);
+}
+
+bool GDLMSyntheticSource::get_clock_stats(gdlm_clock_stats *r_stats) const {
+	return clock_sync.get_stats(r_stats);
+}
@@ -0,0 +1,78 @@
+#ifndef GDLM_SYNTHETIC_SOURCE_H
+#define GDLM_SYNTHETIC_SOURCE_H
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+
+#include "gdlm_frame_buffer.h"
+#include "gdlm_frame_source.h"
+
+// Size of the camera images we generate, the same as those of a leap motion controller.
+#define GDLM_SYNTHETIC_IMAGE_WIDTH 640
+#define GDLM_SYNTHETIC_IMAGE_HEIGHT 240
+
+namespace godot {
+
+// Generates tracking frames with hands moving about, for testing without a leap motion device.
+// Our motion only depends on our frame number so the same settings always produce the same frames.
+// We can pretend to be multiple devices, each sees the same hands but with its own hand ids and
+// slightly offset, like devices that aren't perfectly calibrated.
+// When asked we also draw camera images of our first device, with our palms and fingertips as bright blobs.
+class GDLMSyntheticSource : public GDLMFrameSource {
+private:
+	std::atomic<float> rate; // frames per second
+	std::atomic<int> hand_count;
+	std::atomic<int> device_count;
+	std::atomic<bool> images_enabled;
+	GDLMClockSync clock_sync; // relates Godots clock to ours
+
+	bool is_connected;
+	int attached_devices; // number of devices our listener knows about
+	bool is_interrupted; // guarded by wait_mutex
+	std::mutex wait_mutex;
+	std::condition_variable wait_condition; // wakes us up early when we're interrupted
+	int64_t start_usec; // when we started generating frames
+	int64_t next_usec; // when our next frame is due
+	int64_t frame_number;
+	gdlm_frame frame; // our frame, reused for every frame we generate
+	gdlm_frame device_frame; // our frame as seen by our other devices
+	uint8_t *image_pixels; // both our camera images, NULL until images are first enabled
+	LEAP_IMAGE_EVENT image_event;
+
+	void generate_hand(LEAP_HAND *r_hand, int p_index, float p_time);
+	void generate_frame(float p_rate);
+	void update_devices(GDLMFrameSourceListener *p_listener);
+
+public:
+	GDLMSyntheticSource();
+	~GDLMSyntheticSource();
+
+	float get_rate() const;
+	void set_rate(float p_rate);
+	int get_hand_count() const;
+	void set_hand_count(int p_count);
+	int get_device_count() const;
+	void set_device_count(int p_count);
+
+	// generates the frame with number p_frame_number without touching our clock, handy for benchmarks
+	const LEAP_TRACKING_EVENT *generate(int64_t p_frame_number);
+	// draws the camera images that go with p_event, only valid once images are enabled
+	const LEAP_IMAGE_EVENT *generate_images(const LEAP_TRACKING_EVENT *p_event);
+
+	virtual bool open();
+	virtual void close();
+	virtual void poll(GDLMFrameSourceListener *p_listener, unsigned int p_timeout);
+	virtual void interrupt();
+
+	virtual int64_t get_now();
+	virtual void update_clock(int64_t p_godot_usec, int64_t p_resolution_usec);
+	virtual bool rebase_clock(int64_t p_godot_usec, int64_t *r_usec);
+	virtual bool get_clock_stats(gdlm_clock_stats *r_stats) const;
+
+	virtual void set_images_enabled(bool p_set);
+};
+
+} // namespace godot
+
+#endif /* !GDLM_SYNTHETIC_SOURCE_H */
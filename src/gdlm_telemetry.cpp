@@ -0,0 +1,98 @@
+#include "gdlm_telemetry.h"
+
+#include <algorithm>
+
+using namespace godot;
+
+GDLMSampleWindow::GDLMSampleWindow() {
+	reset();
+}
+
+void GDLMSampleWindow::add(int64_t p_sample) {
+	// clamp so anything silly doesn't wrap around, more than half an hour behind or 2km off isn't interesting anyway
+	if (p_sample > INT32_MAX) {
+		p_sample = INT32_MAX;
+	} else if (p_sample < INT32_MIN) {
+		p_sample = INT32_MIN;
+	}
+
+	uint32_t n = count.load(std::memory_order_relaxed);
+	samples[n % GDLM_TELEMETRY_SAMPLES].store((int32_t)p_sample, std::memory_order_relaxed);
+	count.store(n + 1, std::memory_order_release);
+}
+
+void GDLMSampleWindow::reset() {
+	for (int i = 0; i < GDLM_TELEMETRY_SAMPLES; i++) {
+		samples[i].store(0, std::memory_order_relaxed);
+	}
+	count.store(0, std::memory_order_release);
+}
+
+bool GDLMSampleWindow::get_stats(gdlm_sample_stats *r_stats) const {
+	int32_t sorted[GDLM_TELEMETRY_SAMPLES];
+
+	uint32_t n = count.load(std::memory_order_acquire);
+	int size = n < GDLM_TELEMETRY_SAMPLES ? (int)n : GDLM_TELEMETRY_SAMPLES;
+	if (size == 0) {
+		return false;
+	}
+
+	int64_t total = 0;
+	for (int i = 0; i < size; i++) {
+		sorted[i] = samples[i].load(std::memory_order_relaxed);
+		total += sorted[i];
+	}
+	std::sort(sorted, sorted + size);
+
+	r_stats->count = size;
+	r_stats->mean = (float)total / (float)size;
+	r_stats->p50 = sorted[(size * 50) / 100];
+	r_stats->p99 = sorted[std::min(size - 1, (size * 99) / 100)];
+	r_stats->max = sorted[size - 1];
+
+	return true;
+}
+
+GDLMTelemetry::GDLMTelemetry() {
+	reset();
+}
+
+void GDLMTelemetry::frame_received(const LEAP_TRACKING_EVENT *p_event, int64_t p_received, int64_t p_previous_id) {
+	receive_latency.add(p_received - p_event->info.timestamp);
+	frames_received.fetch_add(1, std::memory_order_relaxed);
+	framerate.store(p_event->framerate, std::memory_order_relaxed);
+
+	// frame ids go up by one for each frame our device tracked, anything we didn't get was dropped along the way
+	if (p_previous_id != 0 && p_event->info.frame_id > p_previous_id + 1) {
+		frames_dropped.fetch_add(p_event->info.frame_id - p_previous_id - 1, std::memory_order_relaxed);
+	}
+}
+
+void GDLMTelemetry::frame_picked_up(int64_t p_timestamp, int64_t p_now) {
+	pickup_latency.add(p_now - p_timestamp);
+	frames_processed.fetch_add(1, std::memory_order_relaxed);
+}
+
+void GDLMTelemetry::frame_applied(int64_t p_timestamp, int64_t p_now) {
+	apply_latency.add(p_now - p_timestamp);
+}
+
+void GDLMTelemetry::frame_skipped() {
+	frames_skipped.fetch_add(1, std::memory_order_relaxed);
+}
+
+void GDLMTelemetry::prediction_checked(float p_error_mm) {
+	prediction_error.add((int64_t)(p_error_mm * 1000.0f));
+}
+
+void GDLMTelemetry::reset() {
+	receive_latency.reset();
+	pickup_latency.reset();
+	apply_latency.reset();
+	prediction_error.reset();
+	frames_received.store(0);
+	frames_dropped.store(0);
+	framerate.store(0.0f);
+	frames_processed.store(0);
+	frames_skipped.store(0);
+}
@@ -0,0 +1,86 @@
+#ifndef GDLM_TELEMETRY_H
+#define GDLM_TELEMETRY_H
+
+#include <atomic>
+#include <stdint.h>
+
+// our leap motion data structures
+#include "gdlm_leap_types.h"
+
+// Number of samples in our rolling windows, at 110Hz tracking this is a little over 2 seconds.
+#define GDLM_TELEMETRY_SAMPLES 256
+
+namespace godot {
+
+struct gdlm_sample_stats {
+	int count; // number of samples in our window
+	float mean;
+	int64_t p50;
+	int64_t p99;
+	int64_t max;
+};
+
+// Rolling window of samples, timings in microseconds or distances in micrometres.
+// There is exactly one writer thread, readers on other threads may see a sample being replaced
+// but never a torn one, which is good enough for statistics.
+class GDLMSampleWindow {
+private:
+	std::atomic<int32_t> samples[GDLM_TELEMETRY_SAMPLES];
+	std::atomic<uint32_t> count; // number of samples written, sample n lives in samples[n % GDLM_TELEMETRY_SAMPLES]
+
+public:
+	GDLMSampleWindow();
+
+	void add(int64_t p_sample);
+	void reset();
+
+	// returns false if we don't have any samples yet
+	bool get_stats(gdlm_sample_stats *r_stats) const;
+};
+
+// Keeps track of how old our frames are at each point of our pipeline and how many frames we lose.
+// All times are on the clock of our frame source, the clock our tracking events are timestamped with.
+class GDLMTelemetry {
+private:
+	// written by our leap motion thread
+	GDLMSampleWindow receive_latency; // tracking event timestamp to receipt on our leap motion thread
+	std::atomic<uint64_t> frames_received;
+	std::atomic<uint64_t> frames_dropped; // gaps in frame_id between the tracking events we received from each device
+	std::atomic<float> framerate; // as reported by our last tracking event
+
+	// written by our physics thread
+	GDLMSampleWindow pickup_latency; // tracking event timestamp to pickup in _physics_process
+	GDLMSampleWindow apply_latency; // tracking event timestamp to having written all our transforms
+	GDLMSampleWindow prediction_error; // distance between predicted and actual palm positions in micrometres
+	std::atomic<uint64_t> frames_processed;
+	std::atomic<uint64_t> frames_skipped; // ticks in which our last frame was already processed
+
+public:
+	GDLMTelemetry();
+
+	// Called from our leap motion thread, p_previous_id is the frame id of the last event we received
+	// from the same device or 0 if this is its first.
+	void frame_received(const LEAP_TRACKING_EVENT *p_event, int64_t p_received, int64_t p_previous_id);
+
+	// called from our physics thread
+	void frame_picked_up(int64_t p_timestamp, int64_t p_now);
+	void frame_applied(int64_t p_timestamp, int64_t p_now);
+	void frame_skipped();
+	void prediction_checked(float p_error_mm);
+
+	void reset();
+
+	const GDLMSampleWindow &get_receive_latency() const { return receive_latency; }
+	const GDLMSampleWindow &get_pickup_latency() const { return pickup_latency; }
+	const GDLMSampleWindow &get_apply_latency() const { return apply_latency; }
+	const GDLMSampleWindow &get_prediction_error() const { return prediction_error; }
+	uint64_t get_frames_received() const { return frames_received.load(); }
+	uint64_t get_frames_dropped() const { return frames_dropped.load(); }
+	uint64_t get_frames_processed() const { return frames_processed.load(); }
+	uint64_t get_frames_skipped() const { return frames_skipped.load(); }
+	float get_framerate() const { return framerate.load(); }
+};
+
+} // namespace godot
+
+#endif /* !GDLM_TELEMETRY_H */